@@ -0,0 +1,58 @@
+#include <CellClassifier.h>
+#include <generate/MapGenerator.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Times CellClassifier::classify against the findElement-per-character path over the rows of a large generated map
+ */
+namespace {
+    template<typename F>
+    double secondsPerPass(F &&pass, int repeats) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; ++i) pass();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / repeats;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const size_t cells = argc > 1 ? std::stoul(argv[1]) : 64 << 20;
+    const int repeats = 5;
+
+    // a square maze of about `size` cells, its rows laid end to end (ids stay below 5, so one byte per cell)
+    const auto side = static_cast<size_t>(std::sqrt(static_cast<double>(cells)));
+    const std::string map = MapGenerator::generateText({.width = side, .height = side, .keys = 5, .doorsPerGate = 8});
+    std::string text;
+    text.reserve(side * side);
+    for (size_t pos = map.find('\n') + 1; pos < map.size(); pos = map.find('\n', pos) + 1) {
+        text.append(map, pos, map.find('\n', pos) - pos);
+    }
+    const size_t size = text.size();
+
+    std::vector<Cell> scalarCells(size), simdCells(size);
+    size_t checksum = 0;
+
+    const double scalar = secondsPerPass([&] {
+        checksum += CellClassifier::classifyScalar(text.data(), size, scalarCells.data());
+    }, repeats);
+    const double simd = secondsPerPass([&] {
+        checksum += CellClassifier::classify(text.data(), size, simdCells.data());
+    }, repeats);
+
+    if (scalarCells != simdCells) {
+        std::cerr << "classify and classifyScalar disagree" << std::endl;
+        return 1;
+    }
+
+    const double megabytes = static_cast<double>(size) / (1 << 20);
+    std::cout << "cells:           " << size << " (checksum " << checksum << ")\n"
+              << "findElement:     " << megabytes / scalar << " MiB/s\n"
+              << "classify (" << CellClassifier::instructionSet() << "): " << megabytes / simd << " MiB/s\n"
+              << "speedup:         " << scalar / simd << "x" << std::endl;
+    return 0;
+}
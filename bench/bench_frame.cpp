@@ -0,0 +1,101 @@
+#include "Scene.h"
+#include "render/RenderBackend.h"
+
+#include <generate/MapGenerator.h>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+/**
+ * Times preparing frames of a large generated map with no GPU: the scene draws into a NullBackend through a
+ * RecordingBackend, which counts the calls each frame makes and can write them to a trace for RenderTrace::replay.
+ *
+ * Usage: bench_frame [side] [frames] [far] [trace file]. The camera turns on the spot above the start; a far plane
+ * past the game's (10) draws more of the map. Run from the repository root, where models/ is.
+ */
+namespace {
+    constexpr float FOV_Y = 3.14f / 4;
+    constexpr float ZNEAR = 0.01f;
+    // frames drawn first, with pauses so the chunk meshes around the start can be built
+    constexpr int WARM_UP_FRAMES = 20;
+}
+
+int main(int argc, char *argv[]) {
+    const size_t side = argc > 1 ? std::stoul(argv[1]) : 4096;
+    const int frames = argc > 2 ? std::stoi(argv[2]) : 500;
+    const float far = argc > 3 ? std::stof(argv[3]) : 10.0f;
+    std::unique_ptr<std::ofstream> trace;
+    if (argc > 4) trace = std::make_unique<std::ofstream>(argv[4]);
+
+    Map map = MapGenerator::generateMap({.width = side, .height = side, .keys = 5, .doorsPerGate = 8}, Layout::TILED);
+
+    Model cubeModel = Utils::loadModel("models/cube.txt");
+    Model knotModel = Utils::loadModel("models/knot.txt");
+    Model teapotModel = Utils::loadModel("models/teapot.txt");
+    Model combined = Model::combine({&cubeModel, &knotModel, &teapotModel});
+    TexturedModel brickCube = {.model = cubeModel, .textureId = 1};
+    TexturedModel woodCube = {.model = cubeModel, .textureId = 0};
+    TextureData textures = {
+            .wallModel = brickCube,
+            .keyModel = knotModel,
+            .floorModel = woodCube,
+            .endModel = teapotModel,
+            .doorModel = cubeModel,
+    };
+
+    NullBackend null;
+    RecordingBackend backend(null, trace.get());
+    // programs and the model buffer are made outside the backend, so any names do
+    Scene scene(backend, textures, map, 1, 2, 3);
+
+    const glm::vec3 start = scene.GetStartPosition();
+    const glm::mat4 proj = glm::perspective(FOV_Y, 4.0f / 3, ZNEAR, far);
+    const auto drawFrame = [&](int frame) {
+        // turning on the spot at head height, looking slightly down
+        const float angle = static_cast<float>(frame) * 0.05f;
+        const glm::vec3 position = start + glm::vec3(0, 0, 0.1f);
+        const glm::vec3 look(-std::cos(angle), std::sin(angle), -0.1f);
+        const glm::mat4 view = glm::lookAt(position, position + look, glm::vec3(0, 0, 1));
+
+        backend.ClearColor(.2f, 0.4f, 0.8f, 1.0f);
+        backend.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        scene.SetFocus(position, far);
+        scene.SetCamera(view, proj);
+        scene.Draw();
+    };
+
+    for (int frame = 0; frame < WARM_UP_FRAMES; ++frame) {
+        drawFrame(frame);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    backend.ResetCounts();
+    const auto begin = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) drawFrame(WARM_UP_FRAMES + frame);
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - begin;
+
+    const auto perFrame = [&](size_t count) { return static_cast<double>(count) / frames; };
+    const auto &culled = scene.GetCullStats();
+    std::cout << "map: " << side << "x" << side << ", " << frames << " frames\n"
+              << std::fixed << std::setprecision(3)
+              << "ms per frame:      " << elapsed.count() / frames << "\n"
+              << std::setprecision(1)
+              << "calls per frame:   " << perFrame(backend.Calls()) << "\n"
+              << "draws per frame:   " << perFrame(backend.Draws()) << "\n"
+              << "uniforms per frame: " << perFrame(backend.UniformUploads()) << "\n"
+              << "block uploads per frame: " << perFrame(backend.BlockUploads()) << "\n"
+              << "block binds per frame: " << perFrame(backend.BlockBinds()) << "\n"
+              << "binds per frame:   " << perFrame(backend.Binds()) << "\n"
+              << "KB per frame:      " << perFrame(backend.BytesUploaded()) / 1024 << "\n"
+              << "last frame chunks: " << culled.visibleChunks << " drawn, " << culled.culledChunks << " culled, "
+              << culled.hiddenChunks << " hidden\n";
+
+    scene.Release();
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <render/Transforms.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <gtc/matrix_transform.hpp>
+
+/**
+ * Times Transforms::computeAll against computeAllScalar over a frame's worth of instance models
+ */
+namespace {
+    template<typename F>
+    double secondsPerPass(F &&pass, int repeats) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; ++i) pass();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / repeats;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const size_t instances = argc > 1 ? std::stoul(argv[1]) : 4096;
+    const int repeats = 2000;
+
+    // keys and finishes scattered over a map, each turned and scaled as Scene draws them
+    std::vector<glm::mat4> models;
+    for (size_t i = 0; i < instances; ++i) {
+        const auto x = static_cast<float>(i % 64), y = static_cast<float>(i / 64);
+        glm::mat4 model = glm::translate(glm::mat4(1), glm::vec3(x, y, -0.3f));
+        model = glm::rotate(model, 0.01f * static_cast<float>(i), glm::vec3(0, 0, 1));
+        models.push_back(glm::scale(model, glm::vec3(0.3f)));
+    }
+    const glm::mat4 view = glm::lookAt(glm::vec3(-2, -2, 3), glm::vec3(32, 32, 0), glm::vec3(0, 0, 1));
+    const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 4.0f / 3, 0.01f, 100.0f);
+
+    std::vector<Transform> scalarTransforms(instances), simdTransforms(instances);
+    const double scalar = secondsPerPass([&] {
+        Transforms::computeAllScalar(view, proj, models, scalarTransforms);
+    }, repeats);
+    const double simd = secondsPerPass([&] {
+        Transforms::computeAll(view, proj, models, simdTransforms);
+    }, repeats);
+
+    // the scalar path may have its multiply-adds fused, so they only agree to rounding
+    for (size_t i = 0; i < instances; ++i) {
+        for (int column = 0; column < 3; ++column) {
+            for (int row = 0; row < 3; ++row) {
+                if (std::abs(simdTransforms[i].normal[column][row] - scalarTransforms[i].normal[column][row]) > 1e-4f) {
+                    std::cerr << "computeAll and computeAllScalar disagree" << std::endl;
+                    return 1;
+                }
+            }
+        }
+    }
+
+    std::cout << "instances:         " << instances << "\n"
+              << "computeAllScalar:  " << scalar * 1e6 << " us\n"
+              << "computeAll (" << Transforms::instructionSet() << "): " << simd * 1e6 << " us\n"
+              << "speedup:           " << scalar / simd << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <generate/MapGenerator.h>
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+/**
+ * Times counting the walls of a large generated map with per-cell lookups in column and row order, ForEachCell, and
+ * ForEachSpan, in each in-memory layout
+ */
+namespace {
+    template<typename F>
+    double secondsPerPass(F &&pass, int repeats) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; ++i) pass();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / repeats;
+    }
+
+    size_t wallsInSpan(std::span<const Cell> cells) {
+        // reads the raw bits (a Cell copied whole is not vectorized) and counts in 32 bits, so lanes stay narrow
+        uint32_t walls = 0;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            walls += (cells[i].bits & Cell::TAG_MASK) == static_cast<uint8_t>(Tag::WALL);
+        }
+        return walls;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const size_t cells = argc > 1 ? std::stoul(argv[1]) : 64 << 20;
+    const int repeats = 3;
+
+    const auto side = static_cast<size_t>(std::sqrt(static_cast<double>(cells)));
+    const Map rowMajor = MapGenerator::generateMap({.width = side, .height = side, .keys = 5, .doorsPerGate = 8});
+    std::cout << "cells: " << side * side << " (Mcells/s)\n"
+              << std::left << std::setw(10) << "layout" << std::right << std::setw(14) << "column order"
+              << std::setw(12) << "row order" << std::setw(14) << "ForEachCell" << std::setw(14) << "ForEachSpan"
+              << "\n";
+
+    for (const auto &[layout, name] : {std::pair{Layout::ROW_MAJOR, "row-major"}, std::pair{Layout::TILED, "tiled"},
+                                      std::pair{Layout::SPARSE, "sparse"}}) {
+        const Map map = rowMajor.WithLayout(layout);
+        size_t columnWalls = 0, rowWalls = 0, cellWalls = 0, spanWalls = 0;
+
+        const double column = secondsPerPass([&] {
+            for (size_t x = 0; x < map.width; ++x) {
+                for (size_t y = 0; y < map.height; ++y) columnWalls += map.GetElement(x, y).GetTag() == Tag::WALL;
+            }
+        }, repeats);
+        const double row = secondsPerPass([&] {
+            for (size_t y = 0; y < map.height; ++y) {
+                for (size_t x = 0; x < map.width; ++x) rowWalls += map.GetElement(x, y).GetTag() == Tag::WALL;
+            }
+        }, repeats);
+        const double cell = secondsPerPass([&] {
+            map.ForEachCell([&](size_t, size_t, Cell c) { cellWalls += c.GetTag() == Tag::WALL; });
+        }, repeats);
+        const double span = secondsPerPass([&] {
+            map.ForEachSpan([&](size_t, size_t, std::span<const Cell> c) { spanWalls += wallsInSpan(c); });
+        }, repeats);
+
+        if (columnWalls != rowWalls || rowWalls != cellWalls || cellWalls != spanWalls) {
+            std::cerr << "traversals of the " << name << " map disagree" << std::endl;
+            return 1;
+        }
+
+        const double megacells = static_cast<double>(side * side) / 1e6;
+        std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(14) << megacells / column << std::setw(12) << megacells / row
+                  << std::setw(14) << megacells / cell << std::setw(14) << megacells / span << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#version 330 core
+
+// per vertex, from the combined model buffer
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 inTexcoord;
+layout(location = 2) in vec3 inNormal;
+
+// per instance, see Transform and ModelInstance
+layout(location = 3) in mat4 instanceMVP;
+layout(location = 7) in mat4 instanceModelView;
+layout(location = 11) in mat3 instanceNormalMatrix;
+layout(location = 14) in vec3 instanceColor;
+layout(location = 15) in int instanceTexID;
+
+out vec3 Color;
+out vec3 vertNormal;
+out vec3 pos;
+out vec3 lightDir;
+out vec2 texcoord;
+flat out int texID;
+
+// the same for every draw of a frame, see FrameUniforms
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 proj;
+    vec4 inLightDir;
+};
+
+void main() {
+    Color = instanceColor;
+    texID = instanceTexID;
+    // the matrices are worked out once an instance on the CPU, see Transforms
+    gl_Position = instanceMVP * vec4(position,1.0);
+    pos = (instanceModelView * vec4(position,1.0)).xyz;
+    lightDir = inLightDir.xyz;
+    vertNormal = normalize(instanceNormalMatrix * inNormal);
+    texcoord = inTexcoord;
+}
@@ -11,7 +11,14 @@ out vec4 outColor;
 uniform sampler2D tex0;
 uniform sampler2D tex1;
 
-uniform int texID;
+// per draw, see DrawUniforms
+layout(std140) uniform Draw {
+    mat4 mvp;
+    mat4 modelView;
+    mat3 normalMatrix;
+    vec4 inColor;
+    int texID;
+};
 
 const float ambient = .3;
 void main() {
@@ -3,8 +3,6 @@
 in vec3 position;
 //in vec3 inColor;
 
-//const vec3 inColor = vec3(0.f,0.7f,0.f);
-const vec3 inLightDir = normalize(vec3(-1,1,-1));
 in vec3 inNormal;
 in vec2 inTexcoord;
 
@@ -14,17 +12,28 @@ out vec3 pos;
 out vec3 lightDir;
 out vec2 texcoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
-uniform vec3 inColor;
+// the same for every draw of a frame, see FrameUniforms
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 proj;
+    vec4 inLightDir;
+};
+
+// per draw, see DrawUniforms
+layout(std140) uniform Draw {
+    mat4 mvp;
+    mat4 modelView;
+    mat3 normalMatrix;
+    vec4 inColor;
+    int texID;
+};
 
 void main() {
-    Color = inColor;
-    gl_Position = proj * view * model * vec4(position,1.0);
-    pos = (view * model * vec4(position,1.0)).xyz;
-    lightDir = (view * vec4(inLightDir,0.0)).xyz; //It's a vector!
-    vec4 norm4 = transpose(inverse(view*model)) * vec4(inNormal,0.0);
-    vertNormal = normalize(norm4.xyz);
+    Color = inColor.rgb;
+    // the matrices are worked out once a draw on the CPU, see Transforms
+    gl_Position = mvp * vec4(position,1.0);
+    pos = (modelView * vec4(position,1.0)).xyz;
+    lightDir = inLightDir.xyz;
+    vertNormal = normalize(normalMatrix * inNormal);
     texcoord = inTexcoord;
 }
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+
+/**
+ * The key ids the player holds, one bit per id, so checking a door is a single bit test however many keys the map
+ * has. Several keys with the same id may be held; the bit clears when the last of them is used.
+ */
+class KeyInventory {
+private:
+    boost::dynamic_bitset<uint64_t> held;
+    std::vector<uint32_t> counts;
+
+public:
+    void Add(size_t id) {
+        if (id >= held.size()) {
+            held.resize(id + 1);
+            counts.resize(id + 1);
+        }
+        held.set(id);
+        counts[id] += 1;
+    }
+
+    [[nodiscard]] bool Holds(size_t id) const {
+        return id < held.size() && held.test(id);
+    }
+
+    /**
+     * Gives up one key with this id
+     * @return false if none is held
+     */
+    bool Use(size_t id) {
+        if (!Holds(id)) return false;
+        if (--counts[id] == 0) held.reset(id);
+        return true;
+    }
+
+    void Clear() {
+        held.clear();
+        counts.clear();
+    }
+};
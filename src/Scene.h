@@ -2,9 +2,24 @@
 
 #include <repr/Map.h>
 
+#include <cmath>
+#include <limits>
+#include <list>
+#include <optional>
+#include <tuple>
 #include <utility>
+#include <unordered_map>
 #include <unordered_set>
 #include "utils.h"
+#include "KeyInventory.h"
+#include "parse/MapWatcher.h"
+#include "render/ChunkRenderer.h"
+#include "render/DrawList.h"
+#include "render/InstanceRenderer.h"
+#include "render/Frustum.h"
+#include "render/PotentiallyVisibleSet.h"
+#include "render/RenderBackend.h"
+#include "render/UniformBlocks.h"
 
 struct TexturedModel {
     Model &model;
@@ -26,41 +41,151 @@ struct SceneKey {
     float angle = 0.0;
     size_t id;
     glm::vec3 location;
+    /** picked up, so it is no longer drawn at its origin */
+    bool taken = false;
+};
+
+/**
+ * What the last Scene::Draw left out because the camera could not see it
+ */
+struct CullStats {
+    size_t visibleChunks = 0;
+    /** outside the frustum */
+    size_t culledChunks = 0;
+    /** behind walls, going by the potentially visible set */
+    size_t hiddenChunks = 0;
+    /** keys on the floor and held */
+    size_t visibleKeys = 0;
+    size_t culledKeys = 0;
+    size_t hiddenKeys = 0;
 };
 
 class Scene {
 private:
+    // what a chunk holds spans from the bottom of its floors to the top of its walls
+    static constexpr float CHUNK_BOTTOM = -1.5f;
+    static constexpr float CHUNK_TOP = 0.5f;
+    static constexpr float FLOOR_TOP = -0.5f;
+    // half the size of a key or finish model, turned any way
+    static constexpr float ENTITY_RADIUS = 0.15f;
+    // maps up to this many cells have their potentially visible sets computed when the draw distance is set
+    static constexpr size_t PRECOMPUTE_CELLS = 64 * 64;
+
+    RenderBackend &backend;
     TextureData textures;
     Map &map;
     unsigned int shaderProgram;
-    GLint modelParam;
-    GLint textureIdParam;
-    GLint colorParam;
     glm::mat4 model;
+    // one per entry of map.index.keys, so the index finds the key of a key cell in constant time
     std::vector<SceneKey> keys;
-    std::unordered_set<SceneKey *> grabbedKeys;
+    // the keys picked up; a list so grabbedKeys stays valid as they are used
+    std::list<SceneKey> heldKeys;
+    // id -> the held keys with that id; inventory answers whether there are any
+    std::unordered_multimap<size_t, std::list<SceneKey>::iterator> grabbedKeys;
+    KeyInventory inventory;
+    // cells play emptied (taken keys, opened doors) -> what the map file has there, with its id
+    std::unordered_map<uint64_t, std::pair<Cell, size_t>> played;
+    // walls, floors and doors, a few draws per chunk
+    ChunkRenderer chunks;
+    // everything else, a draw per model
+    InstanceRenderer instances;
+    // the chunk batches of a frame, submitted sorted once they are all known
+    DrawList drawList;
+    StateCache glState;
+    // the camera and light for every program, and the uniforms of each chunk batch
+    UniformBlocks blocks;
+    // per draw of the list, where its uniforms are in the draw buffer
+    std::vector<size_t> drawOffsets;
+    // chunk meshes are built in map coordinates, so every chunk batch has the camera's transform
+    Transform chunkTransform = {};
+    Frustum frustum = {};
+    // for a finite draw distance the set can cover
+    std::optional<PotentiallyVisibleSet> pvs;
+    CullStats stats;
+    // scratch for culling, kept between frames so they are not reallocated
+    BoxList boxes;
+    std::vector<uint8_t> visible;
+    std::vector<ChunkView> inView;
+    std::vector<std::pair<Position, Cell>> cells;
+    std::vector<const SceneKey *> drawnKeys;
+    glm::vec3 focus = glm::vec3(0.0f);
+    float drawDistance = std::numeric_limits<float>::infinity();
 
 public:
-    Scene(const TextureData &data, Map &map, unsigned int shaderProgram) : textures(data), map(map), shaderProgram(shaderProgram) {
-        modelParam = glGetUniformLocation(shaderProgram, "model");
-        textureIdParam = glGetUniformLocation(shaderProgram, "texID");
-        colorParam = glGetUniformLocation(shaderProgram, "inColor");
+    /**
+     * Both programs read the camera from their Frame block, and the textured one a draw's model, colour and texture
+     * from its Draw block (see UniformBlocks), which are bound here.
+     * @param backend what every GL call of the scene goes through
+     * @param instancedProgram built from shaders/instanced-*.glsl, for what is not in a chunk mesh
+     * @param modelBuffer the vertex buffer of the combined models
+     */
+    Scene(RenderBackend &backend, const TextureData &data, Map &map, unsigned int shaderProgram,
+          unsigned int instancedProgram, unsigned int modelBuffer)
+            : backend(backend), textures(data), map(map), shaderProgram(shaderProgram),
+              chunks(backend, map, data.wallModel.model, shaderProgram),
+              instances(backend, instancedProgram, modelBuffer), blocks(backend) {
+        blocks.Attach(shaderProgram);
+        blocks.Attach(instancedProgram);
         model = glm::mat4(1);
+        Reload();
+    }
 
-        for (int x = 0; x < map.width; ++x) {
-            for (int y = 0; y < map.height; ++y) {
-                auto element = map.GetElement(x, y);
-                if (element.tag == Tag::KEY) {
-                    glm::vec3 location(x, y, -.25);
-                    SceneKey key = {
-                            .originX = x,
-                            .originY = y,
-                            .id = element.value.key.id,
-                            .location = location
-                    };
-                    keys.push_back(key);
+    /**
+     * Rebuilds everything taken from the map, dropping any keys that were held. Costs O(keys), not O(cells).
+     */
+    void Reload() {
+        played.clear();
+        heldKeys.clear();
+        grabbedKeys.clear();
+        inventory.Clear();
+        keys.clear();
+        keys.reserve(map.index.keys.size());
+        for (const auto &position : map.index.keys) keys.push_back(MakeKey(position));
+        chunks.InvalidateAll();
+        if (pvs) pvs->InvalidateAll();
+    }
+
+    /**
+     * Catches up with cells a MapWatcher changed (and the index it updated). Held keys stay held, and keys that were
+     * taken and doors that were opened stay so unless their cell was edited.
+     */
+    void ApplyChanges(const MapChanges &changes) {
+        if (changes.reloaded) {
+            Reload();
+            return;
+        }
+        if (changes.cells.empty()) return;
+
+        std::unordered_set<uint64_t> edited, taken;
+        for (const auto &change : changes.cells) {
+            const auto cell = CellKey(change.position.x, change.position.y);
+            const auto found = played.find(cell);
+            if (found != played.end()) {
+                // the watcher compares a reloaded row with the map, so cells that were played differ from the file
+                // whether or not they were edited; those that still match the file are played again
+                if (change.after == found->second.first &&
+                    map.GetId(change.position.x, change.position.y) == found->second.second) {
+                    map.SetElement(change.position.x, change.position.y, Tag::EMPTY);
+                    continue;
                 }
+                // played cells keep their index entries, which the watcher did not know to replace
+                map.index.Update(change.position, found->second.first, change.after);
+                played.erase(found);
             }
+            edited.insert(cell);
+            chunks.Invalidate(change.position.x, change.position.y);
+            if (pvs) pvs->Invalidate(change.position.x, change.position.y);
+        }
+        for (const auto &key : keys) {
+            if (key.taken) taken.insert(CellKey(key.originX, key.originY));
+        }
+
+        keys.clear();
+        for (const auto &position : map.index.keys) {
+            SceneKey key = MakeKey(position);
+            const auto cell = CellKey(key.originX, key.originY);
+            key.taken = taken.contains(cell) && !edited.contains(cell);
+            keys.push_back(key);
         }
     }
 
@@ -69,24 +194,62 @@ public:
     }
 
     glm::vec3 GetStartPosition() {
+        return StartPosition(map);
+    }
 
-        for (int x = 0; x < map.width; ++x) {
-            for (int y = 0; y < map.height; ++y) {
-                auto element = map.GetElement(x, y);
-                if (element.tag == Tag::START) {
-                    glm::vec3 res(x, y, 0.0);
-                    return res;
-                }
-            }
+    static glm::vec3 StartPosition(const Map &map) {
+        const auto &starts = map.index.starts;
+        if (starts.empty()) throw std::logic_error("no start position");
+
+        // of several starts the game has always used the leftmost, then topmost
+        const auto start = std::min_element(starts.begin(), starts.end(), [](const Position &a, const Position &b) {
+            return std::tie(a.x, a.y) < std::tie(b.x, b.y);
+        });
+        return glm::vec3(start->x, start->y, 0.0);
+    }
+
+
+    /**
+     * Uploads the camera, for every program, and transforms and culls the next Draw with it
+     */
+    void SetCamera(const glm::mat4 &view, const glm::mat4 &proj) {
+        blocks.SetFrame(view, proj);
+        instances.SetCamera(view, proj);
+        chunkTransform = Transforms::compute(view, proj, glm::mat4(1));
+        frustum = Frustum::FromMatrix(proj * view);
+    }
+
+    [[nodiscard]] const CullStats &GetCullStats() const {
+        return stats;
+    }
+
+    /**
+     * Only cells within distance of position are drawn from now on. For a paged map this is also all that gets loaded.
+     */
+    void SetFocus(glm::vec3 position, float distance) {
+        focus = position;
+        if (distance == drawDistance) return;
+
+        drawDistance = distance;
+        pvs.reset();
+        if (std::isfinite(distance) && distance <= PotentiallyVisibleSet::MAX_RADIUS) {
+            pvs.emplace(map, distance);
+            if (map.width * map.height <= PRECOMPUTE_CELLS) pvs->Precompute();
         }
-        throw std::logic_error("no start position");
     }
 
+    /**
+     * Blocks until the chunks the last Draw could not draw yet have meshes, so that the next Draw has every one of them.
+     * For drawing a single frame; the game instead draws cells in their place until they are ready.
+     */
+    void WaitForChunks() {
+        chunks.Wait();
+    }
 
     void UpdateGrabbedKeys(glm::vec3 position, float angle) {
-        for (const auto &item : grabbedKeys) {
-            item->location = position;
-            item->angle = angle;
+        for (auto &key : heldKeys) {
+            key.location = position;
+            key.angle = angle;
         }
     }
 
@@ -102,9 +265,9 @@ public:
         int iX = (int) std::round(x);
         int iY = (int) std::round(y);
 
-        Element element = map.GetElement(iX, iY);
+        Cell element = map.GetElement(iX, iY);
 
-        switch (element.tag) {
+        switch (element.GetTag()) {
             case Tag::KEY:
                 HandleKey(iX, iY);
                 return false;
@@ -114,7 +277,7 @@ public:
             case Tag::WALL:
                 return true;
             case Tag::DOOR:
-                return HandleDoor(element.value.door, iX, iY);
+                return HandleDoor({.id = map.GetId(iX, iY, element)}, iX, iY);
             case Tag::FINISH:
                 HandleFinish();
                 return true;
@@ -124,37 +287,97 @@ public:
 
 
     void Draw() {
-        for (int x = 0; x < map.width; ++x) {
-            for (int y = 0; y < map.height; ++y) {
-                auto element = map.GetElement(x, y);
-
-                auto fx = (float) x;
-                auto fy = (float) y;
-
-                switch (element.tag) {
-                    case Tag::FINISH:
-                        Draw(fx, fy, -.25, textures.endModel, 0.1, 0.9f, 0.0f, 0.2);
-                        break;
-                    case Tag::START:
-                    case Tag::EMPTY:
-                    case Tag::KEY: // keys are dynamic—we draw them elsewhere
-                        // no special drawing
-                        break;
-                    case Tag::DOOR:
-                        Draw(fx, fy, 0.0f, textures.doorModel, (float) element.value.door.id / 5.0f, 0.0f, 0.0f);
-                        break;
-                    case Tag::WALL:
-                        Draw(fx, fy, 0.0f, textures.wallModel);
-                        break;
-                }
-                Draw(fx, fy, -1.0f, textures.floorModel);
+        size_t x0 = 0, y0 = 0, x1 = map.width, y1 = map.height;
+        if (std::isfinite(drawDistance)) {
+            x0 = (size_t) std::max(0.0f, std::floor(focus.x - drawDistance));
+            y0 = (size_t) std::max(0.0f, std::floor(focus.y - drawDistance));
+            x1 = (size_t) std::max(0.0f, std::ceil(focus.x + drawDistance) + 1);
+            y1 = (size_t) std::max(0.0f, std::ceil(focus.y + drawDistance) + 1);
+        }
+
+        chunks.BeginFrame();
+
+        // the set says what walls hide, but not from above them
+        const bool occluding = pvs && focus.z < CHUNK_TOP;
+        const auto focusX = (size_t) std::max(0.0f, std::round(focus.x));
+        const auto focusY = (size_t) std::max(0.0f, std::round(focus.y));
+        const auto hidden = [&](size_t x, size_t y) {
+            return occluding && !pvs->Visible(focusX, focusY, (y >> CHUNK_BITS) * map.ChunksX() + (x >> CHUNK_BITS));
+        };
+
+        // the chunks in reach that walls do not hide are culled together, then the cells of those still drawn a cell
+        // at a time
+        stats = {};
+        boxes.Clear();
+        inView.clear();
+        map.ForEachChunkIn(x0, y0, x1, y1, [&](const ChunkView &chunk) {
+            if (hidden(chunk.x, chunk.y)) {
+                stats.hiddenChunks += 1;
+                return;
             }
+            // only where the chunk is gets used; a paged chunk's cells may be gone once the visit returns
+            inView.push_back(chunk);
+            AddCellBox(chunk.x, chunk.y, chunk.x + chunk.width, chunk.y + chunk.height, CHUNK_BOTTOM, CHUNK_TOP);
+        });
+        stats.visibleChunks = frustum.Cull(boxes, visible);
+        stats.culledChunks = inView.size() - stats.visibleChunks;
+        size_t kept = 0;
+        for (size_t i = 0; i < inView.size(); ++i) {
+            if (visible[i]) inView[kept++] = inView[i];
+        }
+        inView.resize(kept);
+
+        // a chunk with a current mesh takes a draw per material; the rest are queued as instances until theirs is built
+        drawList.Clear();
+        for (const auto &chunk : inView) {
+            const size_t number = (chunk.y >> CHUNK_BITS) * map.ChunksX() + (chunk.x >> CHUNK_BITS);
+            const glm::vec2 centre(chunk.x + chunk.width / 2.0f, chunk.y + chunk.height / 2.0f);
+            const glm::vec2 offset = centre - glm::vec2(focus);
+            const float depth = glm::dot(offset, offset);
+            if (chunks.Draw(number, [&](GLuint vao, const MeshBatch &batch) { Record(vao, batch, depth); })) continue;
+
+            DrawCells(std::max(x0, chunk.x), std::max(y0, chunk.y), std::min(x1, chunk.x + chunk.width),
+                      std::min(y1, chunk.y + chunk.height));
+        }
+        Submit();
+
+        for (const auto &finish : map.index.finishes) {
+            if (finish.x < x0 || finish.x >= x1 || finish.y < y0 || finish.y >= y1) continue;
+            if (map.GetElement(finish.x, finish.y).GetTag() != Tag::FINISH || hidden(finish.x, finish.y)) continue;
+            const glm::vec3 location(finish.x, finish.y, -.25);
+            if (!frustum.Intersects(location - ENTITY_RADIUS, location + ENTITY_RADIUS)) continue;
+            Draw(location.x, location.y, location.z, textures.endModel, 0.1, 0.9f, 0.0f, 0.2);
         }
 
-        for (const auto &key: keys) {
-            auto id = key.id;
-            Draw(key.location[0], key.location[1], key.location[2], textures.keyModel, (float) id / 5.0f, 0.0f, 0.0f, 0.2, -key.angle);
+        boxes.Clear();
+        drawnKeys.clear();
+        for (const auto &key : keys) {
+            if (key.taken) continue;
+            if (hidden(key.originX, key.originY)) {
+                stats.hiddenKeys += 1;
+                continue;
+            }
+            drawnKeys.push_back(&key);
+        }
+        for (const auto &key : heldKeys) drawnKeys.push_back(&key);
+        for (const auto *key : drawnKeys) boxes.Add(key->location - ENTITY_RADIUS, key->location + ENTITY_RADIUS);
+        stats.visibleKeys = frustum.Cull(boxes, visible);
+        stats.culledKeys = drawnKeys.size() - stats.visibleKeys;
+        for (size_t i = 0; i < drawnKeys.size(); ++i) {
+            if (visible[i]) DrawKey(*drawnKeys[i]);
         }
+
+        instances.Flush();
+        chunks.EndFrame();
+    }
+
+    /**
+     * Frees what the scene keeps on the GPU. Call before the GL context goes away.
+     */
+    void Release() {
+        chunks.Release();
+        instances.Release();
+        blocks.Release();
     }
 
 private:
@@ -167,78 +390,181 @@ private:
      * @return  True if collide else false
      */
     bool HandleDoor(const Door &door, int iX, int iY) {
-        for (const auto &grabbedKey : grabbedKeys) {
-            if (door.id == grabbedKey->id) {
-
-                // the grabbed grabbedKey disappears
-                grabbedKeys.erase(grabbedKey);
-
-                for (int i = 0; i < keys.size(); ++i) {
-                    auto &key = keys[i];
-                    if (key.originX == grabbedKey->originX && key.originY == grabbedKey->originY) {
-                        keys.erase(keys.begin() + i);
-                        goto end;
-                    }
-                }
+        if (!inventory.Use(door.id)) return true;
 
-                end:
+        // one grabbed key with the door's id disappears
+        const auto used = grabbedKeys.find(door.id);
+        heldKeys.erase(used->second);
+        grabbedKeys.erase(used);
 
-                for (const auto &key: keys) {
-                }
+        // the door disappears, and what is behind it can be seen
+        EmptyPlayed(iX, iY);
+        chunks.Invalidate(iX, iY);
+        if (pvs) pvs->OpenDoor(iX, iY);
 
+        return false;
+    }
 
-                // the door disappears
-                *map.GetElementRef(iX, iY) = Element::Empty();
+    /**
+     * Adds the box around cells [x0, x1) x [y0, y1), which are centred on their coordinates, from z0 up to z1
+     */
+    void AddCellBox(size_t x0, size_t y0, size_t x1, size_t y1, float z0, float z1) {
+        boxes.Add(glm::vec3((float) x0 - .5f, (float) y0 - .5f, z0), glm::vec3((float) x1 - .5f, (float) y1 - .5f, z1));
+    }
 
-                return false;
-            }
+    /**
+     * Queues the cells [x0, x1) x [y0, y1) of a chunk that has no current mesh, leaving out those the camera cannot see
+     */
+    void DrawCells(size_t x0, size_t y0, size_t x1, size_t y1) {
+        boxes.Clear();
+        cells.clear();
+        map.ForEachCellIn(x0, y0, x1, y1, [this](size_t x, size_t y, Cell cell) {
+            cells.emplace_back(Position{.x = (uint32_t) x, .y = (uint32_t) y}, cell);
+            const bool solid = cell.GetTag() == Tag::WALL || cell.GetTag() == Tag::DOOR;
+            AddCellBox(x, y, x + 1, y + 1, CHUNK_BOTTOM, solid ? CHUNK_TOP : FLOOR_TOP);
+        });
+        frustum.Cull(boxes, visible);
+        for (size_t i = 0; i < cells.size(); ++i) {
+            if (visible[i]) DrawCell(cells[i].first.x, cells[i].first.y, cells[i].second);
         }
-        return true;
     }
 
-    void HandleFinish() {
-        for (auto &item : map.elements) {
-            item = Element::Empty();
+    /**
+     * Draws a cell's wall or door and its floor, for a chunk whose mesh is not built yet. Finishes and keys are drawn
+     * from the index instead.
+     */
+    void DrawCell(size_t x, size_t y, Cell element) {
+        auto fx = (float) x;
+        auto fy = (float) y;
+
+        switch (element.GetTag()) {
+            case Tag::DOOR:
+                Draw(fx, fy, 0.0f, textures.doorModel, IdShade(map.GetId(x, y, element)), 0.0f, 0.0f);
+                break;
+            case Tag::WALL:
+                Draw(fx, fy, 0.0f, textures.wallModel);
+                break;
+            default:
+                break;
         }
+        Draw(fx, fy, -1.0f, textures.floorModel);
     }
 
-    void HandleKey(int iX, int iY) {
+    void Record(GLuint vao, const MeshBatch &batch, float depth) {
+        int32_t texID = -1;
+        glm::vec3 color(0.0f);
+        switch (batch.material) {
+            case Material::FLOOR:
+                texID = (int32_t) textures.floorModel.textureId;
+                break;
+            case Material::WALL:
+                texID = (int32_t) textures.wallModel.textureId;
+                break;
+            case Material::DOOR:
+                color = glm::vec3((float) batch.shade / DOOR_SHADES, 0.0f, 0.0f);
+                break;
+        }
+        drawList.Add(shaderProgram, vao, texID, color, (int32_t) batch.first, (int32_t) batch.count, depth);
+    }
 
-        SceneKey *key = nullptr;
-        for (auto &item : keys) {
-            if (item.originX == iX && item.originY == iY) {
-                key = &item;
-            }
+    /**
+     * Draws the recorded batches in sort order, making only the GL calls that change something. The uniforms of all
+     * of them go up in one upload first; sorting puts draws with the same ones next to each other, to share them.
+     */
+    void Submit() {
+        drawList.Sort();
+        drawOffsets.clear();
+        for (const auto &call : drawList.Calls()) {
+            const DrawUniforms uniforms = {
+                    .transform = chunkTransform,
+                    .color = glm::vec4(call.texID == -1 ? call.color : glm::vec3(0.0f), 0.0f),
+                    .texID = call.texID,
+            };
+            drawOffsets.push_back(blocks.AddDraw(uniforms));
         }
-        assert(key != nullptr);
-        grabbedKeys.insert(key);
-        *map.GetElementRef(iX, iY) = Element::Empty();
+        blocks.UploadDraws();
+
+        // whatever ran since the last frame may have changed anything
+        glState.Reset();
+        const auto calls = drawList.Calls();
+        for (size_t i = 0; i < calls.size(); ++i) {
+            const auto &call = calls[i];
+            if (glState.SetProgram(call.program)) backend.UseProgram(call.program);
+            if (glState.SetVertexArray(call.vertexArray)) backend.BindVertexArray(call.vertexArray);
+            if (glState.SetDrawBlock(drawOffsets[i])) blocks.BindDraw(drawOffsets[i]);
+            backend.DrawArrays(GL_TRIANGLES, call.first, call.count);
+        }
+    }
+
+    void DrawKey(const SceneKey &key) {
+        Draw(key.location[0], key.location[1], key.location[2], textures.keyModel, IdShade(key.id), 0.0f, 0.0f, 0.2, -key.angle);
+    }
+
+    SceneKey MakeKey(const Position &position) {
+        return {
+                .originX = (int) position.x,
+                .originY = (int) position.y,
+                .id = map.GetId(position.x, position.y),
+                .location = glm::vec3(position.x, position.y, -.25)
+        };
+    }
+
+    static uint64_t CellKey(int x, int y) {
+        return uint64_t(y) << 32 | uint32_t(x);
+    }
+
+    /**
+     * @return the red of a key or door, which only tells apart ids that differ modulo DOOR_SHADES
+     */
+    static float IdShade(size_t id) {
+        return (float) (id % DOOR_SHADES) / DOOR_SHADES;
+    }
+
+    void HandleFinish() {
+        map.Fill(Cell::Empty());
+        chunks.InvalidateAll();
+        if (pvs) pvs->InvalidateAll();
+    }
+
+    void HandleKey(int iX, int iY) {
+
+        const auto found = map.index.IndexOf({.x = (uint32_t) iX, .y = (uint32_t) iY});
+        assert(found.has_value());
+        SceneKey &key = keys[*found];
+        key.taken = true;
+        grabbedKeys.emplace(key.id, heldKeys.insert(heldKeys.end(), key));
+        inventory.Add(key.id);
+        EmptyPlayed(iX, iY);
     }
 
+    /**
+     * Empties a cell the player used up, remembering what it held for ApplyChanges
+     */
+    void EmptyPlayed(int x, int y) {
+        played.try_emplace(CellKey(x, y), map.GetElement(x, y), map.GetId(x, y));
+        // through SetElement, so that a larger id of the key or door goes with it
+        map.SetElement(x, y, Tag::EMPTY);
+    }
+
+    /**
+     * Queues a drawing of a model in a flat colour, for the next instances.Flush()
+     */
     void Draw(float x, float y, float z, const Model &model, float r, float g, float b, float scale = 1.0, float rotation = 0.0) {
-        SetColor(r, g, b);
         SetTranslation(x, y, z);
         SetScale(scale);
         SetRotation(rotation);
-        SendTransformations();
-        model.draw();
+        instances.Add(model, this->model, glm::vec3(r, g, b), -1);
         ResetModel();
     }
 
     void Draw(float x, float y, float z, const TexturedModel &texturedModel, float scale = 1.0, float rotation = 0.0) {
-        SetTexture(texturedModel.textureId);
         SetTranslation(x, y, z);
         SetScale(scale);
         SetRotation(rotation);
-        SendTransformations();
-        texturedModel.model.draw();
+        instances.Add(texturedModel.model, model, glm::vec3(0.0f), (int32_t) texturedModel.textureId);
         ResetModel();
     }
 
-    void SendTransformations() {
-        glUniformMatrix4fv(modelParam, 1, GL_FALSE, glm::value_ptr(model));
-    }
-
     void SetScale(float x) {
         model = glm::scale(model, glm::vec3(x, x, x));
     }
@@ -251,15 +577,5 @@ private:
         model = glm::rotate(model, angle, glm::vec3(0.0f, 0.0f, 1.0f));
     }
 
-    void SetTexture(int id) {
-        glUniform1i(textureIdParam, id);
-    }
-
-    void SetColor(float r, float g, float b) {
-        glm::vec3 colVec(r, g, b);
-        glUniform3fv(colorParam, 1, glm::value_ptr(colVec));
-        SetTexture(-1);
-    }
-
 };
 
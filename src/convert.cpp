@@ -0,0 +1,41 @@
+#include <cstring>
+#include <iostream>
+
+#include "parse/MapParser.h"
+#include "parse/MapBinary.h"
+#include "parse/MapCompressed.h"
+
+/**
+ * Converts a text map (maps/<name>.txt, or "-" for stdin) into the binary .mapb format, or the compressed .mapz format
+ * if the output ends in .mapz. --tiled stores a .mapb in chunks, which loads as a TILED map and can be paged.
+ */
+int main(int argc, char *argv[]) {
+    const bool tiled = argc == 4 && std::strcmp(argv[1], "--tiled") == 0;
+    if (argc != 3 && !tiled) {
+        std::cerr << "usage: " << argv[0] << " [--tiled] <map.txt> <map.mapb|map.mapz>" << std::endl;
+        return 1;
+    }
+    const char *input = argv[argc - 2];
+    const char *output = argv[argc - 1];
+
+    try {
+        const auto layout = tiled ? Layout::TILED : Layout::ROW_MAJOR;
+        Map map = MapParser::parseMap(input, layout);
+        std::cout << input << " -> " << output << " (" << map.width << "x" << map.height << ")" << std::endl;
+
+        if (!MapCompressed::isCompressedName(output)) {
+            MapBinary::writeMap(map, output, layout);
+            return 0;
+        }
+
+        const auto written = MapCompressed::writeMap(map, output);
+        MapCompressed::CompressionStats decoded;
+        MapCompressed::loadMap(output, Layout::ROW_MAJOR, &decoded);
+        std::cout << "compressed to " << written.compressedBytes << " bytes (" << written.Ratio() << " cells/byte), "
+                  << "decodes at " << decoded.CellsPerSecond() / 1e6 << " Mcells/s" << std::endl;
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
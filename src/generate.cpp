@@ -0,0 +1,65 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "generate/MapGenerator.h"
+
+namespace {
+    void usage(const char *program) {
+        std::cerr << "usage: " << program << " [--width N] [--height N] [--seed N] [--corridor N] [--horizontal P]"
+                  << " [--vertical P] [--loops P] [--keys N] [--doors N] <map.txt|->" << std::endl;
+    }
+}
+
+/**
+ * Writes a generated maze level in the text format, to a file or to stdout ("-") for piping into proj4 or map-convert
+ */
+int main(int argc, char *argv[]) {
+    MapGenerator::GeneratorOptions options;
+    std::string output;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (i + 1 == argc) {
+                output = arg;
+                break;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--width") options.width = std::stoul(value);
+            else if (arg == "--height") options.height = std::stoul(value);
+            else if (arg == "--seed") options.seed = std::stoull(value);
+            else if (arg == "--corridor") options.corridorWidth = std::stoul(value);
+            else if (arg == "--horizontal") options.horizontalBias = std::stod(value);
+            else if (arg == "--vertical") options.verticalBias = std::stod(value);
+            else if (arg == "--loops") options.loopChance = std::stod(value);
+            else if (arg == "--keys") options.keys = std::stoul(value);
+            else if (arg == "--doors") options.doorsPerGate = std::stoul(value);
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        if (output.empty()) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        if (output == "-") {
+            MapGenerator::generate(options, std::cout);
+            return 0;
+        }
+
+        std::ofstream file(output);
+        if (!file.is_open()) {
+            std::cerr << "File " << output << " is not open for writing" << std::endl;
+            return 1;
+        }
+        MapGenerator::generate(options, file);
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include "MapGenerator.h"
+
+#include <parse/MapParser.h>
+
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <vector>
+#include <boost/format.hpp>
+
+namespace {
+    /**
+     * mt19937_64's output is fixed by the standard, unlike the distributions', so maps match across platforms
+     */
+    class Random {
+    private:
+        std::mt19937_64 engine;
+
+    public:
+        explicit Random(uint64_t seed) : engine(seed) {}
+
+        /**
+         * @return true with probability p
+         */
+        bool Chance(double p) {
+            return static_cast<double>(engine() >> 11) * 0x1.0p-53 < p;
+        }
+
+        size_t Below(size_t n) {
+            return engine() % n;
+        }
+    };
+
+    /**
+     * Union-find over the set labels of one row of the maze
+     */
+    class RowSets {
+    private:
+        std::vector<uint32_t> parent;
+
+    public:
+        void Reset(size_t labels) {
+            parent.resize(labels);
+            std::iota(parent.begin(), parent.end(), 0);
+        }
+
+        uint32_t Find(uint32_t label) {
+            while (parent[label] != label) {
+                parent[label] = parent[parent[label]];
+                label = parent[label];
+            }
+            return label;
+        }
+
+        void Join(uint32_t a, uint32_t b) {
+            parent[Find(b)] = Find(a);
+        }
+    };
+
+    /**
+     * @param letter 'a' for a key, 'A' for a door
+     */
+    std::string idText(char letter, size_t id) {
+        if (id < 5) return {static_cast<char>(letter + id)};
+        return (boost::format{"%1%{%2%}"} % letter % id).str();
+    }
+
+    constexpr uint32_t NO_LABEL = UINT32_MAX;
+}
+
+namespace MapGenerator {
+    void generate(const GeneratorOptions &options, std::ostream &out) {
+        if (options.corridorWidth == 0) throw std::invalid_argument("Corridors must be at least one cell wide");
+
+        const size_t corridor = options.corridorWidth;
+        const size_t pitch = corridor + 1;
+        const size_t columns = options.width > 0 ? (options.width - 1) / pitch : 0;
+        const size_t rows = options.height > 0 ? (options.height - 1) / pitch : 0;
+        if (columns * rows < 2) {
+            const auto msg = boost::format{"A %1%x%2% map has no room for a start and a finish %3% wide"}
+                             % options.width % options.height % corridor;
+            throw std::invalid_argument(msg.str());
+        }
+        if (options.keys >= rows) {
+            const auto msg = boost::format{"%1% keys need more than %1% rows of corridors, the map has %2%"}
+                             % options.keys % rows;
+            throw std::invalid_argument(msg.str());
+        }
+        if (options.keys > 0 && (options.doorsPerGate == 0 || options.doorsPerGate > columns)) {
+            const auto msg = boost::format{"A gate needs between 1 and %1% doors, not %2%"} % columns
+                             % options.doorsPerGate;
+            throw std::invalid_argument(msg.str());
+        }
+
+        Random random(options.seed);
+
+        // band k is maze rows [bandStart(k), bandStart(k + 1)); its last row is closed by gate k
+        const auto bandStart = [&](size_t band) { return band * rows / (options.keys + 1); };
+
+        // (row, column) of key k, somewhere in band k but never on the start
+        std::vector<std::pair<size_t, size_t>> keyCells(options.keys);
+        for (size_t k = 0; k < options.keys; ++k) {
+            const size_t first = bandStart(k);
+            size_t row = first + random.Below(bandStart(k + 1) - first);
+            size_t column = random.Below(columns);
+            if (row == 0 && column == 0) {
+                if (columns > 1) {
+                    column = 1 + random.Below(columns - 1);
+                } else if (bandStart(1) > 1) {
+                    row = 1 + random.Below(bandStart(1) - 1);
+                } else {
+                    throw std::invalid_argument("There is no room for the first key beside the start");
+                }
+            }
+            keyCells[k] = {row, column};
+        }
+
+        out << options.width << " " << options.height << "\n";
+        const size_t padding = options.width - (1 + columns * pitch);
+        const std::string wallRow = std::string(options.width, 'W') + "\n";
+        out << wallRow;
+
+        // each column's set; [0, columns) continue a set from the row above, [columns, 2 columns) are new
+        std::vector<uint32_t> labels(columns);
+        std::iota(labels.begin(), labels.end(), columns);
+        RowSets sets;
+        std::vector<uint8_t> rightOpen(columns), downOpen(columns);
+        std::vector<uint32_t> seen(2 * columns), pick(2 * columns), compact(2 * columns);
+        std::vector<uint8_t> hasDown(2 * columns);
+        std::string line;
+
+        size_t band = 0;
+        for (size_t row = 0; row < rows; ++row) {
+            const bool last = row + 1 == rows;
+            const bool gate = !last && band < options.keys && row + 1 == bandStart(band + 1);
+            sets.Reset(2 * columns);
+
+            // join neighbours; the last row and gate rows join everything so nothing is cut off
+            for (size_t c = 0; c + 1 < columns; ++c) {
+                const bool separate = sets.Find(labels[c]) != sets.Find(labels[c + 1]);
+                const bool open = separate ? last || gate || random.Chance(options.horizontalBias)
+                                           : random.Chance(options.loopChance);
+                if (open && separate) sets.Join(labels[c], labels[c + 1]);
+                rightOpen[c] = open;
+            }
+            rightOpen[columns - 1] = false;
+
+            // every set continues downwards at least once, except at gates where only the doors lead down
+            std::fill(downOpen.begin(), downOpen.end(), 0);
+            if (gate) {
+                for (size_t doors = 0; doors < options.doorsPerGate;) {
+                    auto &door = downOpen[random.Below(columns)];
+                    if (!door) doors += 1;
+                    door = 1;
+                }
+            } else if (!last) {
+                std::fill(seen.begin(), seen.end(), 0);
+                std::fill(hasDown.begin(), hasDown.end(), 0);
+                for (size_t c = 0; c < columns; ++c) {
+                    const uint32_t set = sets.Find(labels[c]);
+                    // reservoir-sample the column a set falls back to
+                    if (random.Below(++seen[set]) == 0) pick[set] = c;
+                    downOpen[c] = random.Chance(options.verticalBias);
+                    hasDown[set] |= downOpen[c];
+                }
+                for (size_t c = 0; c < columns; ++c) {
+                    const uint32_t set = sets.Find(labels[c]);
+                    if (!hasDown[set]) downOpen[pick[set]] = hasDown[set] = 1;
+                }
+            }
+
+            const size_t keyColumn = band < options.keys && keyCells[band].first == row ? keyCells[band].second
+                                                                                       : columns;
+            for (size_t i = 0; i < corridor; ++i) {
+                line = "W";
+                for (size_t c = 0; c < columns; ++c) {
+                    std::string special;
+                    if (i == 0 && row == 0 && c == 0) special = "S";
+                    if (i == 0 && last && c == columns - 1) special = "G";
+                    if (i == 0 && c == keyColumn) special = idText('a', band);
+
+                    line += special;
+                    line.append(corridor - (special.empty() ? 0 : 1), '0');
+                    line += rightOpen[c] ? '0' : 'W';
+                }
+                line.append(padding, 'W');
+                line += '\n';
+                out << line;
+            }
+
+            line = "W";
+            const std::string door = gate ? idText('A', band) : "0";
+            for (size_t c = 0; c < columns; ++c) {
+                for (size_t j = 0; j < corridor; ++j) line += downOpen[c] ? door : "W";
+                line += 'W';
+            }
+            line.append(padding, 'W');
+            line += '\n';
+            out << line;
+
+            // sets carried down get compact labels again; closed-off columns start new ones. A band starts as a maze
+            // of its own, so it is connected without going back through the gate (which would take a second key).
+            std::fill(compact.begin(), compact.end(), NO_LABEL);
+            uint32_t nextLabel = 0;
+            for (size_t c = 0; c < columns; ++c) {
+                if (!downOpen[c] || gate) {
+                    labels[c] = columns + c;
+                    continue;
+                }
+                auto &label = compact[sets.Find(labels[c])];
+                if (label == NO_LABEL) label = nextLabel++;
+                labels[c] = label;
+            }
+            if (gate) band += 1;
+        }
+
+        for (size_t y = 1 + rows * pitch; y < options.height; ++y) out << wallRow;
+    }
+
+    std::string generateText(const GeneratorOptions &options) {
+        std::ostringstream out;
+        generate(options, out);
+        return out.str();
+    }
+
+    Map generateMap(const GeneratorOptions &options, Layout layout) {
+        return MapParser::parseText(generateText(options), layout);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <repr/Map.h>
+
+/**
+ * Seeded maze levels in the text map format, of any size.
+ *
+ * Mazes are made with Eller's algorithm, which decides one row at a time and only remembers the row above, so a
+ * 50k x 50k map streams out in O(width) memory. Every maze cell is a corridorWidth-wide square of floor with
+ * one-cell walls between them. The start is the top-left corridor and the finish the bottom-right one.
+ *
+ * With keys > 0 the maze is cut into keys + 1 horizontal bands. Band k is fully connected inside itself and closed
+ * off from band k + 1 by a gate of doors with id k, and key k lies somewhere in band k, so the level is always
+ * solvable and needs every key in order. Ids past 'e' are written in the extended a{N} / A{N} syntax.
+ *
+ * The same options and seed give the same map on every platform.
+ */
+namespace MapGenerator {
+    struct GeneratorOptions {
+        size_t width = 1024;
+        size_t height = 1024;
+        uint64_t seed = 5607;
+        /** floor cells across each corridor; walls are always one cell, so wider corridors mean fewer walls */
+        size_t corridorWidth = 1;
+        /** chance that two neighbouring corridors of a row are joined, giving long horizontal runs */
+        double horizontalBias = 0.5;
+        /** chance that a corridor also continues into the row below, beyond the one passage it must have */
+        double verticalBias = 0.3;
+        /** chance of knocking out any other wall, which adds loops; 0 gives a perfect maze */
+        double loopChance = 0.02;
+        /** key/door ids, each its own gate */
+        size_t keys = 0;
+        /** doors in each gate */
+        size_t doorsPerGate = 1;
+    };
+
+    /**
+     * Writes a map, header included, a row at a time
+     * @throws std::invalid_argument if the map is too small for one corridor, or for its keys
+     */
+    void generate(const GeneratorOptions &options, std::ostream &out);
+
+    std::string generateText(const GeneratorOptions &options);
+
+    Map generateMap(const GeneratorOptions &options, Layout layout = Layout::ROW_MAJOR);
+}
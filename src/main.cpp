@@ -3,6 +3,7 @@
 #include <SDL_opengl.h>
 #include <cstdio>
 #include <iostream>
+#include <optional>
 
 // Shader macro
 #define GLSL(src) "#version 150 core\n" #src
@@ -21,7 +22,11 @@
 #include "utils.h"
 #include "State.h"
 #include "Scene.h"
+#include "render/GLBackend.h"
 #include "parse/MapParser.h"
+#include "parse/MapBinary.h"
+#include "parse/MapCompressed.h"
+#include "parse/MapWatcher.h"
 
 using namespace std;
 
@@ -100,9 +105,25 @@ char window_title[] = "My OpenGL Program";
 
 float avg_render_time = 0;
 
+// how often a watched map file is checked for changes
+const unsigned int RELOAD_INTERVAL_MS = 500;
+
 int main(int argc, char *argv[]) {
 
-    Map map = MapParser::parseMap("maps/test.txt");
+    // a map path may be given, "-" reads a generated map from stdin. --paged streams a tiled binary map from disk
+    const std::string mapName = argc > 1 ? argv[1] : "maps/test.txt";
+    const bool paged = argc > 2 && std::string(argv[2]) == "--paged";
+    Map map = paged ? MapBinary::pageMap(mapName)
+                    : MapBinary::isBinaryName(mapName) ? MapBinary::loadMap(mapName)
+                    : MapCompressed::isCompressedName(mapName) ? MapCompressed::loadMap(mapName, Layout::TILED)
+                                                               : MapParser::parseMap(mapName, Layout::TILED);
+
+    // text maps are reloaded as they are saved, so levels can be edited while playing them
+    const bool watched = !paged && mapName != "-" && !MapBinary::isBinaryName(mapName) &&
+                         !MapCompressed::isCompressedName(mapName);
+    std::optional<MapWatcher> watcher;
+    if (watched) watcher.emplace(mapName);
+    unsigned int lastPoll = 0;
 
     Utils::SDLInit();
 
@@ -146,6 +167,7 @@ int main(int argc, char *argv[]) {
     glBufferData(GL_ARRAY_BUFFER, combined.GetNumberLines() * sizeof(float), combined.data.data(), GL_STATIC_DRAW); //upload vertices to vbo
 
     auto texturedShader = Utils::InitShader("shaders/textured-Vertex.glsl", "shaders/textured-Fragment.glsl");
+    auto instancedShader = Utils::InitShader("shaders/instanced-vertex.glsl", "shaders/instanced-fragment.glsl");
 
     GLint posAttrib = glGetAttribLocation(texturedShader, "position");
     glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), nullptr);
@@ -163,8 +185,15 @@ int main(int argc, char *argv[]) {
     glEnableVertexAttribArray(texAttrib);
     glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (3 * sizeof(float)));
 
-//    GLint uniView = glGetUniformLocation(texturedShader, "view");
-//    GLint uniProj = glGetUniformLocation(texturedShader, "proj");
+    // samplers and the textures behind them never change, so they are set once rather than every frame
+    glUseProgram(texturedShader);
+    glUniform1i(glGetUniformLocation(texturedShader, "tex0"), WOOD_TEXTURE_ID);
+    glUniform1i(glGetUniformLocation(texturedShader, "tex1"), BRICK_TEXTURE_ID);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, woodTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, brickTexture);
 
     glBindVertexArray(0); //Unbind the VAO in case we want to create brickCube new one
 
@@ -188,7 +217,10 @@ int main(int argc, char *argv[]) {
             .doorModel = cubeModel,
     };
 
-    Scene scene(texturedData, map, texturedShader);
+    // everything drawn each frame goes through the backend; the set-up above is made once, with GL directly. The scene
+    // binds the programs' uniform blocks, which take the camera and per-draw uniforms from then on
+    GLBackend gl;
+    Scene scene(gl, texturedData, map, texturedShader, instancedShader, vbo[0]);
 
 
     State state{
@@ -264,28 +296,27 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        if (watcher && t_start - lastPoll >= RELOAD_INTERVAL_MS) {
+            lastPoll = t_start;
+            try {
+                scene.ApplyChanges(watcher->Poll(map));
+            } catch (const std::exception &e) {
+                std::cerr << "Not reloading " << mapName << ": " << e.what() << std::endl;
+            }
+        }
+
         auto keyPosition = state.camPosition + dKey;
         scene.UpdateGrabbedKeys(keyPosition, state.angle);
 
-        // Clear the screen to default color
-        glClearColor(.2f, 0.4f, 0.8f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glUseProgram(texturedShader); //Set the active shader (only one can be used at brickCube time)
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, woodTexture);
-        glUniform1i(glGetUniformLocation(texturedShader, "tex0"), WOOD_TEXTURE_ID);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, brickTexture);
-        glUniform1i(glGetUniformLocation(texturedShader, "tex1"), BRICK_TEXTURE_ID);
-
-        unsigned int t_now = SDL_GetTicks();
+        // nothing past the far plane can be seen, so neither draw nor load it
+        scene.SetFocus(state.camPosition, ZFAR);
+        if (map.paged) {
+            map.paged->Focus(state.camPosition[0], state.camPosition[1], dX, dY, ZFAR);
+        }
 
-        glm::mat4 model = glm::mat4(1);
-        GLint modelLoc = glGetUniformLocation(texturedShader, "model");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        // Clear the screen to default color
+        gl.ClearColor(.2f, 0.4f, 0.8f, 1.0f);
+        gl.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glm::vec3 center = state.camPosition + lookDir;
         glm::vec3 up(0.0f, 0.0f, 1.0f);
@@ -293,15 +324,10 @@ int main(int argc, char *argv[]) {
         // set view matrix
         glm::mat4 view = glm::lookAt(state.camPosition, center, up);
 
-        GLint uniView = glGetUniformLocation(texturedShader, "view");
-        glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(view));
-
         // Set Perspective ::: zNear zFar
         glm::mat4 proj = glm::perspective(FOV_Y, aspect, ZNEAR, ZFAR);
-        GLint uniProj = glGetUniformLocation(texturedShader, "proj");
-        glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
-
-        glBindVertexArray(vao);
+        // one upload of the Frame block, which both programs read
+        scene.SetCamera(view, proj);
 
         scene.Draw();
 
@@ -311,7 +337,9 @@ int main(int argc, char *argv[]) {
         char update_title[100];
         unsigned int time_per_frame = t_end - t_start;
         avg_render_time = .98f * avg_render_time + .02f * static_cast<float>(time_per_frame); //Weighted average for smoothing
-        sprintf(update_title, "%s [Update: %3.0f ms]\n", window_title, static_cast<double>(avg_render_time));
+        const auto &culled = scene.GetCullStats();
+        sprintf(update_title, "%s [Update: %3.0f ms, chunks %zu drawn %zu culled %zu hidden]\n", window_title,
+                static_cast<double>(avg_render_time), culled.visibleChunks, culled.culledChunks, culled.hiddenChunks);
         SDL_SetWindowTitle(window, update_title);
 
         t_prev = t_start;
@@ -319,7 +347,9 @@ int main(int argc, char *argv[]) {
 
 
     //Clean Up
+    scene.Release();
     glDeleteProgram(texturedShader);
+    glDeleteProgram(instancedShader);
     glDeleteBuffers(1, vbo);
     glDeleteVertexArrays(1, &vao);
 
@@ -0,0 +1,205 @@
+#include "CellClassifier.h"
+
+#include <algorithm>
+#include <charconv>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+#include <immintrin.h>
+
+#endif
+
+namespace {
+#if defined(__AVX2__)
+    using Vector = __m256i;
+
+    inline Vector load(const char *p) { return _mm256_loadu_si256(reinterpret_cast<const Vector *>(p)); }
+
+    inline void store(Cell *p, Vector v) { _mm256_storeu_si256(reinterpret_cast<Vector *>(p), v); }
+
+    inline Vector splat(char c) { return _mm256_set1_epi8(c); }
+
+    inline Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+
+    inline Vector minimum(Vector a, Vector b) { return _mm256_min_epu8(a, b); }
+
+    inline Vector sub(Vector a, Vector b) { return _mm256_sub_epi8(a, b); }
+
+    inline Vector add(Vector a, Vector b) { return _mm256_add_epi8(a, b); }
+
+    inline Vector both(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+
+    inline Vector either(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+
+    inline uint32_t mask(Vector v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+
+    constexpr size_t LANES = 32;
+    constexpr auto NAME = "AVX2";
+#elif defined(__SSE2__)
+    using Vector = __m128i;
+
+    inline Vector load(const char *p) { return _mm_loadu_si128(reinterpret_cast<const Vector *>(p)); }
+
+    inline void store(Cell *p, Vector v) { _mm_storeu_si128(reinterpret_cast<Vector *>(p), v); }
+
+    inline Vector splat(char c) { return _mm_set1_epi8(c); }
+
+    inline Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+
+    inline Vector minimum(Vector a, Vector b) { return _mm_min_epu8(a, b); }
+
+    inline Vector sub(Vector a, Vector b) { return _mm_sub_epi8(a, b); }
+
+    inline Vector add(Vector a, Vector b) { return _mm_add_epi8(a, b); }
+
+    inline Vector both(Vector a, Vector b) { return _mm_and_si128(a, b); }
+
+    inline Vector either(Vector a, Vector b) { return _mm_or_si128(a, b); }
+
+    inline uint32_t mask(Vector v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+
+    constexpr size_t LANES = 16;
+    constexpr auto NAME = "SSE2";
+#else
+    constexpr size_t LANES = 0;
+    constexpr auto NAME = "scalar";
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+    inline Vector cell(Cell c) {
+        return splat(static_cast<char>(c.bits));
+    }
+
+    /**
+     * @return lanes holding first + 0..4 (as 0xFF), with the offset from first in `offset`
+     */
+    inline Vector inRange(Vector characters, char first, Vector &offset) {
+        offset = sub(characters, splat(first));
+        return equal(minimum(offset, splat(4)), offset);
+    }
+
+    /**
+     * Classifies LANES characters at once
+     * @return bit i set if character i is invalid
+     */
+    inline uint32_t classifyVector(const char *characters, Cell *out) {
+        const Vector v = load(characters);
+
+        const Vector empty = equal(v, splat('0'));
+        const Vector start = equal(v, splat('S'));
+        const Vector finish = equal(v, splat('G'));
+        const Vector wall = equal(v, splat('W'));
+        Vector keyId, doorId;
+        const Vector key = inRange(v, 'a', keyId);
+        const Vector door = inRange(v, 'A', doorId);
+
+        const Vector valid = either(either(either(empty, start), either(finish, wall)), either(key, door));
+        const uint32_t invalid = ~mask(valid) & (LANES == 32 ? 0xFFFFFFFFU : 0xFFFFU);
+        if (invalid != 0 || out == nullptr) return invalid;
+
+        // the id goes above the tag bits; doubling a byte three times shifts it without crossing lanes
+        Vector id = either(both(key, keyId), both(door, doorId));
+        for (size_t i = 0; i < Cell::TAG_BITS; ++i) id = add(id, id);
+
+        const Vector tags = either(
+                either(both(empty, cell(Cell::Empty())), both(start, cell(Cell::Start()))),
+                either(either(both(finish, cell(Cell::Finish())), both(wall, cell(Cell::Wall()))),
+                       either(both(key, cell(Cell::Key(0))), both(door, cell(Cell::Door(0))))));
+        store(out, either(tags, id));
+        return 0;
+    }
+
+#endif
+
+    /**
+     * Reads the "{N}" that follows an 'a' or 'A' at pos
+     * @return the byte after the closing brace, or pos if there is no valid id there
+     */
+    size_t readExtendedId(std::string_view line, size_t pos, uint32_t &id) {
+        if (pos == 0 || line[pos] != '{' || (line[pos - 1] != 'a' && line[pos - 1] != 'A')) return pos;
+
+        const char *begin = line.data() + pos + 1;
+        const char *end = line.data() + line.size();
+        const auto [last, error] = std::from_chars(begin, end, id);
+        if (error != std::errc() || last == end || *last != '}' || id > MAX_KEY_ID) return pos;
+        return last + 1 - line.data();
+    }
+}
+
+namespace CellClassifier {
+    std::optional<Cell> findElement(char c) {
+        switch (c) {
+            case '0':
+                return Cell::Empty();
+            case 'S':
+                return Cell::Start();
+            case 'G':
+                return Cell::Finish();
+            case 'W':
+                return Cell::Wall();
+            default:
+                break;
+        }
+
+        if ('a' <= c && c <= 'e') return Cell::Key(c - 'a');
+        if ('A' <= c && c <= 'E') return Cell::Door(c - 'A');
+
+        return {};
+    }
+
+    size_t classifyScalar(const char *characters, size_t count, Cell *out) {
+        for (size_t i = 0; i < count; ++i) {
+            const auto elem = findElement(characters[i]);
+            if (!elem.has_value()) return i;
+            if (out != nullptr) out[i] = elem.value();
+        }
+        return count;
+    }
+
+    size_t classify(const char *characters, size_t count, Cell *out) {
+        size_t i = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+        for (; i + LANES <= count; i += LANES) {
+            if (classifyVector(characters + i, out != nullptr ? out + i : nullptr) != 0) {
+                // let the scalar path store the cells before the bad character and find it
+                return i + classifyScalar(characters + i, LANES, out != nullptr ? out + i : nullptr);
+            }
+        }
+#endif
+        const size_t valid = classifyScalar(characters + i, count - i, out != nullptr ? out + i : nullptr);
+        return i + valid;
+    }
+
+    DecodedRow decodeRow(std::string_view line, uint32_t y, Cell *out, size_t capacity, std::vector<ExtendedId> &ids) {
+        size_t x = 0;
+        size_t pos = 0;
+        while (pos < line.size()) {
+            const bool storing = out != nullptr && x < capacity;
+            const size_t count = storing ? std::min(line.size() - pos, capacity - x) : line.size() - pos;
+            const size_t valid = classify(line.data() + pos, count, storing ? out + x : nullptr);
+            x += valid;
+            pos += valid;
+            if (valid == count) continue;
+
+            // anything else has to be the id of the key or door just before it
+            uint32_t id;
+            const size_t next = readExtendedId(line, pos, id);
+            if (next == pos) return {.cells = x, .invalidByte = pos};
+
+            if (out != nullptr && x - 1 < capacity) {
+                const Tag tag = line[pos - 1] == 'a' ? Tag::KEY : Tag::DOOR;
+                out[x - 1] = Cell::Of(tag, std::min<size_t>(id, Cell::EXTENDED_ID));
+                if (id >= Cell::EXTENDED_ID) {
+                    ids.push_back({.position = {.x = static_cast<uint32_t>(x - 1), .y = y}, .id = id});
+                }
+            }
+            pos = next;
+        }
+        return {.cells = x};
+    }
+
+    const char *instructionSet() {
+        return NAME;
+    }
+}
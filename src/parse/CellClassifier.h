@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <repr/Map.h>
+
+/**
+ * Turns map characters into cells
+ */
+namespace CellClassifier {
+    /**
+     *
+     * @param c The character to parse
+     * @return a packed cell if valid else empty
+     */
+    std::optional<Cell> findElement(char c);
+
+    /**
+     * Validates characters and stores their cells, one at a time through findElement
+     * @param out where the cells go, or nullptr to only validate
+     * @return the index of the first invalid character, or count if they are all valid
+     */
+    size_t classifyScalar(const char *characters, size_t count, Cell *out);
+
+    /**
+     * Same as classifyScalar, but 32 (AVX2) or 16 (SSE2) characters at a time when built for them
+     */
+    size_t classify(const char *characters, size_t count, Cell *out);
+
+    struct DecodedRow {
+        /** how many cells the row holds */
+        size_t cells;
+        /** the byte offset of the first invalid character, if any; cells then counts those before it */
+        std::optional<size_t> invalidByte;
+    };
+
+    /**
+     * Decodes one row of a text map. Besides the one-character cells a row may hold extended ids: a{N} is key N and
+     * A{N} door N, for any N up to MAX_KEY_ID.
+     * @param y the row, for the positions in ids
+     * @param out room for `capacity` cells, or nullptr; cells past it are only validated
+     * @param ids receives the ids of stored cells too large to fit in them
+     */
+    DecodedRow decodeRow(std::string_view line, uint32_t y, Cell *out, size_t capacity, std::vector<ExtendedId> &ids);
+
+    /**
+     * @return the instruction set classify was built with
+     */
+    const char *instructionSet();
+}
@@ -0,0 +1,241 @@
+#include "MapBinary.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <boost/format.hpp>
+
+namespace {
+    void writePositions(std::ofstream &file, const std::vector<Position> &positions) {
+        file.write(reinterpret_cast<const char *>(positions.data()),
+                   static_cast<std::streamsize>(positions.size() * sizeof(Position)));
+    }
+
+    std::vector<Position> readPositions(const Position *&from, uint64_t count) {
+        std::vector<Position> positions(from, from + count);
+        from += count;
+        return positions;
+    }
+
+    void invalid(const std::string &name, const char *reason) {
+        const auto msg = boost::format{"File %1% is not a valid binary map: %2%"} % name % reason;
+        throw std::invalid_argument(msg.str());
+    }
+
+    uint64_t positionCount(const MapBinary::MapBinaryHeader &header) {
+        return header.startCount + header.finishCount + header.keyCount + header.doorCount;
+    }
+
+    /**
+     * Checks that everything the header describes fits in a file of `size` bytes
+     */
+    void validate(const MapBinary::MapBinaryHeader &header, uint64_t size, const std::string &name) {
+        if (std::memcmp(header.magic, MapBinary::MAGIC, sizeof MapBinary::MAGIC) != 0) invalid(name, "bad magic");
+        if (header.version != MapBinary::VERSION) invalid(name, "unsupported version");
+        if (header.layout != static_cast<uint32_t>(Layout::ROW_MAJOR) &&
+            header.layout != static_cast<uint32_t>(Layout::TILED)) {
+            invalid(name, "unsupported layout");
+        }
+
+        // positions are 32-bit, and the stored cells, chunk padding included, must be countable
+        if (header.width > UINT32_MAX || header.height > UINT32_MAX) invalid(name, "dimensions overflow");
+        const uint64_t chunksX = (header.width + CHUNK_MASK) >> CHUNK_BITS;
+        const uint64_t chunksY = (header.height + CHUNK_MASK) >> CHUNK_BITS;
+        if (chunksX * chunksY > UINT64_MAX / CHUNK_CELLS) invalid(name, "dimensions overflow");
+
+        // each list is checked against what is left on its own, so a huge count cannot wrap the total
+        uint64_t room = (size - sizeof header) / sizeof(Position);
+        for (const uint64_t count : {header.startCount, header.finishCount, header.keyCount, header.doorCount}) {
+            if (count > room) invalid(name, "index runs past the end");
+            room -= count;
+        }
+        const uint64_t positions = positionCount(header);
+        if (header.cellsOffset < sizeof header + positions * sizeof(Position)) invalid(name, "cells overlap index");
+
+        const uint64_t stored = MapBinary::storedCells(header);
+        if (header.cellsOffset > size || size - header.cellsOffset < stored) invalid(name, "cells run past the end");
+        if (header.extendedCount > (size - header.cellsOffset - stored) / sizeof(ExtendedId)) {
+            invalid(name, "extended ids run past the end");
+        }
+    }
+
+    uint64_t extendedOffset(const MapBinary::MapBinaryHeader &header) {
+        return header.cellsOffset + MapBinary::storedCells(header);
+    }
+
+    void readExtendedIds(Map &map, const ExtendedId *ids, uint64_t count, const std::string &name) {
+        for (uint64_t i = 0; i < count; ++i) {
+            const auto &[position, id] = ids[i];
+            if (position.x >= map.width || position.y >= map.height || id > MAX_KEY_ID) {
+                invalid(name, "extended id out of range");
+            }
+            map.extendedIds[position.y * map.width + position.x] = id;
+        }
+    }
+
+    /**
+     * Checks that every cell has one of the tags, so that a corrupt file cannot hand out a Tag past EMPTY
+     */
+    void validateCells(std::span<const Cell> cells, const std::string &name) {
+        if (!Cell::AllTagged(cells)) invalid(name, "bad cell tag");
+    }
+
+    MapIndex readIndex(const MapBinary::MapBinaryHeader &header, const char *afterHeader, const std::string &name) {
+        // the index is tiny next to the grid, so it is copied out rather than aliased
+        const auto *positions = reinterpret_cast<const Position *>(afterHeader);
+        MapIndex index;
+        index.starts = readPositions(positions, header.startCount);
+        index.finishes = readPositions(positions, header.finishCount);
+        index.keys = readPositions(positions, header.keyCount);
+        index.doors = readPositions(positions, header.doorCount);
+        for (const auto *list : {&index.starts, &index.finishes, &index.keys, &index.doors}) {
+            for (const auto &position : *list) {
+                if (position.x >= header.width || position.y >= header.height) invalid(name, "index out of range");
+            }
+        }
+        index.BuildLookup();
+        return index;
+    }
+}
+
+namespace MapBinary {
+    uint64_t storedCells(const MapBinaryHeader &header) {
+        if (header.layout == static_cast<uint32_t>(Layout::TILED)) {
+            const uint64_t chunksX = (header.width + CHUNK_MASK) >> CHUNK_BITS;
+            const uint64_t chunksY = (header.height + CHUNK_MASK) >> CHUNK_BITS;
+            return chunksX * chunksY * CHUNK_CELLS;
+        }
+        return header.width * header.height;
+    }
+
+    void writeMap(const Map &map, const std::string &name, Layout layout) {
+        if (layout != Layout::ROW_MAJOR && layout != Layout::TILED) {
+            throw std::invalid_argument("Binary maps are stored ROW_MAJOR or TILED");
+        }
+        if (map.layout != layout) {
+            writeMap(map.WithLayout(layout), name, layout);
+            return;
+        }
+
+        std::ofstream file(name, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open()) {
+            const auto msg = boost::format{"File %1% is not open for writing"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+
+        const auto &index = map.index;
+        const auto extendedIds = map.ExtendedIds();
+        MapBinaryHeader header = {
+                .version = VERSION,
+                .layout = static_cast<uint32_t>(layout),
+                .width = map.width,
+                .height = map.height,
+                .startCount = index.starts.size(),
+                .finishCount = index.finishes.size(),
+                .keyCount = index.keys.size(),
+                .doorCount = index.doors.size(),
+                .extendedCount = extendedIds.size(),
+        };
+        std::memcpy(header.magic, MAGIC, sizeof MAGIC);
+
+        const uint64_t positionsEnd = sizeof header + positionCount(header) * sizeof(Position);
+        header.cellsOffset = (positionsEnd + CELL_ALIGNMENT - 1) / CELL_ALIGNMENT * CELL_ALIGNMENT;
+
+        file.write(reinterpret_cast<const char *>(&header), sizeof header);
+        writePositions(file, index.starts);
+        writePositions(file, index.finishes);
+        writePositions(file, index.keys);
+        writePositions(file, index.doors);
+
+        const std::string padding(header.cellsOffset - positionsEnd, '\0');
+        file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        file.write(reinterpret_cast<const char *>(map.elements.data()),
+                   static_cast<std::streamsize>(map.elements.size()));
+        file.write(reinterpret_cast<const char *>(extendedIds.data()),
+                   static_cast<std::streamsize>(extendedIds.size() * sizeof(ExtendedId)));
+
+        if (!file) {
+            const auto msg = boost::format{"Could not write binary map %1%"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+    }
+
+    Map loadMap(const std::string &name) {
+        auto file = std::make_shared<MappedFile>(name);
+        char *data = file->Data();
+        const uint64_t size = file->Size();
+
+        if (size < sizeof(MapBinaryHeader)) invalid(name, "too short for a header");
+
+        MapBinaryHeader header{};
+        std::memcpy(&header, data, sizeof header);
+        validate(header, size, name);
+
+        const auto layout = static_cast<Layout>(header.layout);
+        const std::span cells(reinterpret_cast<Cell *>(data + header.cellsOffset), storedCells(header));
+        validateCells(cells, name);
+        Map map = {
+                .width = header.width,
+                .height = header.height,
+                .elements = cells,
+                .storage = file,
+                .index = readIndex(header, data + sizeof header, name),
+                .layout = layout,
+                .tiling = layout == Layout::TILED ? Tiling::ZOrder(header.width, header.height) : Tiling{},
+        };
+        std::vector<ExtendedId> ids(header.extendedCount);
+        std::memcpy(ids.data(), data + extendedOffset(header), ids.size() * sizeof(ExtendedId));
+        readExtendedIds(map, ids.data(), ids.size(), name);
+        return map;
+    }
+
+    Map pageMap(const std::string &name, PagingOptions options) {
+        std::ifstream file(name, std::ios::binary);
+
+        if (!file.is_open()) {
+            const auto msg = boost::format{"File %1% is not open for reading"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+
+        file.seekg(0, std::ios::end);
+        const auto size = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+
+        MapBinaryHeader header{};
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof header)) invalid(name, "too short for a header");
+        validate(header, size, name);
+        if (header.layout != static_cast<uint32_t>(Layout::TILED)) {
+            invalid(name, "only TILED binary maps can be paged (map-convert --tiled)");
+        }
+
+        std::vector<char> positions(positionCount(header) * sizeof(Position));
+        if (!file.read(positions.data(), static_cast<std::streamsize>(positions.size()))) {
+            invalid(name, "could not read the index");
+        }
+
+        Tiling tiling = Tiling::ZOrder(header.width, header.height);
+        auto chunks = std::make_shared<PagedChunks>(name, header.cellsOffset, tiling, options);
+
+        Map map = {
+                .width = header.width,
+                .height = header.height,
+                .storage = chunks,
+                .paged = chunks,
+                .index = readIndex(header, positions.data(), name),
+                .layout = Layout::PAGED,
+                .tiling = std::move(tiling),
+        };
+
+        std::vector<ExtendedId> ids(header.extendedCount);
+        file.seekg(static_cast<std::streamoff>(extendedOffset(header)));
+        const auto idBytes = static_cast<std::streamsize>(ids.size() * sizeof(ExtendedId));
+        if (!file.read(reinterpret_cast<char *>(ids.data()), idBytes)) invalid(name, "could not read the extended ids");
+        readExtendedIds(map, ids.data(), ids.size(), name);
+        return map;
+    }
+
+    bool isBinaryName(const std::string &name) {
+        return name.ends_with(".mapb");
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <repr/Map.h>
+#include <repr/PagedChunks.h>
+
+/**
+ * Binary maps (.mapb) are a pre-validated form of the text format that loads without parsing.
+ *
+ * Layout, all integers native-endian:
+ *   MapBinaryHeader
+ *   Position[startCount + finishCount + keyCount + doorCount]   the MapIndex lists, in that order
+ *   padding up to cellsOffset (a multiple of CELL_ALIGNMENT)
+ *   Cell[storedCells(header)]                                   in the header's layout, ROW_MAJOR or TILED
+ *   ExtendedId[extendedCount]                                   Map::extendedIds, in row-major order
+ *
+ * TILED files store whole chunks, padding included, in Z-order; they are what PAGED maps read from.
+ */
+namespace MapBinary {
+    constexpr char MAGIC[4] = {'M', 'A', 'P', 'B'};
+    constexpr uint32_t VERSION = 3;
+    constexpr uint64_t CELL_ALIGNMENT = 64;
+
+    struct MapBinaryHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t layout;
+        uint32_t reserved;
+        uint64_t width;
+        uint64_t height;
+        uint64_t startCount;
+        uint64_t finishCount;
+        uint64_t keyCount;
+        uint64_t doorCount;
+        uint64_t cellsOffset;
+        uint64_t extendedCount;
+    };
+
+    /**
+     * @return how many cells follow cellsOffset
+     */
+    uint64_t storedCells(const MapBinaryHeader &header);
+
+    /**
+     * Writes the map, rearranged into `layout` (ROW_MAJOR or TILED) if it is not already
+     */
+    void writeMap(const Map &map, const std::string &name, Layout layout = Layout::ROW_MAJOR);
+
+    /**
+     * Maps a .mapb file and serves the Map's cells straight from the (copy-on-write) mapping
+     */
+    Map loadMap(const std::string &name);
+
+    /**
+     * Opens a TILED .mapb file as a PAGED map, which only keeps the chunks in use in memory
+     */
+    Map pageMap(const std::string &name, PagingOptions options = {});
+
+    /**
+     * @return true if name ends in .mapb
+     */
+    bool isBinaryName(const std::string &name);
+}
@@ -0,0 +1,253 @@
+#include "MapCompressed.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <boost/format.hpp>
+
+namespace {
+    void invalid(const char *reason) {
+        const auto msg = boost::format{"Not a valid compressed map: %1%"} % reason;
+        throw std::invalid_argument(msg.str());
+    }
+
+    /**
+     * Reads a stream through a fixed buffer, so memory use does not depend on the size of the map
+     */
+    class ByteReader {
+    private:
+        std::istream &stream;
+        char buffer[1 << 16];
+        size_t pos = 0, end = 0;
+
+    public:
+        uint64_t consumed = 0;
+
+        explicit ByteReader(std::istream &stream) : stream(stream) {}
+
+        /**
+         * @param part what is being read, for the error if the stream ends first
+         */
+        uint8_t Next(const char *part = "ends before its last row") {
+            if (pos == end) {
+                stream.read(buffer, sizeof buffer);
+                end = static_cast<size_t>(stream.gcount());
+                pos = 0;
+                if (end == 0) invalid(part);
+            }
+            consumed += 1;
+            return static_cast<uint8_t>(buffer[pos++]);
+        }
+
+        void Read(void *into, size_t count, const char *part) {
+            auto *bytes = static_cast<uint8_t *>(into);
+            for (size_t i = 0; i < count; ++i) bytes[i] = Next(part);
+        }
+
+        uint64_t NextVarint(const char *part = "ends before its last row") {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const uint8_t byte = Next(part);
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) return value;
+            }
+            invalid("varint too long");
+            return 0;
+        }
+    };
+
+    void writeVarint(std::ostream &out, uint64_t value, uint64_t &written) {
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            if (value != 0) byte |= 0x80;
+            out.put(static_cast<char>(byte));
+            written += 1;
+        } while (value != 0);
+    }
+
+    bool isValid(Cell cell) {
+        switch (cell.GetTag()) {
+            case Tag::KEY:
+            case Tag::DOOR:
+                return true;
+            case Tag::START:
+            case Tag::FINISH:
+            case Tag::WALL:
+            case Tag::EMPTY:
+                return cell.GetId() == 0;
+        }
+        return false;
+    }
+
+    void fillRun(Map &map, size_t x, size_t y, size_t count, Cell cell) {
+        // a sparse map is already empty, and writing would allocate the chunk
+        if (map.layout == Layout::SPARSE && cell == Cell::Empty()) return;
+
+        while (count > 0) {
+            const size_t run = std::min(count, map.ContiguousRun(x));
+            std::fill_n(map.GetElementRef(x, y), run, cell);
+            x += run;
+            count -= run;
+        }
+    }
+
+    void copyAbove(Map &map, size_t x, size_t y, size_t count) {
+        // rows split at the same x in every layout, so the runs above and below line up
+        while (count > 0) {
+            const size_t run = std::min(count, map.ContiguousRun(x));
+            if (map.layout == Layout::SPARSE) {
+                // read without allocating; a run that is empty above stays implicitly empty below
+                const Cell *above = &map.ViewChunk(((y - 1) >> CHUNK_BITS) * map.ChunksX() + (x >> CHUNK_BITS))
+                        .At(x & CHUNK_MASK, (y - 1) & CHUNK_MASK);
+                if (std::any_of(above, above + run, [](Cell cell) { return cell != Cell::Empty(); })) {
+                    std::copy_n(above, run, map.GetElementRef(x, y));
+                }
+            } else {
+                std::copy_n(map.GetElementRef(x, y - 1), run, map.GetElementRef(x, y));
+            }
+            x += run;
+            count -= run;
+        }
+    }
+}
+
+namespace MapCompressed {
+    CompressionStats writeMap(const Map &map, const std::string &name) {
+        std::ofstream file(name, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open()) {
+            const auto msg = boost::format{"File %1% is not open for writing"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+
+        MapCompressedHeader header = {
+                .version = VERSION,
+                .width = map.width,
+                .height = map.height,
+        };
+        std::memcpy(header.magic, MAGIC, sizeof MAGIC);
+        file.write(reinterpret_cast<const char *>(&header), sizeof header);
+
+        CompressionStats stats = {.compressedBytes = sizeof header, .cells = map.width * map.height};
+
+        std::vector<Cell> above(map.width), row(map.width);
+        for (size_t y = 0; y < map.height; ++y) {
+            map.ReadRow(y, row);
+
+            // greedily take whichever of a run or a copy from above covers more cells
+            for (size_t x = 0; x < map.width;) {
+                size_t run = 1;
+                while (x + run < map.width && row[x + run] == row[x]) run++;
+
+                size_t copy = 0;
+                if (y > 0) {
+                    while (x + copy < map.width && row[x + copy] == above[x + copy]) copy++;
+                }
+
+                if (copy >= run) {
+                    writeVarint(file, copy << 1 | 1, stats.compressedBytes);
+                    x += copy;
+                } else {
+                    writeVarint(file, run << 1, stats.compressedBytes);
+                    file.put(static_cast<char>(row[x].bits));
+                    stats.compressedBytes += 1;
+                    x += run;
+                }
+            }
+            std::swap(above, row);
+        }
+
+        const auto extendedIds = map.ExtendedIds();
+        writeVarint(file, extendedIds.size(), stats.compressedBytes);
+        for (const auto &[position, id] : extendedIds) {
+            writeVarint(file, position.x, stats.compressedBytes);
+            writeVarint(file, position.y, stats.compressedBytes);
+            writeVarint(file, id, stats.compressedBytes);
+        }
+
+        if (!file) {
+            const auto msg = boost::format{"Could not write compressed map %1%"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+        return stats;
+    }
+
+    Map loadMap(const std::string &name, Layout layout, CompressionStats *stats) {
+        if (name == "-") return loadMap(std::cin, layout, stats);
+
+        std::ifstream file(name, std::ios::binary);
+
+        if (!file.is_open()) {
+            const auto msg = boost::format{"File %1% is not open for reading"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+        return loadMap(file, layout, stats);
+    }
+
+    Map loadMap(std::istream &stream, Layout layout, CompressionStats *stats) {
+        const auto start = std::chrono::steady_clock::now();
+        ByteReader reader(stream);
+
+        MapCompressedHeader header{};
+        reader.Read(&header, sizeof header, "too short for a header");
+        if (std::memcmp(header.magic, MAGIC, sizeof MAGIC) != 0) invalid("bad magic");
+        if (header.version != VERSION) invalid("unsupported version");
+        // positions are 32-bit, and the header is checked before anything the size of the map is allocated
+        if (header.width > UINT32_MAX || header.height > UINT32_MAX) invalid("dimensions overflow");
+        if (header.width != 0 && header.height > MAX_CELLS / header.width) invalid("too many cells");
+
+        Map map;
+        try {
+            map = Map::Allocate(header.width, header.height, layout);
+        } catch (const std::bad_alloc &) {
+            invalid("too large to load");
+        }
+
+        for (size_t y = 0; y < map.height; ++y) {
+            for (size_t x = 0; x < map.width;) {
+                const uint64_t token = reader.NextVarint();
+                const uint64_t count = token >> 1;
+                if (count == 0 || count > map.width - x) invalid("token crosses the end of a row");
+
+                if (token & 1) {
+                    if (y == 0) invalid("first row copies from above");
+                    copyAbove(map, x, y, count);
+                } else {
+                    const Cell cell = {.bits = reader.Next()};
+                    if (!isValid(cell)) invalid("unknown cell");
+                    fillRun(map, x, y, count, cell);
+                }
+                x += count;
+            }
+        }
+
+        const char *ids = "ends in its extended ids";
+        const uint64_t extendedCount = reader.NextVarint(ids);
+        for (uint64_t i = 0; i < extendedCount; ++i) {
+            const uint64_t x = reader.NextVarint(ids);
+            const uint64_t y = reader.NextVarint(ids);
+            const uint64_t id = reader.NextVarint(ids);
+            if (x >= map.width || y >= map.height || id > MAX_KEY_ID) invalid("extended id out of range");
+            map.extendedIds[y * map.width + x] = static_cast<uint32_t>(id);
+        }
+
+        map.BuildIndex();
+
+        if (stats != nullptr) {
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            *stats = {
+                    .compressedBytes = reader.consumed,
+                    .cells = map.width * map.height,
+                    .seconds = elapsed.count(),
+            };
+        }
+        return map;
+    }
+
+    bool isCompressedName(const std::string &name) {
+        return name.ends_with(".mapz");
+    }
+}
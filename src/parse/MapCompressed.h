@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <repr/Map.h>
+
+/**
+ * Compressed maps (.mapz) for shipping and storing generated levels, which are mostly long runs of floor and wall.
+ *
+ * Layout, all integers native-endian:
+ *   MapCompressedHeader
+ *   tokens, row by row; a token never crosses the end of a row
+ *   varint count, then count (x, y, id) varint triples: Map::extendedIds in row-major order
+ *
+ * A token is a LEB128 varint t. If t is even it is a run of t / 2 copies of the Cell byte that follows.
+ * If t is odd the next (t - 1) / 2 cells are copies of the cells directly above, an LZ77 match whose distance is
+ * always one row, which is how repeated maze rows compress.
+ */
+namespace MapCompressed {
+    constexpr char MAGIC[4] = {'M', 'A', 'P', 'Z'};
+    constexpr uint32_t VERSION = 2;
+    /** larger maps are rejected before anything is allocated for them; 64 Gi, well past a 50k x 50k level */
+    constexpr uint64_t MAX_CELLS = uint64_t{1} << 36;
+
+    struct MapCompressedHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t width;
+        uint64_t height;
+    };
+
+    struct CompressionStats {
+        uint64_t compressedBytes = 0;
+        uint64_t cells = 0;
+        double seconds = 0;
+
+        /**
+         * @return cells (one byte each in memory) per compressed byte
+         */
+        [[nodiscard]] double Ratio() const {
+            return compressedBytes == 0 ? 0 : static_cast<double>(cells) / static_cast<double>(compressedBytes);
+        }
+
+        [[nodiscard]] double CellsPerSecond() const {
+            return seconds == 0 ? 0 : static_cast<double>(cells) / seconds;
+        }
+    };
+
+    CompressionStats writeMap(const Map &map, const std::string &name);
+
+    /**
+     * Decodes a compressed map as it is read, a buffer at a time, straight into the cells of the map.
+     * "-" reads from stdin.
+     * @param stats if given, filled with the size and how long decoding took
+     */
+    Map loadMap(const std::string &name, Layout layout = Layout::ROW_MAJOR, CompressionStats *stats = nullptr);
+
+    Map loadMap(std::istream &stream, Layout layout = Layout::ROW_MAJOR, CompressionStats *stats = nullptr);
+
+    /**
+     * @return true if name ends in .mapz
+     */
+    bool isCompressedName(const std::string &name);
+}
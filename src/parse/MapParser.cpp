@@ -2,82 +2,233 @@
 // Created by Andrew Gazelka on 4/13/21.
 //
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <iterator>
 #include <optional>
+#include <thread>
+#include <vector>
 #include "MapParser.h"
+#include "MappedFile.h"
+#include "CellClassifier.h"
 #include <boost/format.hpp>
 
-/**
- *
- * @param c The character to parse
- * @return an element if valid else empty
- */
-std::optional<Element> findElement(char c) {
-    switch (c) {
-        case '0':
-            return Element::Empty();
-        case 'S':
-            return Element::Start();
-        case 'G':
-            return Element::Finish();
-        case 'W':
-            return Element::Wall();
-        default:
-            break;
+namespace {
+    /**
+     * Rows with fewer bytes than this per thread are parsed on the calling thread
+     */
+    constexpr size_t MIN_BYTES_PER_THREAD = 1 << 20;
+
+    /**
+     * The first problem found in a range of rows
+     */
+    struct ParseError {
+        enum class Kind {
+            CHARACTER,
+            WIDTH
+        } kind;
+        size_t row;
+        size_t column;
+        char character;
+        size_t widthCount;
+    };
+
+    /**
+     * Rows [begin, end) of the text after the header, which start at row `firstRow`
+     */
+    struct RowRange {
+        size_t begin, end;
+        size_t rowCount = 0;
+        size_t firstRow = 0;
+        std::optional<ParseError> error;
+        std::vector<ExtendedId> ids;
+        /** the special cells of these rows, in row-major order */
+        MapIndex index;
+    };
+
+    /**
+     * Reads an unsigned integer the way `operator>>` would, skipping any leading whitespace
+     * @param text the whole file
+     * @param pos where to start reading, moved past the number
+     */
+    size_t readDimension(std::string_view text, size_t &pos) {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+
+        size_t value = 0;
+        const auto begin = text.data() + pos;
+        const auto [end, error] = std::from_chars(begin, text.data() + text.size(), value);
+        if (error != std::errc()) {
+            throw std::invalid_argument("Map does not start with a width and height");
+        }
+        pos += end - begin;
+        return value;
     }
 
-    if ('a' <= c && c <= 'e') return Element::Key(c - 'a');
-    if ('A' <= c && c <= 'E') return Element::Door(c - 'A');
+    /**
+     * Splits rows into about `parts` ranges, each ending just after a newline (except the last)
+     */
+    std::vector<RowRange> splitRows(std::string_view rows, size_t parts) {
+        std::vector<RowRange> ranges;
+        size_t begin = 0;
+        for (size_t part = 1; part <= parts && begin < rows.size(); ++part) {
+            size_t end = rows.size();
+            if (part < parts) {
+                const auto newline = rows.find('\n', std::max(begin, rows.size() * part / parts));
+                if (newline != std::string_view::npos) end = newline + 1;
+            }
+            ranges.push_back({.begin = begin, .end = end});
+            begin = end;
+        }
+        return ranges;
+    }
 
-    return {};
-}
+    /**
+     * Runs work(i) for every i < count, on one thread each
+     */
+    template<typename F>
+    void parallelFor(size_t count, F &&work) {
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < count; ++i) threads.emplace_back(work, i);
+        if (count > 0) work(0);
+        for (auto &thread : threads) thread.join();
+    }
 
+    /**
+     * Validates the rows of a range and stores those inside the map.
+     * Rows past the declared height are still validated so the first bad character is reported.
+     * @param fits whether the map has cells allocated
+     */
+    void parseRows(std::string_view rows, RowRange &range, Map &map, bool fits) {
+        // a ROW_MAJOR row is decoded in place, a chunked one through this and then split at chunk edges
+        std::vector<Cell> buffer(map.layout == Layout::ROW_MAJOR || !fits ? 0 : map.width);
 
-namespace MapParser {
-    Map parseMap(const std::string &name) {
-        std::ifstream file;
-        file.open(name);
+        size_t pos = range.begin;
+        size_t y = range.firstRow;
+        while (pos < range.end) {
+            const char *line = rows.data() + pos;
+            const auto *newline = static_cast<const char *>(std::memchr(line, '\n', range.end - pos));
+            const size_t length = newline != nullptr ? newline - line : range.end - pos;
+            pos += length + 1;
+
+            const bool store = fits && y < map.height;
+            Cell *out = nullptr;
+            if (store) out = map.layout == Layout::ROW_MAJOR ? map.GetElementRef(0, y) : buffer.data();
+
+            const auto decoded = CellClassifier::decodeRow({line, length}, static_cast<uint32_t>(y), out,
+                                                           store ? map.width : 0, range.ids);
+            if (decoded.invalidByte.has_value()) {
+                range.error = {
+                        .kind = ParseError::Kind::CHARACTER,
+                        .row = y,
+                        .column = *decoded.invalidByte,
+                        .character = line[*decoded.invalidByte],
+                };
+                return;
+            }
+            if (decoded.cells != map.width) {
+                range.error = {.kind = ParseError::Kind::WIDTH, .row = y, .widthCount = decoded.cells};
+                return;
+            }
 
-        if (!file.is_open()) {
-            const auto msg = boost::format{"File %1% is not open for reading"} % name;
+            // the row is still in cache, so finding its few special cells here is nearly free
+            for (size_t x = 0; store && x < map.width; ++x) {
+                if (out[x].GetTag() >= Tag::WALL) continue;
+                range.index.List(out[x].GetTag())->push_back(
+                        {.x = static_cast<uint32_t>(x), .y = static_cast<uint32_t>(y)});
+            }
+
+            if (store && map.layout != Layout::ROW_MAJOR) map.WriteRow(y, buffer);
+            y += 1;
+        }
+    }
+
+    void throwError(const ParseError &error, size_t width) {
+        if (error.kind == ParseError::Kind::CHARACTER) {
+            const auto msg = boost::format{"Invalid character %1% in file read (row %2%, column %3%)"}
+                             % error.character % (error.row + 1) % (error.column + 1);
             throw std::invalid_argument(msg.str());
         }
-        int width, height;
-        file >> width >> height;
+        const auto msg = boost::format{"Width of elements is %1% not the specified width %2% (row %3%)"}
+                         % error.widthCount % width % (error.row + 1);
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+namespace MapParser {
+    Map parseMap(const std::string &name, Layout layout) {
+        MappedFile file(name);
+        return parseText(file.View(), layout);
+    }
+
+    Map parseMap(std::istream &stream, Layout layout) {
+        std::string text{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+        return parseText(text, layout);
+    }
+
+    size_t parseHeader(std::string_view text, size_t &width, size_t &height) {
+        size_t pos = 0;
+        width = readDimension(text, pos);
+        height = readDimension(text, pos);
 
-        Map map = {
-                .width = static_cast<size_t>(width),
-                .height = static_cast<size_t>(height),
-        };
+        // the rest of the header line is ignored
+        const auto headerEnd = text.find('\n', pos);
+        return headerEnd == std::string_view::npos ? text.size() : headerEnd + 1;
+    }
+
+    Map parseText(std::string_view text, Layout layout, size_t threads) {
+        size_t width, height;
+        const auto rows = text.substr(parseHeader(text, width, height));
 
-        std::string line;
+        // every cell takes at least one byte, so a header promising more cells than there are bytes is wrong.
+        // we still walk the rows without storing them so the error below matches the one for a short file.
+        const bool fits = width == 0 || height <= text.size() / width;
 
-        getline(file, line);
+        Map map = fits ? Map::Allocate(width, height, layout) : Map{.width = width, .height = height};
 
+        if (threads == 0) {
+            threads = std::clamp<size_t>(rows.size() / MIN_BYTES_PER_THREAD, 1,
+                                         std::max(1U, std::thread::hardware_concurrency()));
+        }
+        // rows are disjoint in ROW_MAJOR and TILED maps, but SPARSE chunks are allocated into a shared table
+        if (layout == Layout::SPARSE) threads = 1;
+        auto ranges = splitRows(rows, threads);
+
+        // a range's first row is the number of lines before it, the way getline would count them
+        parallelFor(ranges.size(), [&](size_t i) {
+            auto &range = ranges[i];
+            range.rowCount = std::count(rows.begin() + range.begin, rows.begin() + range.end, '\n');
+            if (range.end == rows.size() && rows.back() != '\n') range.rowCount += 1;
+        });
         size_t heightCount = 0;
-        while (getline(file, line)) {
-            heightCount += 1;
-            size_t widthCount = 0;
-            for (const auto &character : line) {
-                const auto elem = findElement(character);
-                if (!elem.has_value()) {
-                    const auto msg = boost::format{"Invalid character %1% in file read"} % character;
-                    throw std::invalid_argument(msg.str());
-                }
-                map.elements.push_back(elem.value());
-                widthCount += 1;
+        for (auto &range : ranges) {
+            range.firstRow = heightCount;
+            heightCount += range.rowCount;
+        }
+
+        parallelFor(ranges.size(), [&](size_t i) {
+            parseRows(rows, ranges[i], map, fits);
+        });
+
+        // ranges are in file order, so the first one with an error has the error a sequential parse would stop at
+        for (const auto &range : ranges) {
+            if (range.error.has_value()) throwError(*range.error, width);
+            for (const auto &extended : range.ids) {
+                map.extendedIds[extended.position.y * width + extended.position.x] = extended.id;
             }
-            if (widthCount != width) {
-                const auto msg =
-                        boost::format{"Width of elements is %1% not the specified width %2%"} % widthCount % width;
-                throw std::invalid_argument(msg.str());
+            for (const auto tag : {Tag::START, Tag::FINISH, Tag::KEY, Tag::DOOR}) {
+                const auto &positions = *range.index.List(tag);
+                map.index.List(tag)->insert(map.index.List(tag)->end(), positions.begin(), positions.end());
             }
         }
+
         if (heightCount != height) {
             const auto msg =
                     boost::format{"Height of elements is %1% not the specified width %2%"} % heightCount % height;
             throw std::invalid_argument(msg.str());
         }
-        file.close(); // can probably be omitted
+        map.index.BuildLookup();
         return map;
     }
-}
\ No newline at end of file
+}
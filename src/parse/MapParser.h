@@ -2,10 +2,28 @@
 
 
 #include <string>
+#include <string_view>
 #include <repr/Map.h>
 #include <fstream>
 
 namespace MapParser {
-    Map parseMap(const std::string &name);
-};
+    /**
+     * Parses a map file. Regular files are memory-mapped; "-" reads from stdin and pipes/FIFOs are drained.
+     */
+    Map parseMap(const std::string &name, Layout layout = Layout::ROW_MAJOR);
+
+    Map parseMap(std::istream &stream, Layout layout = Layout::ROW_MAJOR);
 
+    /**
+     * Reads the "width height" header line
+     * @return where the first row starts
+     */
+    size_t parseHeader(std::string_view text, size_t &width, size_t &height);
+
+    /**
+     * Parses the text of a map ("width height" header followed by one line per row).
+     * Rows are split into ranges at newlines and decoded in parallel; errors are still those of the first bad row.
+     * @param threads how many ranges to parse at once, 0 for one per core on large maps
+     */
+    Map parseText(std::string_view text, Layout layout = Layout::ROW_MAJOR, size_t threads = 0);
+};
@@ -0,0 +1,115 @@
+#include "MapWatcher.h"
+#include "MapParser.h"
+#include "MappedFile.h"
+#include "CellClassifier.h"
+
+#include <cstring>
+#include <functional>
+
+namespace {
+    /**
+     * Calls row(y, line) for every line of the rows, without their newlines
+     */
+    template<typename F>
+    void forEachRow(std::string_view rows, F &&row) {
+        size_t y = 0;
+        for (size_t pos = 0; pos < rows.size(); ++y) {
+            const auto newline = rows.find('\n', pos);
+            const auto end = newline == std::string_view::npos ? rows.size() : newline;
+            row(y, rows.substr(pos, end - pos));
+            pos = end + 1;
+        }
+    }
+
+    uint64_t hashRow(std::string_view line) {
+        return std::hash<std::string_view>{}(line);
+    }
+}
+
+MapWatcher::MapWatcher(std::string name) : name(std::move(name)) {
+    modified = std::filesystem::last_write_time(this->name);
+    MappedFile file(this->name);
+    Remember(file.View());
+}
+
+void MapWatcher::Remember(std::string_view text) {
+    size_t width, height;
+    const auto rows = text.substr(MapParser::parseHeader(text, width, height));
+    rowHashes.clear();
+    forEachRow(rows, [this](size_t, std::string_view line) {
+        rowHashes.push_back(hashRow(line));
+    });
+}
+
+MapChanges MapWatcher::Poll(Map &map) {
+    const auto time = std::filesystem::last_write_time(name);
+    if (time == modified) return {};
+
+    // a save that fails to parse is reported once, not on every poll until it is fixed
+    modified = time;
+    MappedFile file(name);
+    return Apply(map, file.View());
+}
+
+MapChanges MapWatcher::Apply(Map &map, std::string_view text) {
+    size_t newWidth, newHeight;
+    const auto rows = text.substr(MapParser::parseHeader(text, newWidth, newHeight));
+
+    if (newWidth != map.width || newHeight != map.height || map.layout == Layout::PAGED) {
+        if (map.layout == Layout::PAGED) throw std::invalid_argument("Paged maps cannot be reloaded");
+        map = MapParser::parseText(text, map.layout);
+        Remember(text);
+        return {.reloaded = true};
+    }
+
+    // decode every edited row before writing any, so a bad edit leaves the map as it was
+    std::vector<size_t> edited;
+    std::vector<Cell> decoded;
+    std::vector<ExtendedId> ids;
+    std::vector<uint64_t> hashes;
+    hashes.reserve(rowHashes.size());
+    bool valid = true;
+    forEachRow(rows, [&](size_t y, std::string_view line) {
+        const auto hash = hashRow(line);
+        hashes.push_back(hash);
+        if (!valid || (y < rowHashes.size() && rowHashes[y] == hash)) return;
+
+        decoded.resize((edited.size() + 1) * map.width);
+        const auto row = CellClassifier::decodeRow(line, static_cast<uint32_t>(y),
+                                                   decoded.data() + edited.size() * map.width, map.width, ids);
+        valid = y < map.height && row.cells == map.width && !row.invalidByte.has_value();
+        edited.push_back(y);
+    });
+    if (!valid || hashes.size() != map.height) {
+        // only a full parse knows which error comes first, and it throws it
+        map = MapParser::parseText(text, map.layout);
+        Remember(text);
+        return {.reloaded = true};
+    }
+
+    MapChanges changes;
+    auto extended = ids.begin();
+    std::vector<Cell> current(map.width);
+    for (size_t i = 0; i < edited.size(); ++i) {
+        const size_t y = edited[i];
+        const Cell *row = decoded.data() + i * map.width;
+        map.ReadRow(y, current);
+        for (size_t x = 0; x < map.width; ++x) {
+            // ids come out of decodeRow in row-major order, the order cells are visited in
+            size_t id = row[x].GetId();
+            if (extended != ids.end() && extended->position.x == x && extended->position.y == y) {
+                id = (extended++)->id;
+            }
+
+            const Cell before = current[x];
+            if (before == row[x] && map.GetId(x, y, before) == id) continue;
+
+            map.SetElement(x, y, row[x].GetTag(), id);
+            const Position position = {.x = static_cast<uint32_t>(x), .y = static_cast<uint32_t>(y)};
+            map.index.Update(position, before, row[x]);
+            changes.cells.push_back({.position = position, .before = before, .after = row[x]});
+        }
+    }
+    rowHashes = std::move(hashes);
+    return changes;
+}
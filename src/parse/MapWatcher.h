@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <repr/Map.h>
+
+/**
+ * A cell that a reload changed. Its key/door id may be larger than the Cell holds, see Map::GetId.
+ */
+struct CellChange {
+    Position position;
+    Cell before;
+    Cell after;
+};
+
+struct MapChanges {
+    /** the size changed, so the whole map was parsed again and anything cached from it must be rebuilt */
+    bool reloaded = false;
+    /** every cell that differs, in row-major order (empty when reloaded) */
+    std::vector<CellChange> cells;
+
+    [[nodiscard]] bool Empty() const {
+        return !reloaded && cells.empty();
+    }
+};
+
+/**
+ * Hot-reloads a text map while it is being edited.
+ *
+ * The watcher remembers a hash of every row of the file. When the file changes only the rows whose hash differs are
+ * decoded and written into the Map, so edits to a huge map cost about as much as hashing it, and the game state of
+ * rows that were not edited (opened doors, taken keys) survives. A row that fails to parse leaves the map untouched
+ * and throws the error a full parse would.
+ */
+class MapWatcher {
+private:
+    std::string name;
+    std::filesystem::file_time_type modified;
+    std::vector<uint64_t> rowHashes;
+
+    void Remember(std::string_view text);
+
+public:
+    /**
+     * Starts watching a map file, which should be the one the Map was parsed from
+     */
+    explicit MapWatcher(std::string name);
+
+    /**
+     * Applies the file to the map if it was written since the last call
+     */
+    MapChanges Poll(Map &map);
+
+    /**
+     * Applies new text of the map, updating the map's index as well as its cells
+     */
+    MapChanges Apply(Map &map, std::string_view text);
+};
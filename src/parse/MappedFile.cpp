@@ -0,0 +1,47 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/format.hpp>
+
+MappedFile::MappedFile(const std::string &name) {
+    fd = name == "-" ? STDIN_FILENO : open(name.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        const auto msg = boost::format{"File %1% is not open for reading"} % name;
+        throw std::invalid_argument(msg.str());
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size = static_cast<size_t>(info.st_size);
+        mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+        } else {
+            // the parser makes a single front-to-back pass
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            return;
+        }
+    }
+
+    // not mappable (pipe, stdin, empty file) so drain it
+    char chunk[1 << 16];
+    ssize_t count;
+    while ((count = read(fd, chunk, sizeof chunk)) > 0) {
+        buffer.append(chunk, static_cast<size_t>(count));
+    }
+    if (count < 0) {
+        if (fd > STDIN_FILENO) close(fd);
+        const auto msg = boost::format{"File %1% could not be read"} % name;
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (mapping != nullptr) munmap(mapping, size);
+    if (fd > STDIN_FILENO) close(fd);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * View over the bytes of a file.
+ *
+ * Regular files are mmap'd so large maps are never copied into the heap. The mapping is private, so writes through
+ * Data() are copy-on-write and never reach the file. Pipes, FIFOs and stdin (the name "-") cannot be mapped, so their
+ * contents are drained into an owned buffer instead; callers cannot tell the difference.
+ */
+class MappedFile {
+private:
+    int fd = -1;
+    void *mapping = nullptr;
+    size_t size = 0;
+    std::string buffer;
+
+public:
+    explicit MappedFile(const std::string &name);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    [[nodiscard]] std::string_view View() const {
+        if (mapping != nullptr) return {static_cast<const char *>(mapping), size};
+        return buffer;
+    }
+
+    [[nodiscard]] char *Data() {
+        return mapping != nullptr ? static_cast<char *>(mapping) : buffer.data();
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return mapping != nullptr ? size : buffer.size();
+    }
+
+    [[nodiscard]] bool IsMapped() const {
+        return mapping != nullptr;
+    }
+};
@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "Scene.h"
+#include "render/Image.h"
+#include "render/Raycaster.h"
+#include "render/SoftwareBackend.h"
+#include "parse/MapParser.h"
+#include "parse/MapBinary.h"
+#include "parse/MapCompressed.h"
+
+namespace {
+    // as the game has them
+    constexpr float FOV_Y = 3.14f / 4;
+    constexpr float ZNEAR = 0.01f;
+    constexpr float ZFAR = 10.0f;
+    constexpr GLuint WOOD_TEXTURE_ID = 0;
+    constexpr GLuint BRICK_TEXTURE_ID = 1;
+    // the software backend has its shading built in, so programs are only names to hang uniforms and blocks on
+    constexpr GLuint TEXTURED_PROGRAM = 1;
+    constexpr GLuint INSTANCED_PROGRAM = 2;
+
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    Map loadMap(const std::string &name) {
+        if (MapBinary::isBinaryName(name)) return MapBinary::loadMap(name);
+        if (MapCompressed::isCompressedName(name)) return MapCompressed::loadMap(name, Layout::TILED);
+        return MapParser::parseMap(name, Layout::TILED);
+    }
+
+    /**
+     * Draws the frame through Scene, as the game submits it, into a SoftwareBackend
+     */
+    void rasterize(Map &map, size_t width, size_t height, float angle, const std::string &output) {
+        SoftwareBackend backend(width, height);
+
+        const GLuint woodTexture = backend.AddTexture(Images::loadBMP("textures/wood.bmp"));
+        const GLuint brickTexture = backend.AddTexture(Images::loadBMP("textures/brick.bmp"));
+
+        Model cubeModel = Utils::loadModel("models/cube.txt");
+        Model knotModel = Utils::loadModel("models/knot.txt");
+        Model teapotModel = Utils::loadModel("models/teapot.txt");
+        Model combined = Model::combine({&cubeModel, &knotModel, &teapotModel});
+
+        const GLuint modelBuffer = backend.CreateBuffer();
+        backend.BindBuffer(GL_ARRAY_BUFFER, modelBuffer);
+        backend.BufferData(GL_ARRAY_BUFFER, combined.GetNumberLines() * sizeof(float), combined.data.data(),
+                           GL_STATIC_DRAW);
+
+        backend.UseProgram(TEXTURED_PROGRAM);
+        backend.Uniform(backend.GetUniformLocation(TEXTURED_PROGRAM, "tex0"), static_cast<int32_t>(WOOD_TEXTURE_ID));
+        backend.Uniform(backend.GetUniformLocation(TEXTURED_PROGRAM, "tex1"), static_cast<int32_t>(BRICK_TEXTURE_ID));
+        backend.ActiveTexture(GL_TEXTURE0 + WOOD_TEXTURE_ID);
+        backend.BindTexture(GL_TEXTURE_2D, woodTexture);
+        backend.ActiveTexture(GL_TEXTURE0 + BRICK_TEXTURE_ID);
+        backend.BindTexture(GL_TEXTURE_2D, brickTexture);
+
+        TexturedModel brickCube = {.model = cubeModel, .textureId = BRICK_TEXTURE_ID};
+        TexturedModel woodCube = {.model = cubeModel, .textureId = WOOD_TEXTURE_ID};
+        TextureData textures = {
+                .wallModel = brickCube,
+                .keyModel = knotModel,
+                .floorModel = woodCube,
+                .endModel = teapotModel,
+                .doorModel = cubeModel,
+        };
+        Scene scene(backend, textures, map, TEXTURED_PROGRAM, INSTANCED_PROGRAM, modelBuffer);
+
+        const glm::vec3 position = scene.GetStartPosition();
+        const glm::vec3 look(-std::cos(angle), std::sin(angle), 0.0f);
+        const glm::mat4 view = glm::lookAt(position, position + look, glm::vec3(0, 0, 1));
+        const glm::mat4 proj = glm::perspective(FOV_Y, static_cast<float>(width) / static_cast<float>(height), ZNEAR,
+                                                ZFAR);
+        const auto drawFrame = [&] {
+            backend.ClearColor(.2f, 0.4f, 0.8f, 1.0f);
+            backend.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            scene.SetFocus(position, ZFAR);
+            scene.SetCamera(view, proj);
+            scene.Draw();
+        };
+
+        // the first frame asks for the chunk meshes in view; the second has them all
+        drawFrame();
+        scene.WaitForChunks();
+        const auto begin = std::chrono::steady_clock::now();
+        drawFrame();
+        const Image &frame = backend.Frame();
+        const Milliseconds elapsed = std::chrono::steady_clock::now() - begin;
+
+        Images::write(frame, output);
+        std::cout << backend.Triangles() << " triangles in " << elapsed.count() << " ms ("
+                  << SoftwareBackend::InstructionSet() << ")" << std::endl;
+        scene.Release();
+    }
+
+    /**
+     * Draws the frame with a Raycaster, straight from the grid
+     */
+    void raycast(const Map &map, size_t width, size_t height, float angle, const std::string &output) {
+        Raycaster raycaster(map, Images::loadBMP("textures/brick.bmp"), Images::loadBMP("textures/wood.bmp"), width,
+                            height);
+        const State state = {.camPosition = Scene::StartPosition(map), .angle = angle, .angle2 = 0, .movement = {}};
+
+        const auto begin = std::chrono::steady_clock::now();
+        const Image &frame = raycaster.Render(state);
+        const Milliseconds elapsed = std::chrono::steady_clock::now() - begin;
+
+        Images::write(frame, output);
+        std::cout << "raycast in " << elapsed.count() << " ms (" << Raycaster::InstructionSet() << ")" << std::endl;
+    }
+}
+
+/**
+ * Draws what the game shows at the start of a map (text, .mapb or .mapz) into a PPM or BMP on the CPU, so frames can be
+ * looked at on machines without a GPU. The scene is rasterized as the game draws it, or with --raycast cast straight
+ * from the grid, which is much faster and close to it. The angle turns the camera as the mouse does.
+ * Run from the repository root, where models/ and textures/ are. Exits with 1 if the map or an asset cannot be read.
+ */
+int main(int argc, char *argv[]) {
+    const bool raycasting = argc > 1 && std::strcmp(argv[1], "--raycast") == 0;
+    const int first = raycasting ? 2 : 1;
+    const int given = argc - first;
+    if (given != 2 && given != 4 && given != 5) {
+        std::cerr << "usage: " << argv[0] << " [--raycast] <map> <out.ppm|out.bmp> [width height] [angle]" << std::endl;
+        return 1;
+    }
+    const std::string mapName = argv[first];
+    const std::string output = argv[first + 1];
+    const size_t width = given > 2 ? std::stoul(argv[first + 2]) : 800;
+    const size_t height = given > 2 ? std::stoul(argv[first + 3]) : 600;
+    const float angle = given > 4 ? std::stof(argv[first + 4]) : 0.0f;
+
+    try {
+        Map map = loadMap(mapName);
+        std::cout << mapName << " -> " << output << " (" << width << "x" << height << "): ";
+        if (raycasting) {
+            raycast(map, width, height, angle, output);
+        } else {
+            rasterize(map, width, height, angle, output);
+        }
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "ChunkMesh.h"
+
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace {
+    /**
+     * Cube faces by outward normal: +x, -x, +y, -y, then the top and the bottom
+     */
+    constexpr std::array<std::array<int, 3>, 6> FACE_NORMALS = {{
+            {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1},
+    }};
+    constexpr size_t SIDES = 4;
+    constexpr size_t TOP = 4;
+
+    constexpr float FLOOR_Z = -1.0f;
+    constexpr float WALL_Z = 0.0f;
+
+    /**
+     * @return the cube's vertices split by which face their triangle is on, in FACE_NORMALS order
+     */
+    std::array<std::vector<float>, 6> splitFaces(std::span<const float> cube) {
+        constexpr size_t TRIANGLE = 3 * ChunkMeshes::FLOATS_PER_VERTEX;
+        std::array<std::vector<float>, 6> faces;
+        for (size_t i = 0; i + TRIANGLE <= cube.size(); i += TRIANGLE) {
+            const float *normal = &cube[i + 5];
+            size_t axis = 0;
+            for (size_t a = 1; a < 3; ++a) {
+                if (std::abs(normal[a]) > std::abs(normal[axis])) axis = a;
+            }
+            auto &face = faces[2 * axis + (normal[axis] < 0 ? 1 : 0)];
+            face.insert(face.end(), cube.begin() + i, cube.begin() + i + TRIANGLE);
+        }
+        return faces;
+    }
+
+    void emit(std::vector<float> &out, const std::vector<float> &face, float x, float y, float z) {
+        for (size_t v = 0; v < face.size(); v += ChunkMeshes::FLOATS_PER_VERTEX) {
+            out.push_back(face[v] + x);
+            out.push_back(face[v + 1] + y);
+            out.push_back(face[v + 2] + z);
+            out.insert(out.end(), face.begin() + v + 3, face.begin() + v + ChunkMeshes::FLOATS_PER_VERTEX);
+        }
+    }
+
+    bool solid(Cell cell) {
+        return cell.GetTag() == Tag::WALL || cell.GetTag() == Tag::DOOR;
+    }
+}
+
+namespace ChunkMeshes {
+    ChunkSnapshot snapshot(const Map &map, size_t chunk, uint64_t version) {
+        const ChunkView view = map.ViewChunk(chunk);
+        ChunkSnapshot snapshot = {
+                .chunk = chunk,
+                .x = view.x,
+                .y = view.y,
+                .width = view.width,
+                .height = view.height,
+                .cells = std::vector<Cell>((view.width + 2) * (view.height + 2), Cell::Empty()),
+                .shades = std::vector<uint8_t>(view.width * view.height),
+                .version = version,
+        };
+
+        const size_t x0 = view.x > 0 ? view.x - 1 : 0;
+        const size_t y0 = view.y > 0 ? view.y - 1 : 0;
+        map.ForEachCellIn(x0, y0, view.x + view.width + 1, view.y + view.height + 1, [&](size_t x, size_t y, Cell cell) {
+            snapshot.cells[(y + 1 - view.y) * (view.width + 2) + x + 1 - view.x] = cell;
+
+            const bool inside = x >= view.x && x < view.x + view.width && y >= view.y && y < view.y + view.height;
+            if (inside && cell.GetTag() == Tag::DOOR) {
+                snapshot.shades[(y - view.y) * view.width + x - view.x] = map.GetId(x, y, cell) % DOOR_SHADES;
+            }
+        });
+        return snapshot;
+    }
+
+    ChunkMesh build(const ChunkSnapshot &snapshot, std::span<const float> cube) {
+        const auto faces = splitFaces(cube);
+        std::vector<float> floors, walls;
+        std::array<std::vector<float>, DOOR_SHADES> doors;
+
+        for (size_t localY = 0; localY < snapshot.height; ++localY) {
+            for (size_t localX = 0; localX < snapshot.width; ++localX) {
+                const Cell cell = snapshot.At(localX, localY);
+                const auto x = static_cast<float>(snapshot.x + localX);
+                const auto y = static_cast<float>(snapshot.y + localY);
+
+                // a wall sits on its floor, so that is never seen
+                if (cell.GetTag() != Tag::WALL) emit(floors, faces[TOP], x, y, FLOOR_Z);
+                if (!solid(cell)) continue;
+
+                auto &out = cell.GetTag() == Tag::WALL ? walls : doors[snapshot.shades[localY * snapshot.width + localX]];
+                for (size_t face = 0; face < SIDES; ++face) {
+                    const auto &normal = FACE_NORMALS[face];
+                    if (solid(snapshot.At(static_cast<ptrdiff_t>(localX) + normal[0], static_cast<ptrdiff_t>(localY) + normal[1]))) {
+                        continue;
+                    }
+                    emit(out, faces[face], x, y, WALL_Z);
+                }
+                emit(out, faces[TOP], x, y, WALL_Z);
+            }
+        }
+
+        ChunkMesh mesh = {.chunk = snapshot.chunk, .version = snapshot.version};
+        const auto append = [&](const std::vector<float> &vertices, Material material, size_t shade) {
+            if (vertices.empty()) return;
+            mesh.batches.push_back({
+                    .material = material,
+                    .shade = static_cast<uint8_t>(shade),
+                    .first = static_cast<uint32_t>(mesh.vertices.size() / FLOATS_PER_VERTEX),
+                    .count = static_cast<uint32_t>(vertices.size() / FLOATS_PER_VERTEX),
+            });
+            mesh.vertices.insert(mesh.vertices.end(), vertices.begin(), vertices.end());
+        };
+        append(floors, Material::FLOOR, 0);
+        append(walls, Material::WALL, 0);
+        for (size_t shade = 0; shade < DOOR_SHADES; ++shade) append(doors[shade], Material::DOOR, shade);
+        return mesh;
+    }
+}
+
+ChunkMeshBuilder::ChunkMeshBuilder(std::vector<float> cube) : cube(std::move(cube)), worker(&ChunkMeshBuilder::Run, this) {}
+
+ChunkMeshBuilder::~ChunkMeshBuilder() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void ChunkMeshBuilder::Run() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queued.empty(); });
+        if (stopping) return;
+
+        const ChunkSnapshot snapshot = std::move(queued.front());
+        queued.pop_front();
+        building = true;
+        lock.unlock();
+        ChunkMesh mesh = ChunkMeshes::build(snapshot, cube);
+        lock.lock();
+
+        finished.push_back(std::move(mesh));
+        building = false;
+        if (queued.empty()) idle.notify_all();
+    }
+}
+
+void ChunkMeshBuilder::Submit(ChunkSnapshot snapshot) {
+    {
+        std::lock_guard lock(mutex);
+        queued.push_back(std::move(snapshot));
+    }
+    wake.notify_one();
+}
+
+std::vector<ChunkMesh> ChunkMeshBuilder::TakeFinished() {
+    std::lock_guard lock(mutex);
+    return std::exchange(finished, {});
+}
+
+void ChunkMeshBuilder::Wait() {
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this] { return queued.empty() && !building; });
+}
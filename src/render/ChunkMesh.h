@@ -0,0 +1,127 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+#include <repr/Map.h>
+
+/**
+ * What a run of a chunk mesh is drawn with
+ */
+enum class Material : uint8_t {
+    /** the floor texture */
+    FLOOR,
+    /** the wall texture */
+    WALL,
+    /** a flat door colour, picked by MeshBatch::shade */
+    DOOR,
+};
+
+/**
+ * Doors are coloured by id % DOOR_SHADES, so a chunk has at most this many door batches
+ */
+constexpr size_t DOOR_SHADES = 5;
+
+/**
+ * Vertices [first, first + count) of a chunk mesh, all drawn with one material
+ */
+struct MeshBatch {
+    Material material;
+    /** id % DOOR_SHADES of the doors in a DOOR batch, 0 otherwise */
+    uint8_t shade;
+    uint32_t first, count;
+};
+
+/**
+ * A chunk's cells with a one-cell border from its neighbours, copied out so its mesh can be built on another thread
+ * while the game goes on changing the map
+ */
+struct ChunkSnapshot {
+    size_t chunk;
+    size_t x, y;
+    size_t width, height;
+    /** (width + 2) x (height + 2) cells around and including the chunk, row-major; those outside the map are empty */
+    std::vector<Cell> cells;
+    /** width x height, the shade of each door (see DOOR_SHADES) */
+    std::vector<uint8_t> shades;
+    /** how many times the chunk had changed when it was taken, so a mesh built from it can be told to be stale */
+    uint64_t version;
+
+    /**
+     * @param localX, localY from -1 to width / height, relative to the chunk
+     */
+    [[nodiscard]] Cell At(ptrdiff_t localX, ptrdiff_t localY) const {
+        return cells[(localY + 1) * (width + 2) + localX + 1];
+    }
+};
+
+/**
+ * The walls, floors and doors of one chunk merged into a single vertex array, so the chunk is drawn with one call per
+ * material rather than two per cell. Vertices are in the Model layout (position, texture coordinates, normal) with
+ * each cell's translation baked in, so they are drawn with an identity model matrix.
+ */
+struct ChunkMesh {
+    size_t chunk;
+    uint64_t version;
+    std::vector<float> vertices;
+    /** by material, then shade */
+    std::vector<MeshBatch> batches;
+};
+
+namespace ChunkMeshes {
+    constexpr size_t FLOATS_PER_VERTEX = 8;
+
+    ChunkSnapshot snapshot(const Map &map, size_t chunk, uint64_t version);
+
+    /**
+     * Leaves out faces that can never be seen: a floor keeps only its top, and walls and doors lose their bottom and
+     * every side that touches another wall or door. Floors are not put under walls.
+     * @param cube triangles of a unit cube centred on the origin, in the Model layout, with axis-aligned normals
+     */
+    ChunkMesh build(const ChunkSnapshot &snapshot, std::span<const float> cube);
+}
+
+/**
+ * Builds chunk meshes on a background thread. Snapshots are submitted and meshes collected from one thread (the
+ * render thread, which alone may upload them to GL).
+ */
+class ChunkMeshBuilder {
+private:
+    std::vector<float> cube;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<ChunkSnapshot> queued;
+    std::vector<ChunkMesh> finished;
+    bool building = false;
+    bool stopping = false;
+    std::thread worker;
+
+    void Run();
+
+public:
+    explicit ChunkMeshBuilder(std::vector<float> cube);
+
+    ~ChunkMeshBuilder();
+
+    ChunkMeshBuilder(const ChunkMeshBuilder &) = delete;
+
+    ChunkMeshBuilder &operator=(const ChunkMeshBuilder &) = delete;
+
+    void Submit(ChunkSnapshot snapshot);
+
+    /**
+     * @return the meshes built since the last call, in the order they were submitted
+     */
+    std::vector<ChunkMesh> TakeFinished();
+
+    /**
+     * Blocks until every submitted snapshot is built
+     */
+    void Wait();
+};
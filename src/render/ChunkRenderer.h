@@ -0,0 +1,186 @@
+#pragma once
+
+#include <render/ChunkMesh.h>
+#include <render/RenderBackend.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "utils.h"
+
+/**
+ * Draws a map's static geometry (walls, floors and doors) from chunk meshes kept on the GPU.
+ *
+ * Meshes are built by a ChunkMeshBuilder in the background and uploaded at the start of a frame. A chunk is rebuilt
+ * whenever a cell in or beside it changes, and until its mesh is current Draw reports it was not drawn, so the caller
+ * draws it the old way, a cell at a time. Small maps have every chunk built when loaded; larger ones as they come
+ * into view, keeping the MAX_RESIDENT_CHUNKS most recently drawn once they go out of it. Nothing is built ahead of
+ * time until the first InvalidateAll.
+ */
+class ChunkRenderer {
+private:
+    static constexpr size_t MAX_RESIDENT_CHUNKS = 256;
+
+    struct Resident {
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        std::vector<MeshBatch> batches;
+        uint64_t version = 0;
+        uint64_t lastDrawn = 0;
+    };
+
+    RenderBackend &backend;
+    Map &map;
+    ChunkMeshBuilder builder;
+    GLint posAttrib, normAttrib, texAttrib;
+    std::unordered_map<size_t, Resident> resident;
+    // per chunk, the change it is up to; every change gets a new number, so meshes of an older one are stale
+    std::vector<uint64_t> versions;
+    // per chunk, the version last submitted to the builder
+    std::vector<uint64_t> submitted;
+    uint64_t changes = 0;
+    uint64_t frame = 0;
+
+    void Request(size_t chunk) {
+        if (submitted[chunk] == versions[chunk]) return;
+        submitted[chunk] = versions[chunk];
+        builder.Submit(ChunkMeshes::snapshot(map, chunk, versions[chunk]));
+    }
+
+    void Upload(ChunkMesh &mesh) {
+        auto &chunk = resident[mesh.chunk];
+        if (chunk.vao == 0) {
+            chunk.vao = backend.CreateVertexArray();
+            chunk.vbo = backend.CreateBuffer();
+            backend.BindVertexArray(chunk.vao);
+            backend.BindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+
+            // the layout of the combined model buffer, see main
+            const GLsizei stride = ChunkMeshes::FLOATS_PER_VERTEX * sizeof(float);
+            backend.VertexAttribPointer(posAttrib, 3, GL_FLOAT, false, stride, 0);
+            backend.EnableVertexAttribArray(posAttrib);
+            backend.VertexAttribPointer(normAttrib, 3, GL_FLOAT, false, stride, 5 * sizeof(float));
+            backend.EnableVertexAttribArray(normAttrib);
+            backend.VertexAttribPointer(texAttrib, 2, GL_FLOAT, false, stride, 3 * sizeof(float));
+            backend.EnableVertexAttribArray(texAttrib);
+        } else {
+            backend.BindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+        }
+        backend.BufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
+
+        chunk.batches = std::move(mesh.batches);
+        chunk.version = mesh.version;
+        chunk.lastDrawn = frame;
+    }
+
+    void Resize() {
+        const size_t count = map.ChunksX() * map.ChunksY();
+        versions.assign(count, ++changes);
+        submitted.assign(count, 0);
+    }
+
+    void Delete(Resident &chunk) {
+        backend.DeleteBuffer(chunk.vbo);
+        backend.DeleteVertexArray(chunk.vao);
+    }
+
+public:
+    /**
+     * @param cube the cube model, whose vertices every mesh is made of
+     */
+    ChunkRenderer(RenderBackend &backend, Map &map, const Model &cube, GLuint shaderProgram)
+            : backend(backend), map(map), builder(cube.data) {
+        posAttrib = backend.GetAttribLocation(shaderProgram, "position");
+        normAttrib = backend.GetAttribLocation(shaderProgram, "inNormal");
+        texAttrib = backend.GetAttribLocation(shaderProgram, "inTexcoord");
+        Resize();
+    }
+
+    /**
+     * Rebuilds the chunks a changed cell shows up in: its own, and any it borders, whose faces against it may change
+     */
+    void Invalidate(size_t x, size_t y) {
+        const size_t chunksX = map.ChunksX();
+        const size_t cx0 = (x > 0 ? x - 1 : x) >> CHUNK_BITS, cx1 = std::min(x + 1, map.width - 1) >> CHUNK_BITS;
+        const size_t cy0 = (y > 0 ? y - 1 : y) >> CHUNK_BITS, cy1 = std::min(y + 1, map.height - 1) >> CHUNK_BITS;
+        for (size_t cy = cy0; cy <= cy1; ++cy) {
+            for (size_t cx = cx0; cx <= cx1; ++cx) versions[cy * chunksX + cx] = ++changes;
+        }
+    }
+
+    /**
+     * Rebuilds every chunk, for when the whole map changed (or was replaced by one of another size)
+     */
+    void InvalidateAll() {
+        Resize();
+        if (versions.size() <= MAX_RESIDENT_CHUNKS) {
+            for (size_t chunk = 0; chunk < versions.size(); ++chunk) Request(chunk);
+        }
+    }
+
+    /**
+     * Uploads the meshes built since the last frame. Leaves their vertex array bound.
+     */
+    void BeginFrame() {
+        frame += 1;
+        for (auto &mesh : builder.TakeFinished()) {
+            if (mesh.chunk < versions.size() && mesh.version == versions[mesh.chunk]) Upload(mesh);
+        }
+    }
+
+    /**
+     * Passes on a chunk's batches, each one glDrawArrays, if its mesh is current, and otherwise asks for it to be
+     * built. Only says what to draw; the caller records and submits it.
+     * @param record called as record(vertexArray, batch) for each MeshBatch
+     * @return whether the chunk can be drawn
+     */
+    template<typename F>
+    bool Draw(size_t chunk, F &&record) {
+        const auto found = resident.find(chunk);
+        if (found == resident.end() || found->second.version != versions[chunk]) {
+            Request(chunk);
+            return false;
+        }
+
+        auto &mesh = found->second;
+        mesh.lastDrawn = frame;
+        for (const auto &batch : mesh.batches) record(mesh.vao, batch);
+        return true;
+    }
+
+    /**
+     * Blocks until every mesh asked for so far is built, for the next BeginFrame to upload
+     */
+    void Wait() {
+        builder.Wait();
+    }
+
+    /**
+     * Frees the meshes drawn longest ago, beyond MAX_RESIDENT_CHUNKS
+     */
+    void EndFrame() {
+        if (resident.size() <= MAX_RESIDENT_CHUNKS) return;
+
+        std::vector<std::pair<uint64_t, size_t>> unseen;
+        for (const auto &[chunk, mesh] : resident) {
+            if (mesh.lastDrawn < frame) unseen.emplace_back(mesh.lastDrawn, chunk);
+        }
+        std::sort(unseen.begin(), unseen.end());
+        for (size_t i = 0; i < unseen.size() && resident.size() > MAX_RESIDENT_CHUNKS; ++i) {
+            const auto found = resident.find(unseen[i].second);
+            Delete(found->second);
+            // so that it is built again when it comes back into view
+            submitted[found->first] = 0;
+            resident.erase(found);
+        }
+    }
+
+    /**
+     * Frees every mesh. Call while the GL context is still current.
+     */
+    void Release() {
+        for (auto &[chunk, mesh] : resident) Delete(mesh);
+        resident.clear();
+    }
+};
@@ -0,0 +1,36 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+    uint64_t channel(float value) {
+        return static_cast<uint64_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255));
+    }
+}
+
+uint64_t DrawList::SortKey(uint32_t program, int32_t texID, glm::vec3 color, float depth) {
+    const uint64_t texture = static_cast<uint64_t>(texID + 1) & 0xFF;
+    const uint64_t rgb = texID == -1 ? channel(color.r) << 16 | channel(color.g) << 8 | channel(color.b) : 0;
+    // a non-negative float's bits sort as the float does
+    const uint64_t distance = std::bit_cast<uint32_t>(std::max(depth, 0.0f)) >> 8;
+    return uint64_t{program & 0xFF} << 56 | texture << 48 | rgb << 24 | distance;
+}
+
+void DrawList::Add(uint32_t program, uint32_t vertexArray, int32_t texID, glm::vec3 color, int32_t first,
+                   int32_t count, float depth) {
+    calls.push_back({
+            .key = SortKey(program, texID, color, depth),
+            .program = program,
+            .vertexArray = vertexArray,
+            .texID = texID,
+            .color = color,
+            .first = first,
+            .count = count,
+    });
+}
+
+void DrawList::Sort() {
+    std::sort(calls.begin(), calls.end(), [](const DrawCall &a, const DrawCall &b) { return a.key < b.key; });
+}
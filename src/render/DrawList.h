@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include <vec3.hpp>
+
+/**
+ * One glDrawArrays, with the state it needs
+ */
+struct DrawCall {
+    /** from DrawList::SortKey; calls are submitted in its order */
+    uint64_t key;
+    uint32_t program;
+    uint32_t vertexArray;
+    /** -1 for a flat colour */
+    int32_t texID;
+    /** only used when texID is -1 */
+    glm::vec3 color;
+    int32_t first;
+    int32_t count;
+};
+
+/**
+ * Draws recorded over a frame, then sorted so that draws sharing a shader, texture and colour are submitted together
+ * and, within those, front to back, letting the depth test reject hidden fragments before they are shaded.
+ */
+class DrawList {
+private:
+    std::vector<DrawCall> calls;
+
+public:
+    /**
+     * From the most significant bits down: the low 8 bits of the program, texID + 1 in 8 bits, the colour at 8 bits a
+     * channel (0 for a textured draw), and the top 24 bits of the depth, which keep the order of non-negative floats.
+     * @param depth how far the draw is from the camera, by any measure that grows with distance
+     */
+    static uint64_t SortKey(uint32_t program, int32_t texID, glm::vec3 color, float depth);
+
+    void Clear() {
+        calls.clear();
+    }
+
+    void Add(uint32_t program, uint32_t vertexArray, int32_t texID, glm::vec3 color, int32_t first, int32_t count,
+             float depth);
+
+    void Sort();
+
+    [[nodiscard]] std::span<const DrawCall> Calls() const {
+        return calls;
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return calls.size();
+    }
+};
+
+/**
+ * The state last set on the GL context, so that setting it again to the same value can be skipped. Each Set* returns
+ * whether the call has to be made. Anything that changes the context behind its back must be followed by Reset.
+ */
+class StateCache {
+private:
+    std::optional<uint32_t> program;
+    std::optional<uint32_t> vertexArray;
+    std::optional<size_t> drawBlock;
+    size_t issued = 0;
+    size_t skipped = 0;
+
+    template<typename T>
+    bool Set(std::optional<T> &current, const T &value) {
+        if (current == value) {
+            skipped += 1;
+            return false;
+        }
+        current = value;
+        issued += 1;
+        return true;
+    }
+
+public:
+    bool SetProgram(uint32_t value) {
+        return Set(program, value);
+    }
+
+    bool SetVertexArray(uint32_t value) {
+        return Set(vertexArray, value);
+    }
+
+    /**
+     * @param offset of the uniforms bound to the Draw block, which outlive a change of program
+     */
+    bool SetDrawBlock(size_t offset) {
+        return Set(drawBlock, offset);
+    }
+
+    /**
+     * Forgets everything, without clearing the counts
+     */
+    void Reset() {
+        program.reset();
+        vertexArray.reset();
+        drawBlock.reset();
+    }
+
+    /**
+     * @return how many Set* calls changed the state since ResetCounts
+     */
+    [[nodiscard]] size_t Issued() const {
+        return issued;
+    }
+
+    /**
+     * @return how many Set* calls found the state already set since ResetCounts
+     */
+    [[nodiscard]] size_t Skipped() const {
+        return skipped;
+    }
+
+    void ResetCounts() {
+        issued = skipped = 0;
+    }
+};
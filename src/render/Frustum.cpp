@@ -0,0 +1,139 @@
+#include "Frustum.h"
+
+#include <bit>
+
+#if defined(__AVX__) || defined(__SSE__)
+
+#include <immintrin.h>
+
+#endif
+
+namespace {
+#if defined(__AVX__)
+    using Vector = __m256;
+
+    inline Vector load(const float *p) { return _mm256_loadu_ps(p); }
+
+    inline Vector splat(float f) { return _mm256_set1_ps(f); }
+
+    inline Vector multiplyAdd(Vector a, Vector b, Vector c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+
+    inline Vector negative(Vector v) { return _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_LT_OQ); }
+
+    inline Vector either(Vector a, Vector b) { return _mm256_or_ps(a, b); }
+
+    inline Vector none() { return _mm256_setzero_ps(); }
+
+    inline uint32_t mask(Vector v) { return static_cast<uint32_t>(_mm256_movemask_ps(v)); }
+
+    constexpr size_t LANES = 8;
+    constexpr auto NAME = "AVX";
+#elif defined(__SSE__)
+    using Vector = __m128;
+
+    inline Vector load(const float *p) { return _mm_loadu_ps(p); }
+
+    inline Vector splat(float f) { return _mm_set1_ps(f); }
+
+    inline Vector multiplyAdd(Vector a, Vector b, Vector c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+    inline Vector negative(Vector v) { return _mm_cmplt_ps(v, _mm_setzero_ps()); }
+
+    inline Vector either(Vector a, Vector b) { return _mm_or_ps(a, b); }
+
+    inline Vector none() { return _mm_setzero_ps(); }
+
+    inline uint32_t mask(Vector v) { return static_cast<uint32_t>(_mm_movemask_ps(v)); }
+
+    constexpr size_t LANES = 4;
+    constexpr auto NAME = "SSE";
+#else
+    constexpr size_t LANES = 0;
+    constexpr auto NAME = "scalar";
+#endif
+}
+
+void BoxList::Clear() {
+    for (auto *values : {&minX, &minY, &minZ, &maxX, &maxY, &maxZ}) values->clear();
+}
+
+void BoxList::Add(glm::vec3 min, glm::vec3 max) {
+    minX.push_back(min.x);
+    minY.push_back(min.y);
+    minZ.push_back(min.z);
+    maxX.push_back(max.x);
+    maxY.push_back(max.y);
+    maxZ.push_back(max.z);
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4 &viewProj) {
+    // glm is column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const auto row = [&](int i) { return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]); };
+    return {.planes = {
+            row(3) + row(0), row(3) - row(0),
+            row(3) + row(1), row(3) - row(1),
+            row(3) + row(2), row(3) - row(2),
+    }};
+}
+
+bool Frustum::Intersects(glm::vec3 min, glm::vec3 max) const {
+    for (const auto &plane : planes) {
+        // the corner furthest along the normal is outside only if the whole box is
+        const glm::vec3 corner(plane.x >= 0 ? max.x : min.x, plane.y >= 0 ? max.y : min.y, plane.z >= 0 ? max.z : min.z);
+        // summed in the order Cull's vectors are, so both round alike
+        if (plane.w + plane.x * corner.x + plane.y * corner.y + plane.z * corner.z < 0) return false;
+    }
+    return true;
+}
+
+size_t Frustum::Cull(const BoxList &boxes, std::vector<uint8_t> &visible) const {
+    const size_t count = boxes.Size();
+    visible.resize(count);
+    size_t i = 0;
+    size_t passed = 0;
+#if defined(__AVX__) || defined(__SSE__)
+    // which corner is furthest along a plane's normal depends only on the plane, so it is a choice of arrays
+    std::array<std::array<const float *, 3>, 6> corners;
+    for (size_t p = 0; p < planes.size(); ++p) {
+        corners[p] = {
+                planes[p].x >= 0 ? boxes.maxX.data() : boxes.minX.data(),
+                planes[p].y >= 0 ? boxes.maxY.data() : boxes.minY.data(),
+                planes[p].z >= 0 ? boxes.maxZ.data() : boxes.minZ.data(),
+        };
+    }
+
+    for (; i + LANES <= count; i += LANES) {
+        Vector outside = none();
+        for (size_t p = 0; p < planes.size(); ++p) {
+            Vector distance = splat(planes[p].w);
+            distance = multiplyAdd(splat(planes[p].x), load(corners[p][0] + i), distance);
+            distance = multiplyAdd(splat(planes[p].y), load(corners[p][1] + i), distance);
+            distance = multiplyAdd(splat(planes[p].z), load(corners[p][2] + i), distance);
+            outside = either(outside, negative(distance));
+        }
+
+        const uint32_t culled = mask(outside);
+        for (size_t lane = 0; lane < LANES; ++lane) visible[i + lane] = (culled >> lane & 1) ^ 1;
+        passed += LANES - std::popcount(culled);
+    }
+#endif
+    for (; i < count; ++i) {
+        visible[i] = Intersects({boxes.minX[i], boxes.minY[i], boxes.minZ[i]}, {boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]});
+        passed += visible[i];
+    }
+    return passed;
+}
+
+size_t Frustum::CullScalar(const BoxList &boxes, std::vector<uint8_t> &visible) const {
+    visible.resize(boxes.Size());
+    size_t passed = 0;
+    for (size_t i = 0; i < boxes.Size(); ++i) {
+        visible[i] = Intersects({boxes.minX[i], boxes.minY[i], boxes.minZ[i]}, {boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]});
+        passed += visible[i];
+    }
+    return passed;
+}
+
+const char *Frustum::InstructionSet() {
+    return NAME;
+}
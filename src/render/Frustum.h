@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <mat4x4.hpp>
+#include <vec3.hpp>
+#include <vec4.hpp>
+
+/**
+ * Axis-aligned boxes in structure-of-arrays layout, so a Frustum can test several of them at once
+ */
+struct BoxList {
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+
+    void Clear();
+
+    void Add(glm::vec3 min, glm::vec3 max);
+
+    [[nodiscard]] size_t Size() const {
+        return minX.size();
+    }
+};
+
+/**
+ * The six planes of a view frustum, for culling boxes that cannot be seen
+ */
+struct Frustum {
+    /** (normal, distance) facing inwards: p is on the inside of a plane when dot(normal, p) + distance >= 0 */
+    std::array<glm::vec4, 6> planes;
+
+    /**
+     * Extracts the planes of proj * view (the Gribb-Hartmann method), for OpenGL's [-1, 1] clip depth
+     */
+    static Frustum FromMatrix(const glm::mat4 &viewProj);
+
+    /**
+     * Conservative: only a box entirely outside one plane is culled, so one that passes near a corner of the frustum
+     * may be kept, but one that can be seen never is culled
+     */
+    [[nodiscard]] bool Intersects(glm::vec3 min, glm::vec3 max) const;
+
+    /**
+     * Intersects for every box, 8 (AVX) or 4 (SSE) at a time when built for them
+     * @param visible resized to the boxes, and set to 1 for those that pass and 0 for the rest
+     * @return how many pass
+     */
+    size_t Cull(const BoxList &boxes, std::vector<uint8_t> &visible) const;
+
+    /**
+     * Cull, one box at a time
+     */
+    size_t CullScalar(const BoxList &boxes, std::vector<uint8_t> &visible) const;
+
+    /**
+     * @return the instruction set Cull was built with
+     */
+    static const char *InstructionSet();
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <render/RenderBackend.h>
+
+#include <type_ptr.hpp>
+
+/**
+ * The RenderBackend that draws: each call is the GL function of the same name
+ */
+class GLBackend : public RenderBackend {
+private:
+    static const void *Offset(size_t offset) {
+        return reinterpret_cast<const void *>(offset);
+    }
+
+public:
+    GLuint CreateVertexArray() override {
+        GLuint vertexArray;
+        glGenVertexArrays(1, &vertexArray);
+        return vertexArray;
+    }
+
+    void DeleteVertexArray(GLuint vertexArray) override {
+        glDeleteVertexArrays(1, &vertexArray);
+    }
+
+    GLuint CreateBuffer() override {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        return buffer;
+    }
+
+    void DeleteBuffer(GLuint buffer) override {
+        glDeleteBuffers(1, &buffer);
+    }
+
+    void BindVertexArray(GLuint vertexArray) override {
+        glBindVertexArray(vertexArray);
+    }
+
+    void BindBuffer(GLenum target, GLuint buffer) override {
+        glBindBuffer(target, buffer);
+    }
+
+    void BufferData(GLenum target, size_t bytes, const void *data, GLenum usage) override {
+        glBufferData(target, static_cast<GLsizeiptr>(bytes), data, usage);
+    }
+
+    void BufferSubData(GLenum target, size_t offset, size_t bytes, const void *data) override {
+        glBufferSubData(target, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(bytes), data);
+    }
+
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer) override {
+        glBindBufferBase(target, index, buffer);
+    }
+
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, size_t offset, size_t bytes) override {
+        glBindBufferRange(target, index, buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(bytes));
+    }
+
+    void VertexAttribPointer(GLuint index, GLint size, GLenum type, bool normalized, GLsizei stride,
+                             size_t offset) override {
+        glVertexAttribPointer(index, size, type, normalized ? GL_TRUE : GL_FALSE, stride, Offset(offset));
+    }
+
+    void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) override {
+        glVertexAttribIPointer(index, size, type, stride, Offset(offset));
+    }
+
+    void EnableVertexAttribArray(GLuint index) override {
+        glEnableVertexAttribArray(index);
+    }
+
+    void VertexAttribDivisor(GLuint index, GLuint divisor) override {
+        glVertexAttribDivisor(index, divisor);
+    }
+
+    void UseProgram(GLuint program) override {
+        glUseProgram(program);
+    }
+
+    GLint GetUniformLocation(GLuint program, const std::string &name) override {
+        return glGetUniformLocation(program, name.c_str());
+    }
+
+    GLint GetAttribLocation(GLuint program, const std::string &name) override {
+        return glGetAttribLocation(program, name.c_str());
+    }
+
+    GLuint GetUniformBlockIndex(GLuint program, const std::string &name) override {
+        return glGetUniformBlockIndex(program, name.c_str());
+    }
+
+    void UniformBlockBinding(GLuint program, GLuint block, GLuint binding) override {
+        glUniformBlockBinding(program, block, binding);
+    }
+
+    void Uniform(GLint location, int32_t value) override {
+        glUniform1i(location, value);
+    }
+
+    void Uniform(GLint location, const glm::vec3 &value) override {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+    }
+
+    void Uniform(GLint location, const glm::mat4 &value) override {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+
+    void ActiveTexture(GLenum unit) override {
+        glActiveTexture(unit);
+    }
+
+    void BindTexture(GLenum target, GLuint texture) override {
+        glBindTexture(target, texture);
+    }
+
+    void ClearColor(float r, float g, float b, float a) override {
+        glClearColor(r, g, b, a);
+    }
+
+    void Clear(GLbitfield mask) override {
+        glClear(mask);
+    }
+
+    void DrawArrays(GLenum mode, GLint first, GLsizei count) override {
+        glDrawArrays(mode, first, count);
+    }
+
+    void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) override {
+        glDrawArraysInstanced(mode, first, count, instances);
+    }
+};
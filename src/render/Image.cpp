@@ -0,0 +1,119 @@
+#include "Image.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+namespace {
+    constexpr size_t FILE_HEADER_SIZE = 14;
+    constexpr size_t INFO_HEADER_SIZE = 40;
+
+    uint32_t readLittle(const uint8_t *bytes, size_t count) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < count; ++i) value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+        return value;
+    }
+
+    void writeLittle(uint8_t *bytes, uint32_t value, size_t count) {
+        for (size_t i = 0; i < count; ++i) bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    std::ofstream openForWriting(const std::string &name) {
+        std::ofstream file(name, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            const auto msg = boost::format{"File %1% is not open for writing"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+        return file;
+    }
+}
+
+namespace Images {
+    Image loadBMP(const std::string &name) {
+        std::ifstream file(name, std::ios::binary);
+        if (!file.is_open()) {
+            const auto msg = boost::format{"File %1% is not open for reading"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+        const std::vector<uint8_t> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+        if (bytes.size() < FILE_HEADER_SIZE + INFO_HEADER_SIZE || bytes[0] != 'B' || bytes[1] != 'M') {
+            const auto msg = boost::format{"%1% is not a BMP"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+        const uint32_t offset = readLittle(&bytes[10], 4);
+        const auto width = static_cast<int32_t>(readLittle(&bytes[18], 4));
+        const auto height = static_cast<int32_t>(readLittle(&bytes[22], 4));
+        const uint32_t bits = readLittle(&bytes[28], 2);
+        const uint32_t compression = readLittle(&bytes[30], 4);
+        // 3 is BI_BITFIELDS, which 32-bit BMPs use to say their channels are in the usual places
+        if ((bits != 24 && bits != 32) || (compression != 0 && compression != 3) || width <= 0 || height == 0) {
+            const auto msg = boost::format{"%1% is a %2%-bit BMP with compression %3%; only uncompressed 24- and 32-bit "
+                                           "ones are read"} % name % bits % compression;
+            throw std::invalid_argument(msg.str());
+        }
+
+        // rows are stored bottom first unless the height is negative, each padded to 4 bytes
+        const size_t rows = height > 0 ? height : -static_cast<int64_t>(height);
+        const size_t pixelBytes = bits / 8;
+        const size_t stride = (width * pixelBytes + 3) & ~size_t{3};
+        if (offset + stride * rows > bytes.size()) {
+            const auto msg = boost::format{"%1% ends before its pixels do"} % name;
+            throw std::invalid_argument(msg.str());
+        }
+
+        Image image(width, rows);
+        for (size_t y = 0; y < rows; ++y) {
+            const uint8_t *row = &bytes[offset + stride * (height > 0 ? rows - 1 - y : y)];
+            for (size_t x = 0; x < image.width; ++x) {
+                uint8_t *pixel = image.At(x, y);
+                const uint8_t *stored = row + x * pixelBytes;
+                pixel[0] = stored[2];
+                pixel[1] = stored[1];
+                pixel[2] = stored[0];
+            }
+        }
+        return image;
+    }
+
+    void writeBMP(const Image &image, const std::string &name) {
+        auto file = openForWriting(name);
+
+        const size_t stride = (image.width * 3 + 3) & ~size_t{3};
+        uint8_t header[FILE_HEADER_SIZE + INFO_HEADER_SIZE] = {'B', 'M'};
+        writeLittle(&header[2], FILE_HEADER_SIZE + INFO_HEADER_SIZE + stride * image.height, 4);
+        writeLittle(&header[10], FILE_HEADER_SIZE + INFO_HEADER_SIZE, 4);
+        writeLittle(&header[14], INFO_HEADER_SIZE, 4);
+        writeLittle(&header[18], image.width, 4);
+        writeLittle(&header[22], image.height, 4);
+        writeLittle(&header[26], 1, 2);
+        writeLittle(&header[28], 24, 2);
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+        std::vector<uint8_t> row(stride);
+        for (size_t y = image.height; y-- > 0;) {
+            for (size_t x = 0; x < image.width; ++x) {
+                const uint8_t *pixel = image.At(x, y);
+                row[x * 3] = pixel[2];
+                row[x * 3 + 1] = pixel[1];
+                row[x * 3 + 2] = pixel[0];
+            }
+            file.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size()));
+        }
+    }
+
+    void writePPM(const Image &image, const std::string &name) {
+        auto file = openForWriting(name);
+        file << "P6\n" << image.width << " " << image.height << "\n255\n";
+        file.write(reinterpret_cast<const char *>(image.pixels.data()), static_cast<std::streamsize>(image.pixels.size()));
+    }
+
+    void write(const Image &image, const std::string &name) {
+        if (name.ends_with(".ppm")) {
+            writePPM(image, name);
+        } else {
+            writeBMP(image, name);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * 8-bit RGB pixels, top row first
+ */
+struct Image {
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<uint8_t> pixels;
+
+    Image() = default;
+
+    Image(size_t width, size_t height) : width(width), height(height), pixels(width * height * 3) {}
+
+    [[nodiscard]] uint8_t *At(size_t x, size_t y) {
+        return &pixels[(y * width + x) * 3];
+    }
+
+    [[nodiscard]] const uint8_t *At(size_t x, size_t y) const {
+        return &pixels[(y * width + x) * 3];
+    }
+};
+
+/**
+ * Reading textures and writing rendered frames, without SDL or a GL context
+ */
+namespace Images {
+    /**
+     * Reads an uncompressed 24- or 32-bit BMP, like the ones in textures/
+     * @throws std::invalid_argument if the file cannot be read or is some other kind of BMP
+     */
+    Image loadBMP(const std::string &name);
+
+    /**
+     * Writes a 24-bit BMP
+     * @throws std::invalid_argument if the file cannot be written
+     */
+    void writeBMP(const Image &image, const std::string &name);
+
+    /**
+     * Writes a binary (P6) PPM
+     * @throws std::invalid_argument if the file cannot be written
+     */
+    void writePPM(const Image &image, const std::string &name);
+
+    /**
+     * Writes a PPM for a name ending in .ppm, and a BMP otherwise
+     */
+    void write(const Image &image, const std::string &name);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <mat4x4.hpp>
+#include "render/RenderBackend.h"
+#include "render/Transforms.h"
+#include "utils.h"
+
+/**
+ * How one drawing of a Model is shaded, laid out as the colour and texID attributes of shaders/instanced-vertex.glsl
+ */
+struct ModelInstance {
+    glm::vec3 color;
+    /** the texture unit to sample, or -1 for color */
+    int32_t texID;
+};
+
+static_assert(sizeof(ModelInstance) == 16);
+
+/**
+ * Draws Models many times over with one glDrawArraysInstanced per Model a frame, whatever the number of instances.
+ *
+ * Instances are queued with Add and drawn by Flush from a single instance buffer, which is refilled every frame: the
+ * Transform of every instance, worked out together by Transforms::computeAll, then every ModelInstance. Each Model's
+ * instances are a run of both, and the instance attributes are pointed at the runs before its draw. Needs GL 3.3 for
+ * glVertexAttribDivisor.
+ */
+class InstanceRenderer {
+private:
+    // attribute locations, fixed by the layout qualifiers of the shader
+    static constexpr GLuint POSITION = 0;
+    static constexpr GLuint TEXCOORD = 1;
+    static constexpr GLuint NORMAL = 2;
+    static constexpr GLuint MVP = 3;
+    static constexpr GLuint MODEL_VIEW = 7;
+    static constexpr GLuint NORMAL_MATRIX = 11;
+    static constexpr GLuint COLOR = 14;
+    static constexpr GLuint TEX_ID = 15;
+
+    /** what a Model has queued, an entry of each per instance */
+    struct Queue {
+        std::vector<glm::mat4> models;
+        std::vector<ModelInstance> instances;
+    };
+
+    RenderBackend &backend;
+    GLuint program;
+    GLuint vao = 0;
+    GLuint instanceBuffer = 0;
+    glm::mat4 view = glm::mat4(1);
+    glm::mat4 proj = glm::mat4(1);
+    // a model and its instances, for the handful of models a scene uses; emptied, not removed, by Flush
+    std::vector<std::pair<const Model *, Queue>> queued;
+    // every queued instance of a frame, in the order they are drawn; kept between frames so they are not reallocated
+    std::vector<glm::mat4> models;
+    std::vector<Transform> transforms;
+    std::vector<ModelInstance> instances;
+
+    /**
+     * @param first the instance the run starts at
+     * @param total instances in the buffer, which the ModelInstances follow the Transforms of
+     */
+    void PointInstances(size_t first, size_t total) {
+        const auto transform = [first](size_t member) {
+            return first * sizeof(Transform) + member;
+        };
+        const auto instance = [first, total](size_t member) {
+            return total * sizeof(Transform) + first * sizeof(ModelInstance) + member;
+        };
+        for (GLuint column = 0; column < 4; ++column) {
+            backend.VertexAttribPointer(MVP + column, 4, GL_FLOAT, false, sizeof(Transform),
+                                        transform(offsetof(Transform, mvp) + column * sizeof(glm::vec4)));
+            backend.VertexAttribPointer(MODEL_VIEW + column, 4, GL_FLOAT, false, sizeof(Transform),
+                                        transform(offsetof(Transform, modelView) + column * sizeof(glm::vec4)));
+        }
+        for (GLuint column = 0; column < 3; ++column) {
+            backend.VertexAttribPointer(NORMAL_MATRIX + column, 3, GL_FLOAT, false, sizeof(Transform),
+                                        transform(offsetof(Transform, normal) + column * sizeof(glm::vec4)));
+        }
+        backend.VertexAttribPointer(COLOR, 3, GL_FLOAT, false, sizeof(ModelInstance),
+                                    instance(offsetof(ModelInstance, color)));
+        backend.VertexAttribIPointer(TEX_ID, 1, GL_INT, sizeof(ModelInstance),
+                                     instance(offsetof(ModelInstance, texID)));
+    }
+
+public:
+    /**
+     * Leaves the program in use. The light comes from the program's Frame block, see UniformBlocks.
+     * @param modelBuffer the vertex buffer of the combined models, which every Model's startVertices is into
+     */
+    InstanceRenderer(RenderBackend &backend, GLuint program, GLuint modelBuffer) : backend(backend), program(program) {
+        backend.UseProgram(program);
+        backend.Uniform(backend.GetUniformLocation(program, "tex0"), 0);
+        backend.Uniform(backend.GetUniformLocation(program, "tex1"), 1);
+
+        vao = backend.CreateVertexArray();
+        backend.BindVertexArray(vao);
+
+        const GLsizei stride = 8 * sizeof(float);
+        backend.BindBuffer(GL_ARRAY_BUFFER, modelBuffer);
+        backend.VertexAttribPointer(POSITION, 3, GL_FLOAT, false, stride, 0);
+        backend.VertexAttribPointer(TEXCOORD, 2, GL_FLOAT, false, stride, 3 * sizeof(float));
+        backend.VertexAttribPointer(NORMAL, 3, GL_FLOAT, false, stride, 5 * sizeof(float));
+        for (GLuint attribute : {POSITION, TEXCOORD, NORMAL}) backend.EnableVertexAttribArray(attribute);
+
+        instanceBuffer = backend.CreateBuffer();
+        backend.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        PointInstances(0, 0);
+        for (GLuint attribute = MVP; attribute <= TEX_ID; ++attribute) {
+            backend.EnableVertexAttribArray(attribute);
+            backend.VertexAttribDivisor(attribute, 1);
+        }
+        backend.BindVertexArray(0);
+    }
+
+    /**
+     * For the transforms of the next Flush
+     */
+    void SetCamera(const glm::mat4 &newView, const glm::mat4 &newProj) {
+        view = newView;
+        proj = newProj;
+    }
+
+    void Add(const Model &model, const glm::mat4 &transform, glm::vec3 color, int32_t texID) {
+        auto found = queued.begin();
+        while (found != queued.end() && found->first != &model) ++found;
+        if (found == queued.end()) found = queued.insert(found, {&model, {}});
+        found->second.models.push_back(transform);
+        found->second.instances.push_back({.color = color, .texID = texID});
+    }
+
+    /**
+     * Draws everything added since the last Flush. Leaves the instanced program and vertex array bound, so the caller
+     * has to set its own again (querying what was bound would stall on the driver).
+     */
+    void Flush() {
+        models.clear();
+        instances.clear();
+        for (const auto &[model, queue] : queued) {
+            models.insert(models.end(), queue.models.begin(), queue.models.end());
+            instances.insert(instances.end(), queue.instances.begin(), queue.instances.end());
+        }
+        const size_t total = models.size();
+        if (total == 0) return;
+
+        // all at once, so the SIMD lanes are filled across models
+        transforms.resize(total);
+        Transforms::computeAll(view, proj, models, transforms);
+
+        backend.UseProgram(program);
+        backend.BindVertexArray(vao);
+        backend.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        // orphan last frame's buffer rather than wait for its draws to finish
+        const size_t transformBytes = total * sizeof(Transform);
+        backend.BufferData(GL_ARRAY_BUFFER, transformBytes + total * sizeof(ModelInstance), nullptr, GL_STREAM_DRAW);
+        backend.BufferSubData(GL_ARRAY_BUFFER, 0, transformBytes, transforms.data());
+        backend.BufferSubData(GL_ARRAY_BUFFER, transformBytes, total * sizeof(ModelInstance), instances.data());
+
+        size_t first = 0;
+        for (auto &[model, queue] : queued) {
+            const size_t count = queue.models.size();
+            if (count == 0) continue;
+            PointInstances(first, total);
+            backend.DrawArraysInstanced(GL_TRIANGLES, (GLint) model->startVertices, (GLsizei) model->GetNumberVertices(),
+                                        (GLsizei) count);
+            first += count;
+            queue.models.clear();
+            queue.instances.clear();
+        }
+    }
+
+    /**
+     * Call while the GL context is still current
+     */
+    void Release() {
+        backend.DeleteBuffer(instanceBuffer);
+        backend.DeleteVertexArray(vao);
+    }
+};
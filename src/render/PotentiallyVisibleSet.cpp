@@ -0,0 +1,158 @@
+#include "PotentiallyVisibleSet.h"
+
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+namespace {
+    /**
+     * Where rays start in an open cell: its centre and near its corners, since the viewer can be anywhere in it
+     */
+    constexpr float SAMPLE_OFFSETS[][2] = {{0, 0}, {-.45f, -.45f}, {.45f, -.45f}, {-.45f, .45f}, {.45f, .45f}};
+
+    bool opaque(Cell cell) {
+        return cell.GetTag() == Tag::WALL || cell.GetTag() == Tag::DOOR;
+    }
+}
+
+PotentiallyVisibleSet::PotentiallyVisibleSet(const Map &map, float radius) : map(map), radius(radius) {
+    if (!(radius > 0 && radius <= MAX_RADIUS)) {
+        const auto msg = boost::format{"A view radius of %1% is not between 0 and %2%"} % radius % MAX_RADIUS;
+        throw std::invalid_argument(msg.str());
+    }
+    InvalidateAll();
+}
+
+uint16_t PotentiallyVisibleSet::Compute(size_t cluster) {
+    const size_t x0 = cluster % clustersX << CLUSTER_BITS;
+    const size_t y0 = cluster / clustersX << CLUSTER_BITS;
+    const size_t x1 = std::min(x0 + CLUSTER_SIZE, map.width);
+    const size_t y1 = std::min(y0 + CLUSTER_SIZE, map.height);
+    const auto homeX = static_cast<long>(x0 >> CHUNK_BITS);
+    const auto homeY = static_cast<long>(y0 >> CHUNK_BITS);
+
+    // copy out every cell a ray can reach once, rather than going through the map a step at a time
+    const float length = radius + MODEL_EXTENT;
+    const auto reach = static_cast<size_t>(std::ceil(length)) + 1;
+    const long areaX = static_cast<long>(x0 > reach ? x0 - reach : 0);
+    const long areaY = static_cast<long>(y0 > reach ? y0 - reach : 0);
+    const long areaWidth = static_cast<long>(std::min(x1 + reach, map.width)) - areaX;
+    const long areaHeight = static_cast<long>(std::min(y1 + reach, map.height)) - areaY;
+    area.assign(areaWidth * areaHeight, Cell::Wall());
+    map.ForEachCellIn(areaX, areaY, areaX + areaWidth, areaY + areaHeight, [&](size_t x, size_t y, Cell cell) {
+        area[(y - areaY) * areaWidth + x - areaX] = cell;
+    });
+
+    uint16_t mask = COMPUTED;
+    const auto see = [&](long x, long y) {
+        mask |= 1 << (((y >> CHUNK_BITS) - homeY + 1) * 3 + (x >> CHUNK_BITS) - homeX + 1);
+    };
+
+    // rays close enough together that every cell in reach is crossed by one from each start
+    const auto rays = static_cast<size_t>(std::ceil(4 * std::numbers::pi * (length + 1)));
+    bool open = false;
+    for (size_t y = y0; y < y1; ++y) {
+        for (size_t x = x0; x < x1; ++x) {
+            if (opaque(area[(y - areaY) * areaWidth + x - areaX])) continue;
+            open = true;
+
+            for (const auto &offset : SAMPLE_OFFSETS) {
+                // cell (i, j) covers [i - .5, i + .5) x [j - .5, j + .5), so start in units where it is [i, i + 1)
+                const double startX = static_cast<double>(x) + offset[0] + .5;
+                const double startY = static_cast<double>(y) + offset[1] + .5;
+                for (size_t ray = 0; ray < rays; ++ray) {
+                    const double angle = 2 * std::numbers::pi * static_cast<double>(ray) / static_cast<double>(rays);
+                    const double dx = std::cos(angle), dy = std::sin(angle);
+
+                    // walk the cells the ray crosses (Amanatides and Woo)
+                    auto cellX = static_cast<long>(std::floor(startX)), cellY = static_cast<long>(std::floor(startY));
+                    const long stepX = dx >= 0 ? 1 : -1, stepY = dy >= 0 ? 1 : -1;
+                    const double deltaX = dx != 0 ? 1 / std::abs(dx) : INFINITY;
+                    const double deltaY = dy != 0 ? 1 / std::abs(dy) : INFINITY;
+                    double nextX = dx != 0 ? (stepX > 0 ? cellX + 1 - startX : startX - cellX) * deltaX : INFINITY;
+                    double nextY = dy != 0 ? (stepY > 0 ? cellY + 1 - startY : startY - cellY) * deltaY : INFINITY;
+
+                    while (cellX >= areaX && cellX < areaX + areaWidth && cellY >= areaY && cellY < areaY + areaHeight) {
+                        see(cellX, cellY);
+                        const Cell cell = area[(cellY - areaY) * areaWidth + cellX - areaX];
+                        if (cell.GetTag() == Tag::DOOR) {
+                            auto &clusters = portals[cellY * map.width + cellX];
+                            if (clusters.empty() || clusters.back() != cluster) clusters.push_back(cluster);
+                        }
+                        if (opaque(cell)) break;
+
+                        if (nextX < nextY) {
+                            if (nextX > length) break;
+                            cellX += stepX;
+                            nextX += deltaX;
+                        } else {
+                            if (nextY > length) break;
+                            cellY += stepY;
+                            nextY += deltaY;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // nobody stands in a cluster of walls, but if the camera gets there it should still see
+    return open ? mask : COMPUTED | ALL_CHUNKS;
+}
+
+void PotentiallyVisibleSet::Precompute() {
+    for (size_t cluster = 0; cluster < masks.size(); ++cluster) {
+        if (masks[cluster] & COMPUTED) continue;
+        masks[cluster] = Compute(cluster);
+        computed += 1;
+    }
+}
+
+bool PotentiallyVisibleSet::Visible(size_t x, size_t y, size_t chunk) {
+    x = std::min(x, map.width - 1);
+    y = std::min(y, map.height - 1);
+    auto &mask = masks[(y >> CLUSTER_BITS) * clustersX + (x >> CLUSTER_BITS)];
+    if ((mask & COMPUTED) == 0) {
+        mask = Compute((y >> CLUSTER_BITS) * clustersX + (x >> CLUSTER_BITS));
+        computed += 1;
+    }
+
+    const long dx = static_cast<long>(chunk % map.ChunksX()) - static_cast<long>(x >> CHUNK_BITS) + 1;
+    const long dy = static_cast<long>(chunk / map.ChunksX()) - static_cast<long>(y >> CHUNK_BITS) + 1;
+    if (dx < 0 || dx > 2 || dy < 0 || dy > 2) return false;
+    return mask >> (dy * 3 + dx) & 1;
+}
+
+void PotentiallyVisibleSet::OpenDoor(size_t x, size_t y) {
+    const auto found = portals.find(y * map.width + x);
+    if (found == portals.end()) return;
+    for (const auto cluster : found->second) {
+        if (masks[cluster] & COMPUTED) computed -= 1;
+        masks[cluster] = 0;
+    }
+    portals.erase(found);
+}
+
+void PotentiallyVisibleSet::Invalidate(size_t x, size_t y) {
+    const auto reach = static_cast<size_t>(std::ceil(radius + MODEL_EXTENT)) + 1;
+    const size_t clustersY = masks.size() / clustersX;
+    const size_t fromX = (x > reach ? x - reach : 0) >> CLUSTER_BITS;
+    const size_t fromY = (y > reach ? y - reach : 0) >> CLUSTER_BITS;
+    const size_t toX = std::min((x + reach) >> CLUSTER_BITS, clustersX - 1);
+    const size_t toY = std::min((y + reach) >> CLUSTER_BITS, clustersY - 1);
+    for (size_t cy = fromY; cy <= toY; ++cy) {
+        for (size_t cx = fromX; cx <= toX; ++cx) {
+            auto &mask = masks[cy * clustersX + cx];
+            if (mask & COMPUTED) computed -= 1;
+            mask = 0;
+        }
+    }
+}
+
+void PotentiallyVisibleSet::InvalidateAll() {
+    clustersX = (map.width + CLUSTER_SIZE - 1) >> CLUSTER_BITS;
+    masks.assign(clustersX * ((map.height + CLUSTER_SIZE - 1) >> CLUSTER_BITS), 0);
+    portals.clear();
+    computed = 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <repr/Map.h>
+
+/**
+ * Which chunks can be seen from where, so chunks hidden behind the walls of a maze are not drawn at all.
+ *
+ * The map is split into CLUSTER_SIZE x CLUSTER_SIZE clusters of cells. For each cluster, rays are cast out to `radius`
+ * from points all over its open cells, and every chunk a ray reaches before it hits a wall or a closed door goes in
+ * the cluster's set. A set only ever holds the 3 x 3 chunks around the cluster's own, so it is a bitmask. Sampling
+ * makes the sets very nearly, not strictly, conservative.
+ *
+ * Closed doors are portals: a cluster whose rays stopped at a door is remembered with the door, so opening it only
+ * recomputes those clusters. Sets are computed the first time they are asked for, or all at once by Precompute.
+ * Walls are taken to be taller than the viewer, so sets do not hold for a camera above them.
+ */
+class PotentiallyVisibleSet {
+public:
+    static constexpr size_t CLUSTER_BITS = 2;
+    static constexpr size_t CLUSTER_SIZE = 1 << CLUSTER_BITS;
+    /** models reach this far past the centre of their cell, so rays go this much further than the radius */
+    static constexpr float MODEL_EXTENT = 1.0f;
+    /** the furthest a ray can go while every cell it reaches is in the 3 x 3 chunks around its cluster's */
+    static constexpr float MAX_RADIUS = CHUNK_SIZE - 2 - MODEL_EXTENT;
+
+private:
+    // set on a cluster's mask once it is computed; the low 9 bits are the chunks around its own, row by row
+    static constexpr uint16_t COMPUTED = 1 << 15;
+    static constexpr uint16_t ALL_CHUNKS = (1 << 9) - 1;
+
+    const Map &map;
+    float radius;
+    size_t clustersX = 0;
+    std::vector<uint16_t> masks;
+    // door cell (y * width + x) -> clusters whose rays stopped at it
+    std::unordered_map<uint64_t, std::vector<uint32_t>> portals;
+    size_t computed = 0;
+    // the cells around the cluster being computed, reused between clusters
+    std::vector<Cell> area;
+
+    uint16_t Compute(size_t cluster);
+
+public:
+    /**
+     * @param radius how far can be seen
+     * @throws std::invalid_argument if it is not in (0, MAX_RADIUS]
+     */
+    PotentiallyVisibleSet(const Map &map, float radius);
+
+    /**
+     * Computes every cluster now rather than as they are asked for
+     */
+    void Precompute();
+
+    /**
+     * @return whether anything of chunk (cy * ChunksX() + cx) can be seen from the cluster of cell (x, y)
+     */
+    bool Visible(size_t x, size_t y, size_t chunk);
+
+    /**
+     * Recomputes the clusters that could see a door that was just opened
+     */
+    void OpenDoor(size_t x, size_t y);
+
+    /**
+     * Recomputes the clusters that can see as far as a cell whose contents changed
+     */
+    void Invalidate(size_t x, size_t y);
+
+    /**
+     * Recomputes everything, for when the whole map changed (or was replaced by one of another size)
+     */
+    void InvalidateAll();
+
+    [[nodiscard]] float Radius() const {
+        return radius;
+    }
+
+    /**
+     * @return how many clusters have their set computed
+     */
+    [[nodiscard]] size_t ComputedClusters() const {
+        return computed;
+    }
+};
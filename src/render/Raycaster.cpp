@@ -0,0 +1,364 @@
+#include "Raycaster.h"
+
+#include <render/ChunkMesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <boost/format.hpp>
+
+#if defined(__AVX__) || defined(__SSE2__)
+
+#include <immintrin.h>
+
+#endif
+
+namespace {
+#if defined(__AVX__)
+    using Vector = __m256;
+
+    inline Vector load(const float *p) { return _mm256_loadu_ps(p); }
+
+    inline Vector splat(float f) { return _mm256_set1_ps(f); }
+
+    inline Vector add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+
+    inline Vector subtract(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+
+    inline Vector multiply(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+
+    inline Vector multiplyAdd(Vector a, Vector b, Vector c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+
+    inline Vector divide(Vector a, Vector b) { return _mm256_div_ps(a, b); }
+
+    inline Vector minimum(Vector a, Vector b) { return _mm256_min_ps(a, b); }
+
+    inline Vector less(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+
+    inline Vector lessEqual(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+
+    inline Vector both(Vector a, Vector b) { return _mm256_and_ps(a, b); }
+
+    inline uint32_t mask(Vector v) { return static_cast<uint32_t>(_mm256_movemask_ps(v)); }
+
+    /** rounds towards zero, which is down for what is never negative */
+    inline Vector truncate(Vector v) { return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(v)); }
+
+    inline void storeIndices(int32_t *p, Vector v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm256_cvttps_epi32(v));
+    }
+
+    constexpr size_t LANES = 8;
+    constexpr auto NAME = "AVX";
+#elif defined(__SSE2__)
+    using Vector = __m128;
+
+    inline Vector load(const float *p) { return _mm_loadu_ps(p); }
+
+    inline Vector splat(float f) { return _mm_set1_ps(f); }
+
+    inline Vector add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+
+    inline Vector subtract(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+
+    inline Vector multiply(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+
+    inline Vector multiplyAdd(Vector a, Vector b, Vector c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+    inline Vector divide(Vector a, Vector b) { return _mm_div_ps(a, b); }
+
+    inline Vector minimum(Vector a, Vector b) { return _mm_min_ps(a, b); }
+
+    inline Vector less(Vector a, Vector b) { return _mm_cmplt_ps(a, b); }
+
+    inline Vector lessEqual(Vector a, Vector b) { return _mm_cmple_ps(a, b); }
+
+    inline Vector both(Vector a, Vector b) { return _mm_and_ps(a, b); }
+
+    inline uint32_t mask(Vector v) { return static_cast<uint32_t>(_mm_movemask_ps(v)); }
+
+    inline Vector truncate(Vector v) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(v)); }
+
+    inline void storeIndices(int32_t *p, Vector v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_cvttps_epi32(v));
+    }
+
+    constexpr size_t LANES = 4;
+    constexpr auto NAME = "SSE2";
+#else
+    constexpr size_t LANES = 0;
+    constexpr auto NAME = "scalar";
+#endif
+
+    // the cube faces the light of shaders/textured-*.glsl, normalize(-1, 1, -1), falls on are +x, -y and the top, each
+    // at 1/sqrt(3); the other sides only get the ambient light
+    constexpr float AMBIENT = .3f;
+    const float LIT = AMBIENT + 1 / std::sqrt(3.0f);
+
+    // the clear colour of the game
+    constexpr uint32_t SKY = 0xCC6633;
+
+    // walls and doors span z from -0.5 to 0.5, and floors end at -0.5, as the chunk meshes place them
+    constexpr float WALL_TOP = 0.5f;
+    constexpr float FLOOR_TOP = -0.5f;
+
+#if defined(__AVX__) || defined(__SSE2__)
+    /**
+     * Writes the texels at the indices of the lanes that see something, and the sky for the others
+     */
+    inline void gather(const uint32_t *texels, Vector index, Vector seen, uint32_t *out) {
+#if defined(__AVX2__)
+        const __m256i gathered = _mm256_mask_i32gather_epi32(_mm256_set1_epi32(SKY), reinterpret_cast<const int *>(texels),
+                                                             _mm256_cvttps_epi32(index), _mm256_castps_si256(seen), 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), gathered);
+#else
+        alignas(32) int32_t indices[LANES];
+        // lanes that see nothing would read any texel, so they read the first
+        storeIndices(indices, both(index, seen));
+        const uint32_t visible = mask(seen);
+        for (size_t lane = 0; lane < LANES; ++lane) out[lane] = visible >> lane & 1 ? texels[indices[lane]] : SKY;
+#endif
+    }
+#endif
+
+    uint32_t pack(float r, float g, float b) {
+        const auto channel = [](float c) { return static_cast<uint32_t>(std::clamp(c, 0.0f, 255.0f) + .5f); };
+        return channel(r) | channel(g) << 8 | channel(b) << 16;
+    }
+
+    /** what a column's ray hit */
+    struct Hit {
+        /** along the view direction, so that walls are not bent */
+        float depth;
+        size_t x, y;
+        Tag tag;
+        /** across the face, as the cube's texture coordinates run */
+        float u = 0;
+        bool lit = false;
+    };
+
+    std::optional<Hit> cast(const Map &map, float x, float y, float rayX, float rayY, float far) {
+        // cells are centred on integers, so their edges are at integers once shifted by half a cell
+        x += .5f;
+        y += .5f;
+        auto cellX = static_cast<int64_t>(std::floor(x));
+        auto cellY = static_cast<int64_t>(std::floor(y));
+        const int64_t stepX = rayX < 0 ? -1 : 1, stepY = rayY < 0 ? -1 : 1;
+        const float deltaX = std::abs(1 / rayX), deltaY = std::abs(1 / rayY);
+        float nextX = (rayX < 0 ? x - static_cast<float>(cellX) : static_cast<float>(cellX) + 1 - x) * deltaX;
+        float nextY = (rayY < 0 ? y - static_cast<float>(cellY) : static_cast<float>(cellY) + 1 - y) * deltaY;
+
+        while (true) {
+            float depth;
+            bool acrossX = nextX < nextY;
+            if (acrossX) {
+                depth = nextX;
+                nextX += deltaX;
+                cellX += stepX;
+            } else {
+                depth = nextY;
+                nextY += deltaY;
+                cellY += stepY;
+            }
+            if (depth > far) return std::nullopt;
+            if (cellX < 0 || cellY < 0 || cellX >= static_cast<int64_t>(map.width) ||
+                cellY >= static_cast<int64_t>(map.height)) {
+                // the ray only gets further from the map once it has left it
+                if ((cellX < 0 && stepX < 0) || (cellY < 0 && stepY < 0) ||
+                    (cellX >= static_cast<int64_t>(map.width) && stepX > 0) ||
+                    (cellY >= static_cast<int64_t>(map.height) && stepY > 0)) {
+                    return std::nullopt;
+                }
+                continue;
+            }
+
+            const Tag tag = map.GetElement(cellX, cellY).GetTag();
+            if (tag != Tag::WALL && tag != Tag::DOOR) continue;
+
+            // the face's texture runs along +y on the +x side, -y on -x, -x on +y and +x on -y
+            Hit hit = {.depth = depth, .x = static_cast<size_t>(cellX), .y = static_cast<size_t>(cellY), .tag = tag};
+            if (acrossX) {
+                const float along = y + depth * rayY - static_cast<float>(cellY);
+                hit.u = stepX < 0 ? along : 1 - along;
+                hit.lit = stepX < 0;
+            } else {
+                const float along = x + depth * rayX - static_cast<float>(cellX);
+                hit.u = stepY < 0 ? 1 - along : along;
+                hit.lit = stepY > 0;
+            }
+            return hit;
+        }
+    }
+}
+
+Raycaster::Texture::Texture(const Image &image, float light) : width(image.width), height(image.height),
+                                                              texels(image.width * image.height) {
+    for (size_t x = 0; x < width; ++x) {
+        for (size_t y = 0; y < height; ++y) {
+            const uint8_t *pixel = image.At(x, y);
+            texels[x * height + y] = pack(pixel[0] * light, pixel[1] * light, pixel[2] * light);
+        }
+    }
+}
+
+Raycaster::Raycaster(const Map &map, const Image &wall, const Image &floor, size_t width, size_t height,
+                     size_t threads)
+        : map(map), width(width), height(height),
+          threads(threads != 0 ? threads : std::max(1U, std::thread::hardware_concurrency())),
+          litWall(wall, LIT), shadedWall(wall, AMBIENT), floor(floor, LIT), columns(width * height),
+          frame(width, height) {
+    if (width == 0 || height == 0 || wall.pixels.empty() || floor.pixels.empty()) {
+        const auto msg = boost::format{"Cannot raycast a %1%x%2% frame with a %3%x%4% wall and %5%x%6% floor"} % width %
+                         height % wall.width % wall.height % floor.width % floor.height;
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+const char *Raycaster::InstructionSet() {
+    return NAME;
+}
+
+const Image &Raycaster::Render(const State &state, float far) {
+    // the game looks along (-cos angle, sin angle, -sin angle2), with +z up
+    const float tanHalfY = std::tan(FOV_Y / 2);
+    const View view = {
+            .x = state.camPosition.x,
+            .y = state.camPosition.y,
+            .z = state.camPosition.z,
+            .forwardX = -std::cos(state.angle),
+            .forwardY = std::sin(state.angle),
+            .rightX = std::sin(state.angle),
+            .rightY = std::cos(state.angle),
+            .tanHalfX = tanHalfY * static_cast<float>(width) / static_cast<float>(height),
+            .tanHalfY = tanHalfY,
+            .pitch = -std::sin(state.angle2),
+            .far = far,
+    };
+
+    const size_t slices = std::min(threads, width);
+    std::vector<std::thread> workers;
+    for (size_t slice = 1; slice < slices; ++slice) {
+        workers.emplace_back([&, slice] { RenderColumns(view, width * slice / slices, width * (slice + 1) / slices); });
+    }
+    RenderColumns(view, 0, width / slices);
+    for (auto &worker : workers) worker.join();
+    return frame;
+}
+
+void Raycaster::RenderColumns(const View &view, size_t begin, size_t end) {
+    for (size_t x = begin; x < end; ++x) RenderColumn(view, x, &columns[x * height]);
+
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = begin; x < end; ++x) {
+            const uint32_t texel = columns[x * height + y];
+            uint8_t *pixel = frame.At(x, y);
+            pixel[0] = static_cast<uint8_t>(texel);
+            pixel[1] = static_cast<uint8_t>(texel >> 8);
+            pixel[2] = static_cast<uint8_t>(texel >> 16);
+        }
+    }
+}
+
+void Raycaster::RenderColumn(const View &view, size_t x, uint32_t *column) const {
+    const float screenX = (2 * (static_cast<float>(x) + .5f) / static_cast<float>(width) - 1) * view.tanHalfX;
+    const float rayX = view.forwardX + view.rightX * screenX;
+    const float rayY = view.forwardY + view.rightY * screenX;
+
+    // what shows at a row is what is seen at this slope, height over distance, in front of the camera
+    const float firstSlope = (1 - 1 / static_cast<float>(height)) * view.tanHalfY + view.pitch;
+    const float slopeStep = -2 * view.tanHalfY / static_cast<float>(height);
+    const auto firstRowBelow = [&](float slope) {
+        return static_cast<size_t>(std::clamp(std::floor((slope - firstSlope) / slopeStep) + 1, 0.0f,
+                                              static_cast<float>(height)));
+    };
+
+#if defined(__AVX__) || defined(__SSE2__)
+    alignas(32) float lanes[LANES];
+    for (size_t lane = 0; lane < LANES; ++lane) lanes[lane] = static_cast<float>(lane);
+    const Vector offsets = load(lanes);
+#endif
+
+    size_t row = 0;
+    const auto hit = cast(map, view.x, view.y, rayX, rayY, view.far);
+    if (hit) {
+        const size_t top = std::min(firstRowBelow((WALL_TOP - view.z) / hit->depth), height);
+        const size_t bottom = std::max(firstRowBelow((FLOOR_TOP - view.z) / hit->depth), top);
+        std::fill(column, column + top, SKY);
+        row = top;
+
+        if (hit->tag == Tag::DOOR) {
+            const float shade = static_cast<float>(map.GetId(hit->x, hit->y) % DOOR_SHADES) / DOOR_SHADES;
+            std::fill(column + top, column + bottom, pack(shade * (hit->lit ? LIT : AMBIENT) * 255, 0, 0));
+        } else {
+            // down the face v runs from the top of the texture at the bottom of the wall, as on the cube
+            const Texture &texture = hit->lit ? litWall : shadedWall;
+            const auto texelX = static_cast<size_t>(std::clamp(hit->u * static_cast<float>(texture.width), 0.0f,
+                                                               static_cast<float>(texture.width - 1)));
+            const uint32_t *texels = &texture.texels[texelX * texture.height];
+            const auto texelsY = static_cast<float>(texture.height);
+            const float firstV = view.z - FLOOR_TOP + firstSlope * hit->depth;
+            const float stepV = slopeStep * hit->depth;
+#if defined(__AVX__) || defined(__SSE2__)
+            for (; row + LANES <= bottom; row += LANES) {
+                const Vector rows = add(offsets, splat(static_cast<float>(row)));
+                const Vector v = multiplyAdd(rows, splat(stepV), splat(firstV));
+                alignas(32) int32_t indices[LANES];
+                storeIndices(indices, minimum(multiply(v, splat(texelsY)), splat(texelsY - 1)));
+                for (size_t lane = 0; lane < LANES; ++lane) column[row + lane] = texels[std::max(indices[lane], 0)];
+            }
+#endif
+            for (; row < bottom; ++row) {
+                const float v = firstV + static_cast<float>(row) * stepV;
+                column[row] = texels[std::clamp(static_cast<int64_t>(v * texelsY), int64_t{0},
+                                                static_cast<int64_t>(texture.height) - 1)];
+            }
+        }
+        row = bottom;
+    }
+
+    // the floor is only seen below the horizon
+    const size_t horizon = std::max(row, firstRowBelow(0));
+    std::fill(column + row, column + horizon, SKY);
+    row = horizon;
+
+    // under each row is the floor at the distance where its slope reaches the floor, if that is on the map
+    const float below = FLOOR_TOP - view.z;
+    const float originX = view.x + .5f, originY = view.y + .5f;
+    const auto mapWidth = static_cast<float>(map.width), mapHeight = static_cast<float>(map.height);
+    const auto texelsX = static_cast<float>(floor.width), texelsY = static_cast<float>(floor.height);
+    const uint32_t *texels = floor.texels.data();
+#if defined(__AVX__) || defined(__SSE2__)
+    const Vector zero = splat(0);
+    for (; row + LANES <= height; row += LANES) {
+        const Vector rows = add(offsets, splat(static_cast<float>(row)));
+        const Vector slope = multiplyAdd(rows, splat(slopeStep), splat(firstSlope));
+        const Vector depth = divide(splat(below), slope);
+        const Vector worldX = multiplyAdd(depth, splat(rayX), splat(originX));
+        const Vector worldY = multiplyAdd(depth, splat(rayY), splat(originY));
+        Vector seen = both(less(slope, zero), lessEqual(depth, splat(view.far)));
+        seen = both(seen, both(lessEqual(zero, worldX), less(worldX, splat(mapWidth))));
+        seen = both(seen, both(lessEqual(zero, worldY), less(worldY, splat(mapHeight))));
+
+        const Vector u = subtract(worldX, truncate(worldX));
+        const Vector v = subtract(worldY, truncate(worldY));
+        const Vector texelX = minimum(truncate(multiply(u, splat(texelsX))), splat(texelsX - 1));
+        const Vector texelY = minimum(truncate(multiply(v, splat(texelsY))), splat(texelsY - 1));
+        gather(texels, multiplyAdd(texelX, splat(texelsY), texelY), seen, column + row);
+    }
+#endif
+    for (; row < height; ++row) {
+        const float slope = firstSlope + static_cast<float>(row) * slopeStep;
+        const float depth = below / slope;
+        const float worldX = originX + depth * rayX, worldY = originY + depth * rayY;
+        if (slope >= 0 || depth > view.far || worldX < 0 || worldX >= mapWidth || worldY < 0 || worldY >= mapHeight) {
+            column[row] = SKY;
+            continue;
+        }
+        const float u = worldX - std::trunc(worldX), v = worldY - std::trunc(worldY);
+        const float texelX = std::min(std::trunc(u * texelsX), texelsX - 1);
+        const float texelY = std::min(std::trunc(v * texelsY), texelsY - 1);
+        column[row] = texels[static_cast<size_t>(texelX * texelsY + texelY)];
+    }
+}
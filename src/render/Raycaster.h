@@ -0,0 +1,84 @@
+#pragma once
+
+#include <State.h>
+#include <render/Image.h>
+#include <repr/Map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Draws the first-person view straight from the Map grid, Wolfenstein style, for a frame at a fraction of the cost of
+ * rasterizing the level's cubes: on machines without a GPU, or as a quick preview.
+ *
+ * Each screen column casts one ray through the grid (a DDA, stepping cell by cell) to the first wall or door, which
+ * fills the column between its top and bottom edges; below it the floor is cast row by row, and everything else is
+ * sky. Columns are split across threads, and the texture coordinates, texel addresses and visibility of each column
+ * are worked out 8 rows at a time with AVX, or 4 with SSE2; with AVX2 the floor's texels are fetched by a gather too.
+ * The picture follows the game's: walls and floors are the cubes of the chunk meshes, textured the same way and with
+ * the same ambient and diffuse light, and doors are in their shade of red.
+ *
+ * Unlike the game, looking up or down shears the view rather than tilting it, which keeps walls upright and is close
+ * for the pitches a player looks at. Textures are sampled at the nearest texel, there is no specular highlight, and
+ * keys and the finish are not drawn.
+ */
+class Raycaster {
+public:
+    /** as the game has them */
+    static constexpr float FOV_Y = 3.14f / 4;
+    static constexpr float FAR = 10.0f;
+
+private:
+    /** pre-lit texels as 0x00BBGGRR, column after column, since a wall samples down one column */
+    struct Texture {
+        size_t width = 0;
+        size_t height = 0;
+        std::vector<uint32_t> texels;
+
+        Texture() = default;
+
+        Texture(const Image &image, float light);
+    };
+
+    /** the camera as every column sees it */
+    struct View {
+        float x, y, z;
+        float forwardX, forwardY;
+        float rightX, rightY;
+        float tanHalfX, tanHalfY;
+        /** the slope of the view direction, which moves the horizon */
+        float pitch;
+        float far;
+    };
+
+    const Map &map;
+    size_t width, height, threads;
+    Texture litWall, shadedWall, floor;
+    // column after column, so each thread fills memory of its own
+    std::vector<uint32_t> columns;
+    Image frame;
+
+    void RenderColumns(const View &view, size_t begin, size_t end);
+
+    void RenderColumn(const View &view, size_t x, uint32_t *column) const;
+
+public:
+    /**
+     * @param wall the texture of wall sides (textures/brick.bmp)
+     * @param floor the texture of the floor (textures/wood.bmp)
+     * @param threads to render columns with, 0 for one per core
+     */
+    Raycaster(const Map &map, const Image &wall, const Image &floor, size_t width, size_t height, size_t threads = 0);
+
+    /**
+     * @param far how far walls and floors are drawn
+     * @return the frame seen from the camera in the state, top row first
+     */
+    const Image &Render(const State &state, float far = FAR);
+
+    /**
+     * @return "AVX", "SSE2" or "scalar", for texture addressing
+     */
+    static const char *InstructionSet();
+};
@@ -0,0 +1,562 @@
+#include "RenderBackend.h"
+
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <boost/format.hpp>
+
+namespace {
+    constexpr const char *CALL_NAMES[RENDER_CALLS] = {
+            "CreateVertexArray", "DeleteVertexArray", "CreateBuffer", "DeleteBuffer",
+            "BindVertexArray", "BindBuffer", "BufferData", "BufferSubData", "BindBufferBase", "BindBufferRange",
+            "VertexAttribPointer", "VertexAttribIPointer", "EnableVertexAttribArray", "VertexAttribDivisor",
+            "UseProgram", "GetUniformLocation", "GetAttribLocation", "GetUniformBlockIndex", "UniformBlockBinding",
+            "UniformInt", "UniformVec3", "UniformMat4",
+            "ActiveTexture", "BindTexture",
+            "ClearColor", "Clear", "DrawArrays", "DrawArraysInstanced",
+    };
+
+    constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+    int hexValue(char digit) {
+        if (digit >= '0' && digit <= '9') return digit - '0';
+        if (digit >= 'a' && digit <= 'f') return digit - 'a' + 10;
+        return -1;
+    }
+
+    /**
+     * The trace's names for what it created mapped to the backend's
+     */
+    template<typename Key, typename Name>
+    class Names {
+    private:
+        std::map<Key, Name> names;
+
+    public:
+        void Add(const Key &recorded, Name name) {
+            names[recorded] = name;
+        }
+
+        /**
+         * @param made the name to use for something made outside the backend, as the recording saw it
+         */
+        Name At(const Key &recorded, Name made) const {
+            const auto found = names.find(recorded);
+            return found == names.end() ? made : found->second;
+        }
+    };
+
+    /**
+     * The arguments of one line of a trace, read in order
+     */
+    class Arguments {
+    private:
+        std::istringstream in;
+        size_t line;
+
+    public:
+        Arguments(const std::string &text, size_t line) : in(text), line(line) {}
+
+        template<typename T>
+        T Next() {
+            T value;
+            if (!(in >> value)) {
+                const auto msg = boost::format{"Line %1% of the trace is missing arguments"} % line;
+                throw std::invalid_argument(msg.str());
+            }
+            return value;
+        }
+
+        /**
+         * @return bytes written by RecordingBackend::WriteBytes; empty for "-"
+         */
+        std::vector<uint8_t> Bytes(size_t count) {
+            const auto text = Next<std::string>();
+            if (text == "-") return {};
+            if (text.size() != 2 * count) {
+                const auto msg = boost::format{"Line %1% of the trace has %2% hex digits for %3% bytes"} % line
+                                 % text.size() % count;
+                throw std::invalid_argument(msg.str());
+            }
+            std::vector<uint8_t> bytes(count);
+            for (size_t i = 0; i < count; ++i) {
+                const int high = hexValue(text[2 * i]), low = hexValue(text[2 * i + 1]);
+                if (high < 0 || low < 0) {
+                    const auto msg = boost::format{"Line %1% of the trace has bytes that are not hex"} % line;
+                    throw std::invalid_argument(msg.str());
+                }
+                bytes[i] = static_cast<uint8_t>(high << 4 | low);
+            }
+            return bytes;
+        }
+    };
+}
+
+GLint NullBackend::LocationOf(const std::string &name) {
+    return locations.try_emplace(name, static_cast<GLint>(locations.size())).first->second;
+}
+
+GLuint NullBackend::CreateVertexArray() {
+    return nextName++;
+}
+
+GLuint NullBackend::CreateBuffer() {
+    return nextName++;
+}
+
+GLint NullBackend::GetUniformLocation(GLuint, const std::string &name) {
+    return LocationOf(name);
+}
+
+GLint NullBackend::GetAttribLocation(GLuint, const std::string &name) {
+    return LocationOf(name);
+}
+
+GLuint NullBackend::GetUniformBlockIndex(GLuint, const std::string &name) {
+    return static_cast<GLuint>(LocationOf(name));
+}
+
+RecordingBackend::RecordingBackend(RenderBackend &inner, std::ostream *trace) : inner(inner), trace(trace) {
+    // enough digits that every float reads back as itself
+    if (trace != nullptr) trace->precision(9);
+}
+
+std::ostream *RecordingBackend::Record(RenderCall call) {
+    counts[static_cast<size_t>(call)] += 1;
+    if (trace != nullptr) *trace << CALL_NAMES[static_cast<size_t>(call)];
+    return trace;
+}
+
+void RecordingBackend::WriteBytes(const void *data, size_t bytes) {
+    if (data == nullptr || bytes == 0) {
+        *trace << " -";
+        return;
+    }
+    std::string text(2 * bytes + 1, ' ');
+    const auto *in = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < bytes; ++i) {
+        text[1 + 2 * i] = HEX_DIGITS[in[i] >> 4];
+        text[2 + 2 * i] = HEX_DIGITS[in[i] & 15];
+    }
+    *trace << text;
+}
+
+GLuint RecordingBackend::CreateVertexArray() {
+    const GLuint name = inner.CreateVertexArray();
+    if (auto *out = Record(RenderCall::CREATE_VERTEX_ARRAY)) *out << ' ' << name << '\n';
+    return name;
+}
+
+void RecordingBackend::DeleteVertexArray(GLuint vertexArray) {
+    if (auto *out = Record(RenderCall::DELETE_VERTEX_ARRAY)) *out << ' ' << vertexArray << '\n';
+    inner.DeleteVertexArray(vertexArray);
+}
+
+GLuint RecordingBackend::CreateBuffer() {
+    const GLuint name = inner.CreateBuffer();
+    if (auto *out = Record(RenderCall::CREATE_BUFFER)) *out << ' ' << name << '\n';
+    return name;
+}
+
+void RecordingBackend::DeleteBuffer(GLuint buffer) {
+    if (auto *out = Record(RenderCall::DELETE_BUFFER)) *out << ' ' << buffer << '\n';
+    inner.DeleteBuffer(buffer);
+}
+
+void RecordingBackend::BindVertexArray(GLuint vertexArray) {
+    if (auto *out = Record(RenderCall::BIND_VERTEX_ARRAY)) *out << ' ' << vertexArray << '\n';
+    inner.BindVertexArray(vertexArray);
+}
+
+void RecordingBackend::BindBuffer(GLenum target, GLuint buffer) {
+    if (auto *out = Record(RenderCall::BIND_BUFFER)) *out << ' ' << target << ' ' << buffer << '\n';
+    inner.BindBuffer(target, buffer);
+}
+
+void RecordingBackend::BufferData(GLenum target, size_t bytes, const void *data, GLenum usage) {
+    if (data != nullptr) {
+        bytesUploaded += bytes;
+        if (target == GL_UNIFORM_BUFFER) blockUploads += 1;
+    }
+    if (auto *out = Record(RenderCall::BUFFER_DATA)) {
+        *out << ' ' << target << ' ' << bytes << ' ' << usage;
+        WriteBytes(data, bytes);
+        *out << '\n';
+    }
+    inner.BufferData(target, bytes, data, usage);
+}
+
+void RecordingBackend::BufferSubData(GLenum target, size_t offset, size_t bytes, const void *data) {
+    bytesUploaded += bytes;
+    if (target == GL_UNIFORM_BUFFER) blockUploads += 1;
+    if (auto *out = Record(RenderCall::BUFFER_SUB_DATA)) {
+        *out << ' ' << target << ' ' << offset << ' ' << bytes;
+        WriteBytes(data, bytes);
+        *out << '\n';
+    }
+    inner.BufferSubData(target, offset, bytes, data);
+}
+
+void RecordingBackend::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    if (auto *out = Record(RenderCall::BIND_BUFFER_BASE)) {
+        *out << ' ' << target << ' ' << index << ' ' << buffer << '\n';
+    }
+    inner.BindBufferBase(target, index, buffer);
+}
+
+void RecordingBackend::BindBufferRange(GLenum target, GLuint index, GLuint buffer, size_t offset, size_t bytes) {
+    if (auto *out = Record(RenderCall::BIND_BUFFER_RANGE)) {
+        *out << ' ' << target << ' ' << index << ' ' << buffer << ' ' << offset << ' ' << bytes << '\n';
+    }
+    inner.BindBufferRange(target, index, buffer, offset, bytes);
+}
+
+void RecordingBackend::VertexAttribPointer(GLuint index, GLint size, GLenum type, bool normalized, GLsizei stride,
+                                           size_t offset) {
+    if (auto *out = Record(RenderCall::VERTEX_ATTRIB_POINTER)) {
+        *out << ' ' << index << ' ' << size << ' ' << type << ' ' << normalized << ' ' << stride << ' ' << offset
+             << '\n';
+    }
+    inner.VertexAttribPointer(index, size, type, normalized, stride, offset);
+}
+
+void RecordingBackend::VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) {
+    if (auto *out = Record(RenderCall::VERTEX_ATTRIB_I_POINTER)) {
+        *out << ' ' << index << ' ' << size << ' ' << type << ' ' << stride << ' ' << offset << '\n';
+    }
+    inner.VertexAttribIPointer(index, size, type, stride, offset);
+}
+
+void RecordingBackend::EnableVertexAttribArray(GLuint index) {
+    if (auto *out = Record(RenderCall::ENABLE_VERTEX_ATTRIB_ARRAY)) *out << ' ' << index << '\n';
+    inner.EnableVertexAttribArray(index);
+}
+
+void RecordingBackend::VertexAttribDivisor(GLuint index, GLuint divisor) {
+    if (auto *out = Record(RenderCall::VERTEX_ATTRIB_DIVISOR)) *out << ' ' << index << ' ' << divisor << '\n';
+    inner.VertexAttribDivisor(index, divisor);
+}
+
+void RecordingBackend::UseProgram(GLuint program) {
+    if (auto *out = Record(RenderCall::USE_PROGRAM)) *out << ' ' << program << '\n';
+    inner.UseProgram(program);
+}
+
+GLint RecordingBackend::GetUniformLocation(GLuint program, const std::string &name) {
+    const GLint location = inner.GetUniformLocation(program, name);
+    if (auto *out = Record(RenderCall::GET_UNIFORM_LOCATION)) {
+        *out << ' ' << program << ' ' << name << ' ' << location << '\n';
+    }
+    return location;
+}
+
+GLint RecordingBackend::GetAttribLocation(GLuint program, const std::string &name) {
+    const GLint location = inner.GetAttribLocation(program, name);
+    if (auto *out = Record(RenderCall::GET_ATTRIB_LOCATION)) {
+        *out << ' ' << program << ' ' << name << ' ' << location << '\n';
+    }
+    return location;
+}
+
+GLuint RecordingBackend::GetUniformBlockIndex(GLuint program, const std::string &name) {
+    const GLuint block = inner.GetUniformBlockIndex(program, name);
+    if (auto *out = Record(RenderCall::GET_UNIFORM_BLOCK_INDEX)) {
+        *out << ' ' << program << ' ' << name << ' ' << block << '\n';
+    }
+    return block;
+}
+
+void RecordingBackend::UniformBlockBinding(GLuint program, GLuint block, GLuint binding) {
+    if (auto *out = Record(RenderCall::UNIFORM_BLOCK_BINDING)) {
+        *out << ' ' << program << ' ' << block << ' ' << binding << '\n';
+    }
+    inner.UniformBlockBinding(program, block, binding);
+}
+
+void RecordingBackend::Uniform(GLint location, int32_t value) {
+    if (auto *out = Record(RenderCall::UNIFORM_INT)) *out << ' ' << location << ' ' << value << '\n';
+    inner.Uniform(location, value);
+}
+
+void RecordingBackend::Uniform(GLint location, const glm::vec3 &value) {
+    if (auto *out = Record(RenderCall::UNIFORM_VEC3)) {
+        *out << ' ' << location << ' ' << value.x << ' ' << value.y << ' ' << value.z << '\n';
+    }
+    inner.Uniform(location, value);
+}
+
+void RecordingBackend::Uniform(GLint location, const glm::mat4 &value) {
+    if (auto *out = Record(RenderCall::UNIFORM_MAT4)) {
+        *out << ' ' << location;
+        for (int column = 0; column < 4; ++column) {
+            for (int row = 0; row < 4; ++row) *out << ' ' << value[column][row];
+        }
+        *out << '\n';
+    }
+    inner.Uniform(location, value);
+}
+
+void RecordingBackend::ActiveTexture(GLenum unit) {
+    if (auto *out = Record(RenderCall::ACTIVE_TEXTURE)) *out << ' ' << unit << '\n';
+    inner.ActiveTexture(unit);
+}
+
+void RecordingBackend::BindTexture(GLenum target, GLuint texture) {
+    if (auto *out = Record(RenderCall::BIND_TEXTURE)) *out << ' ' << target << ' ' << texture << '\n';
+    inner.BindTexture(target, texture);
+}
+
+void RecordingBackend::ClearColor(float r, float g, float b, float a) {
+    if (auto *out = Record(RenderCall::CLEAR_COLOR)) *out << ' ' << r << ' ' << g << ' ' << b << ' ' << a << '\n';
+    inner.ClearColor(r, g, b, a);
+}
+
+void RecordingBackend::Clear(GLbitfield mask) {
+    if (auto *out = Record(RenderCall::CLEAR)) *out << ' ' << mask << '\n';
+    inner.Clear(mask);
+}
+
+void RecordingBackend::DrawArrays(GLenum mode, GLint first, GLsizei count) {
+    if (auto *out = Record(RenderCall::DRAW_ARRAYS)) *out << ' ' << mode << ' ' << first << ' ' << count << '\n';
+    inner.DrawArrays(mode, first, count);
+}
+
+void RecordingBackend::DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+    if (auto *out = Record(RenderCall::DRAW_ARRAYS_INSTANCED)) {
+        *out << ' ' << mode << ' ' << first << ' ' << count << ' ' << instances << '\n';
+    }
+    inner.DrawArraysInstanced(mode, first, count, instances);
+}
+
+size_t RecordingBackend::Draws() const {
+    return Count(RenderCall::DRAW_ARRAYS) + Count(RenderCall::DRAW_ARRAYS_INSTANCED);
+}
+
+size_t RecordingBackend::UniformUploads() const {
+    return Count(RenderCall::UNIFORM_INT) + Count(RenderCall::UNIFORM_VEC3) + Count(RenderCall::UNIFORM_MAT4);
+}
+
+size_t RecordingBackend::BlockBinds() const {
+    return Count(RenderCall::BIND_BUFFER_BASE) + Count(RenderCall::BIND_BUFFER_RANGE);
+}
+
+size_t RecordingBackend::Binds() const {
+    return Count(RenderCall::USE_PROGRAM) + Count(RenderCall::BIND_VERTEX_ARRAY) + Count(RenderCall::BIND_BUFFER)
+           + Count(RenderCall::BIND_TEXTURE) + BlockBinds();
+}
+
+size_t RecordingBackend::Calls() const {
+    return std::accumulate(counts.begin(), counts.end(), size_t{0});
+}
+
+void RecordingBackend::ResetCounts() {
+    counts.fill(0);
+    bytesUploaded = 0;
+    blockUploads = 0;
+}
+
+namespace RenderTrace {
+    const char *name(RenderCall call) {
+        return CALL_NAMES[static_cast<size_t>(call)];
+    }
+
+    size_t replay(std::istream &trace, RenderBackend &backend) {
+        std::unordered_map<std::string, RenderCall> calls;
+        for (size_t call = 0; call < RENDER_CALLS; ++call) calls.emplace(CALL_NAMES[call], static_cast<RenderCall>(call));
+
+        Names<GLuint, GLuint> vertexArrays, buffers;
+        // a location only means something for the program it was looked up in
+        Names<std::pair<GLuint, GLint>, GLint> uniforms;
+        Names<std::pair<GLuint, GLuint>, GLuint> blocks;
+        GLuint program = 0;
+
+        size_t made = 0;
+        size_t number = 0;
+        std::string text;
+        while (std::getline(trace, text)) {
+            number += 1;
+            if (text.empty()) continue;
+
+            Arguments in(text, number);
+            const auto found = calls.find(in.Next<std::string>());
+            if (found == calls.end()) {
+                const auto msg = boost::format{"Line %1% of the trace is not a call: %2%"} % number % text;
+                throw std::invalid_argument(msg.str());
+            }
+            const auto named = [&](const Names<GLuint, GLuint> &names) {
+                const auto recorded = in.Next<GLuint>();
+                return names.At(recorded, recorded);
+            };
+            const auto uniform = [&]() {
+                const auto location = in.Next<GLint>();
+                return uniforms.At({program, location}, location);
+            };
+
+            switch (found->second) {
+                case RenderCall::CREATE_VERTEX_ARRAY: {
+                    const auto recorded = in.Next<GLuint>();
+                    vertexArrays.Add(recorded, backend.CreateVertexArray());
+                    break;
+                }
+                case RenderCall::DELETE_VERTEX_ARRAY:
+                    backend.DeleteVertexArray(named(vertexArrays));
+                    break;
+                case RenderCall::CREATE_BUFFER: {
+                    const auto recorded = in.Next<GLuint>();
+                    buffers.Add(recorded, backend.CreateBuffer());
+                    break;
+                }
+                case RenderCall::DELETE_BUFFER:
+                    backend.DeleteBuffer(named(buffers));
+                    break;
+                case RenderCall::BIND_VERTEX_ARRAY:
+                    backend.BindVertexArray(named(vertexArrays));
+                    break;
+                case RenderCall::BIND_BUFFER: {
+                    const auto target = in.Next<GLenum>();
+                    backend.BindBuffer(target, named(buffers));
+                    break;
+                }
+                case RenderCall::BUFFER_DATA: {
+                    const auto target = in.Next<GLenum>();
+                    const auto bytes = in.Next<size_t>();
+                    const auto usage = in.Next<GLenum>();
+                    const auto data = in.Bytes(bytes);
+                    backend.BufferData(target, bytes, data.empty() ? nullptr : data.data(), usage);
+                    break;
+                }
+                case RenderCall::BUFFER_SUB_DATA: {
+                    const auto target = in.Next<GLenum>();
+                    const auto offset = in.Next<size_t>();
+                    const auto bytes = in.Next<size_t>();
+                    const auto data = in.Bytes(bytes);
+                    backend.BufferSubData(target, offset, bytes, data.data());
+                    break;
+                }
+                case RenderCall::BIND_BUFFER_BASE: {
+                    const auto target = in.Next<GLenum>();
+                    const auto index = in.Next<GLuint>();
+                    backend.BindBufferBase(target, index, named(buffers));
+                    break;
+                }
+                case RenderCall::BIND_BUFFER_RANGE: {
+                    const auto target = in.Next<GLenum>();
+                    const auto index = in.Next<GLuint>();
+                    const auto buffer = named(buffers);
+                    const auto offset = in.Next<size_t>();
+                    backend.BindBufferRange(target, index, buffer, offset, in.Next<size_t>());
+                    break;
+                }
+                case RenderCall::VERTEX_ATTRIB_POINTER: {
+                    const auto index = in.Next<GLuint>();
+                    const auto size = in.Next<GLint>();
+                    const auto type = in.Next<GLenum>();
+                    const auto normalized = in.Next<bool>();
+                    const auto stride = in.Next<GLsizei>();
+                    backend.VertexAttribPointer(index, size, type, normalized, stride, in.Next<size_t>());
+                    break;
+                }
+                case RenderCall::VERTEX_ATTRIB_I_POINTER: {
+                    const auto index = in.Next<GLuint>();
+                    const auto size = in.Next<GLint>();
+                    const auto type = in.Next<GLenum>();
+                    const auto stride = in.Next<GLsizei>();
+                    backend.VertexAttribIPointer(index, size, type, stride, in.Next<size_t>());
+                    break;
+                }
+                case RenderCall::ENABLE_VERTEX_ATTRIB_ARRAY:
+                    backend.EnableVertexAttribArray(in.Next<GLuint>());
+                    break;
+                case RenderCall::VERTEX_ATTRIB_DIVISOR: {
+                    const auto index = in.Next<GLuint>();
+                    backend.VertexAttribDivisor(index, in.Next<GLuint>());
+                    break;
+                }
+                case RenderCall::USE_PROGRAM:
+                    program = in.Next<GLuint>();
+                    backend.UseProgram(program);
+                    break;
+                case RenderCall::GET_UNIFORM_LOCATION: {
+                    const auto of = in.Next<GLuint>();
+                    const auto name = in.Next<std::string>();
+                    uniforms.Add({of, in.Next<GLint>()}, backend.GetUniformLocation(of, name));
+                    break;
+                }
+                case RenderCall::GET_ATTRIB_LOCATION: {
+                    // attribute indices are used as recorded, so a lookup only has to be made
+                    const auto of = in.Next<GLuint>();
+                    backend.GetAttribLocation(of, in.Next<std::string>());
+                    break;
+                }
+                case RenderCall::GET_UNIFORM_BLOCK_INDEX: {
+                    const auto of = in.Next<GLuint>();
+                    const auto name = in.Next<std::string>();
+                    blocks.Add({of, in.Next<GLuint>()}, backend.GetUniformBlockIndex(of, name));
+                    break;
+                }
+                case RenderCall::UNIFORM_BLOCK_BINDING: {
+                    const auto of = in.Next<GLuint>();
+                    const auto recorded = in.Next<GLuint>();
+                    backend.UniformBlockBinding(of, blocks.At({of, recorded}, recorded), in.Next<GLuint>());
+                    break;
+                }
+                case RenderCall::UNIFORM_INT: {
+                    const GLint location = uniform();
+                    backend.Uniform(location, in.Next<int32_t>());
+                    break;
+                }
+                case RenderCall::UNIFORM_VEC3: {
+                    const GLint location = uniform();
+                    glm::vec3 value;
+                    for (int i = 0; i < 3; ++i) value[i] = in.Next<float>();
+                    backend.Uniform(location, value);
+                    break;
+                }
+                case RenderCall::UNIFORM_MAT4: {
+                    const GLint location = uniform();
+                    glm::mat4 value;
+                    for (int column = 0; column < 4; ++column) {
+                        for (int row = 0; row < 4; ++row) value[column][row] = in.Next<float>();
+                    }
+                    backend.Uniform(location, value);
+                    break;
+                }
+                case RenderCall::ACTIVE_TEXTURE:
+                    backend.ActiveTexture(in.Next<GLenum>());
+                    break;
+                case RenderCall::BIND_TEXTURE: {
+                    const auto target = in.Next<GLenum>();
+                    backend.BindTexture(target, in.Next<GLuint>());
+                    break;
+                }
+                case RenderCall::CLEAR_COLOR: {
+                    float rgba[4];
+                    for (float &channel : rgba) channel = in.Next<float>();
+                    backend.ClearColor(rgba[0], rgba[1], rgba[2], rgba[3]);
+                    break;
+                }
+                case RenderCall::CLEAR:
+                    backend.Clear(in.Next<GLbitfield>());
+                    break;
+                case RenderCall::DRAW_ARRAYS: {
+                    const auto mode = in.Next<GLenum>();
+                    const auto first = in.Next<GLint>();
+                    backend.DrawArrays(mode, first, in.Next<GLsizei>());
+                    break;
+                }
+                case RenderCall::DRAW_ARRAYS_INSTANCED: {
+                    const auto mode = in.Next<GLenum>();
+                    const auto first = in.Next<GLint>();
+                    const auto count = in.Next<GLsizei>();
+                    backend.DrawArraysInstanced(mode, first, count, in.Next<GLsizei>());
+                    break;
+                }
+            }
+            made += 1;
+        }
+        return made;
+    }
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <mat4x4.hpp>
+#include <vec3.hpp>
+#include "glad.h"
+
+/**
+ * The GL calls a frame is drawn with, so that it can be drawn by something other than a GL context: GLBackend forwards
+ * to the driver, NullBackend does nothing, and RecordingBackend counts and writes out the calls of another.
+ *
+ * Only what the renderers use every frame goes through here. Shaders and textures are made once at start-up with GL
+ * directly, and their names are passed through as they are.
+ */
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    virtual GLuint CreateVertexArray() = 0;
+    virtual void DeleteVertexArray(GLuint vertexArray) = 0;
+    virtual GLuint CreateBuffer() = 0;
+    virtual void DeleteBuffer(GLuint buffer) = 0;
+
+    virtual void BindVertexArray(GLuint vertexArray) = 0;
+    virtual void BindBuffer(GLenum target, GLuint buffer) = 0;
+    /** data may be null, to allocate (or orphan) a buffer without filling it */
+    virtual void BufferData(GLenum target, size_t bytes, const void *data, GLenum usage) = 0;
+    virtual void BufferSubData(GLenum target, size_t offset, size_t bytes, const void *data) = 0;
+    /** binds the whole buffer to an indexed target, such as a uniform block's binding point */
+    virtual void BindBufferBase(GLenum target, GLuint index, GLuint buffer) = 0;
+    virtual void BindBufferRange(GLenum target, GLuint index, GLuint buffer, size_t offset, size_t bytes) = 0;
+
+    /** offset is into the bound GL_ARRAY_BUFFER */
+    virtual void VertexAttribPointer(GLuint index, GLint size, GLenum type, bool normalized, GLsizei stride,
+                                     size_t offset) = 0;
+    virtual void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) = 0;
+    virtual void EnableVertexAttribArray(GLuint index) = 0;
+    virtual void VertexAttribDivisor(GLuint index, GLuint divisor) = 0;
+
+    virtual void UseProgram(GLuint program) = 0;
+    virtual GLint GetUniformLocation(GLuint program, const std::string &name) = 0;
+    virtual GLint GetAttribLocation(GLuint program, const std::string &name) = 0;
+    /** @return GL_INVALID_INDEX if the program has no such block */
+    virtual GLuint GetUniformBlockIndex(GLuint program, const std::string &name) = 0;
+    virtual void UniformBlockBinding(GLuint program, GLuint block, GLuint binding) = 0;
+    virtual void Uniform(GLint location, int32_t value) = 0;
+    virtual void Uniform(GLint location, const glm::vec3 &value) = 0;
+    virtual void Uniform(GLint location, const glm::mat4 &value) = 0;
+
+    virtual void ActiveTexture(GLenum unit) = 0;
+    virtual void BindTexture(GLenum target, GLuint texture) = 0;
+
+    virtual void ClearColor(float r, float g, float b, float a) = 0;
+    virtual void Clear(GLbitfield mask) = 0;
+    virtual void DrawArrays(GLenum mode, GLint first, GLsizei count) = 0;
+    virtual void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) = 0;
+};
+
+/**
+ * Draws nothing, for timing everything a frame does before the driver. Hands out new names for vertex arrays and
+ * buffers, and the same location (or block index) for the same uniform, attribute or block name.
+ */
+class NullBackend : public RenderBackend {
+private:
+    GLuint nextName = 1;
+    std::unordered_map<std::string, GLint> locations;
+
+    GLint LocationOf(const std::string &name);
+
+public:
+    GLuint CreateVertexArray() override;
+    void DeleteVertexArray(GLuint) override {}
+    GLuint CreateBuffer() override;
+    void DeleteBuffer(GLuint) override {}
+    void BindVertexArray(GLuint) override {}
+    void BindBuffer(GLenum, GLuint) override {}
+    void BufferData(GLenum, size_t, const void *, GLenum) override {}
+    void BufferSubData(GLenum, size_t, size_t, const void *) override {}
+    void BindBufferBase(GLenum, GLuint, GLuint) override {}
+    void BindBufferRange(GLenum, GLuint, GLuint, size_t, size_t) override {}
+    void VertexAttribPointer(GLuint, GLint, GLenum, bool, GLsizei, size_t) override {}
+    void VertexAttribIPointer(GLuint, GLint, GLenum, GLsizei, size_t) override {}
+    void EnableVertexAttribArray(GLuint) override {}
+    void VertexAttribDivisor(GLuint, GLuint) override {}
+    void UseProgram(GLuint) override {}
+    GLint GetUniformLocation(GLuint program, const std::string &name) override;
+    GLint GetAttribLocation(GLuint program, const std::string &name) override;
+    GLuint GetUniformBlockIndex(GLuint program, const std::string &name) override;
+    void UniformBlockBinding(GLuint, GLuint, GLuint) override {}
+    void Uniform(GLint, int32_t) override {}
+    void Uniform(GLint, const glm::vec3 &) override {}
+    void Uniform(GLint, const glm::mat4 &) override {}
+    void ActiveTexture(GLenum) override {}
+    void BindTexture(GLenum, GLuint) override {}
+    void ClearColor(float, float, float, float) override {}
+    void Clear(GLbitfield) override {}
+    void DrawArrays(GLenum, GLint, GLsizei) override {}
+    void DrawArraysInstanced(GLenum, GLint, GLsizei, GLsizei) override {}
+};
+
+/**
+ * Every kind of RenderBackend call, in the order they are declared
+ */
+enum class RenderCall : uint8_t {
+    CREATE_VERTEX_ARRAY, DELETE_VERTEX_ARRAY, CREATE_BUFFER, DELETE_BUFFER,
+    BIND_VERTEX_ARRAY, BIND_BUFFER, BUFFER_DATA, BUFFER_SUB_DATA, BIND_BUFFER_BASE, BIND_BUFFER_RANGE,
+    VERTEX_ATTRIB_POINTER, VERTEX_ATTRIB_I_POINTER, ENABLE_VERTEX_ATTRIB_ARRAY, VERTEX_ATTRIB_DIVISOR,
+    USE_PROGRAM, GET_UNIFORM_LOCATION, GET_ATTRIB_LOCATION, GET_UNIFORM_BLOCK_INDEX, UNIFORM_BLOCK_BINDING,
+    UNIFORM_INT, UNIFORM_VEC3, UNIFORM_MAT4,
+    ACTIVE_TEXTURE, BIND_TEXTURE,
+    CLEAR_COLOR, CLEAR, DRAW_ARRAYS, DRAW_ARRAYS_INSTANCED,
+};
+
+constexpr size_t RENDER_CALLS = static_cast<size_t>(RenderCall::DRAW_ARRAYS_INSTANCED) + 1;
+
+/**
+ * Passes every call on to another backend, counting them and, given a stream, writing them to it as a trace that
+ * RenderTrace::replay can play back: one call a line, its name then its arguments, with buffer contents in hex.
+ */
+class RecordingBackend : public RenderBackend {
+private:
+    RenderBackend &inner;
+    std::ostream *trace;
+    std::array<size_t, RENDER_CALLS> counts = {};
+    size_t bytesUploaded = 0;
+    size_t blockUploads = 0;
+
+    /** counts a call and starts its line of the trace */
+    std::ostream *Record(RenderCall call);
+
+    void WriteBytes(const void *data, size_t bytes);
+
+public:
+    /**
+     * @param trace where to write the trace, or null to only count
+     */
+    explicit RecordingBackend(RenderBackend &inner, std::ostream *trace = nullptr);
+
+    GLuint CreateVertexArray() override;
+    void DeleteVertexArray(GLuint vertexArray) override;
+    GLuint CreateBuffer() override;
+    void DeleteBuffer(GLuint buffer) override;
+    void BindVertexArray(GLuint vertexArray) override;
+    void BindBuffer(GLenum target, GLuint buffer) override;
+    void BufferData(GLenum target, size_t bytes, const void *data, GLenum usage) override;
+    void BufferSubData(GLenum target, size_t offset, size_t bytes, const void *data) override;
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, size_t offset, size_t bytes) override;
+    void VertexAttribPointer(GLuint index, GLint size, GLenum type, bool normalized, GLsizei stride,
+                             size_t offset) override;
+    void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) override;
+    void EnableVertexAttribArray(GLuint index) override;
+    void VertexAttribDivisor(GLuint index, GLuint divisor) override;
+    void UseProgram(GLuint program) override;
+    GLint GetUniformLocation(GLuint program, const std::string &name) override;
+    GLint GetAttribLocation(GLuint program, const std::string &name) override;
+    GLuint GetUniformBlockIndex(GLuint program, const std::string &name) override;
+    void UniformBlockBinding(GLuint program, GLuint block, GLuint binding) override;
+    void Uniform(GLint location, int32_t value) override;
+    void Uniform(GLint location, const glm::vec3 &value) override;
+    void Uniform(GLint location, const glm::mat4 &value) override;
+    void ActiveTexture(GLenum unit) override;
+    void BindTexture(GLenum target, GLuint texture) override;
+    void ClearColor(float r, float g, float b, float a) override;
+    void Clear(GLbitfield mask) override;
+    void DrawArrays(GLenum mode, GLint first, GLsizei count) override;
+    void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) override;
+
+    [[nodiscard]] size_t Count(RenderCall call) const {
+        return counts[static_cast<size_t>(call)];
+    }
+
+    /**
+     * @return glDrawArrays and glDrawArraysInstanced calls
+     */
+    [[nodiscard]] size_t Draws() const;
+
+    /**
+     * @return glUniform* calls
+     */
+    [[nodiscard]] size_t UniformUploads() const;
+
+    /**
+     * @return BufferData and BufferSubData calls that filled a uniform buffer
+     */
+    [[nodiscard]] size_t BlockUploads() const {
+        return blockUploads;
+    }
+
+    /**
+     * @return glBindBufferBase and glBindBufferRange calls, which pick the uniforms a block reads
+     */
+    [[nodiscard]] size_t BlockBinds() const;
+
+    /**
+     * @return programs, vertex arrays, buffers and textures bound, buffer ranges included
+     */
+    [[nodiscard]] size_t Binds() const;
+
+    /**
+     * @return bytes given to BufferData and BufferSubData
+     */
+    [[nodiscard]] size_t BytesUploaded() const {
+        return bytesUploaded;
+    }
+
+    [[nodiscard]] size_t Calls() const;
+
+    /**
+     * Zeroes the counts, say at the start of a frame
+     */
+    void ResetCounts();
+};
+
+/**
+ * Plays back traces written by a RecordingBackend
+ */
+namespace RenderTrace {
+    /**
+     * Makes every call of a trace on a backend. Vertex arrays, buffers, uniform locations and block indices the trace
+     * created get whatever names the backend gives them, and later calls are rewritten to use those. Anything made
+     * outside the backend (programs, textures, the model buffer), attribute indices and binding points are used as
+     * recorded.
+     * @return the number of calls made
+     * @throws std::invalid_argument if a line is not a call, or is missing arguments
+     */
+    size_t replay(std::istream &trace, RenderBackend &backend);
+
+    /**
+     * @return the name calls of this kind have in a trace
+     */
+    const char *name(RenderCall call);
+}
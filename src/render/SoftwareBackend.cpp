@@ -0,0 +1,610 @@
+#include "SoftwareBackend.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <boost/format.hpp>
+#include <mat3x3.hpp>
+#include <geometric.hpp>
+
+#if defined(__AVX__) || defined(__SSE__)
+
+#include <immintrin.h>
+
+#endif
+
+namespace {
+#if defined(__AVX__)
+    using Vector = __m256;
+
+    inline Vector load(const float *p) { return _mm256_loadu_ps(p); }
+
+    inline void store(float *p, Vector v) { _mm256_storeu_ps(p, v); }
+
+    inline Vector splat(float f) { return _mm256_set1_ps(f); }
+
+    inline Vector add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+
+    inline Vector multiplyAdd(Vector a, Vector b, Vector c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+
+    inline Vector greater(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+    inline Vector less(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+
+    inline Vector equal(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+
+    inline Vector both(Vector a, Vector b) { return _mm256_and_ps(a, b); }
+
+    inline Vector either(Vector a, Vector b) { return _mm256_or_ps(a, b); }
+
+    inline uint32_t mask(Vector v) { return static_cast<uint32_t>(_mm256_movemask_ps(v)); }
+
+    inline Vector flag(bool set) { return _mm256_castsi256_ps(_mm256_set1_epi32(set ? -1 : 0)); }
+
+    constexpr size_t LANES = 8;
+    constexpr auto NAME = "AVX";
+#elif defined(__SSE__)
+    using Vector = __m128;
+
+    inline Vector load(const float *p) { return _mm_loadu_ps(p); }
+
+    inline void store(float *p, Vector v) { _mm_storeu_ps(p, v); }
+
+    inline Vector splat(float f) { return _mm_set1_ps(f); }
+
+    inline Vector add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+
+    inline Vector multiplyAdd(Vector a, Vector b, Vector c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+    inline Vector greater(Vector a, Vector b) { return _mm_cmpgt_ps(a, b); }
+
+    inline Vector less(Vector a, Vector b) { return _mm_cmplt_ps(a, b); }
+
+    inline Vector equal(Vector a, Vector b) { return _mm_cmpeq_ps(a, b); }
+
+    inline Vector both(Vector a, Vector b) { return _mm_and_ps(a, b); }
+
+    inline Vector either(Vector a, Vector b) { return _mm_or_ps(a, b); }
+
+    inline uint32_t mask(Vector v) { return static_cast<uint32_t>(_mm_movemask_ps(v)); }
+
+    inline Vector flag(bool set) { return _mm_castsi128_ps(_mm_set1_epi32(set ? -1 : 0)); }
+
+    constexpr size_t LANES = 4;
+    constexpr auto NAME = "SSE";
+#else
+    constexpr size_t LANES = 0;
+    constexpr auto NAME = "scalar";
+#endif
+
+    // from shaders/textured-fragment.glsl
+    constexpr float AMBIENT = .3f;
+    constexpr float SPECULAR = .8f;
+    const glm::vec3 LIGHT_DIRECTION = glm::normalize(glm::vec3(-1, 1, -1));
+
+    uint8_t toByte(float channel) {
+        return static_cast<uint8_t>(std::clamp(channel, 0.0f, 1.0f) * 255 + .5f);
+    }
+
+    /** whether a pixel centre with edge value e is inside, taking pixels on the edge only for top and left edges */
+    bool inside(float e, bool topLeft) {
+        return e > 0 || (e == 0 && topLeft);
+    }
+}
+
+SoftwareBackend::SoftwareBackend(size_t width, size_t height, size_t threads)
+        : width(width), height(height),
+          threads(threads != 0 ? threads : std::max(1U, std::thread::hardware_concurrency())),
+          tilesX((width + TILE_SIZE - 1) / TILE_SIZE), tilesY((height + TILE_SIZE - 1) / TILE_SIZE),
+          frame(width, height), depth(width * height, 1.0f), bins(tilesX * tilesY) {
+    if (width == 0 || height == 0) {
+        const auto msg = boost::format{"Cannot render a %1%x%2% frame"} % width % height;
+        throw std::invalid_argument(msg.str());
+    }
+}
+
+GLuint SoftwareBackend::AddTexture(Image image) {
+    const GLuint name = nextName++;
+    textures[name] = std::move(image);
+    return name;
+}
+
+const Image &SoftwareBackend::Frame() {
+    Rasterize();
+    return frame;
+}
+
+const char *SoftwareBackend::InstructionSet() {
+    return NAME;
+}
+
+GLint SoftwareBackend::LocationOf(const std::string &name) {
+    return locations.try_emplace(name, static_cast<GLint>(locations.size())).first->second;
+}
+
+glm::vec4 SoftwareBackend::Fetch(const Attribute &attribute, size_t vertex, size_t instance) const {
+    glm::vec4 value(0, 0, 0, 1);
+    const auto buffer = buffers.find(attribute.buffer);
+    if (buffer == buffers.end()) return value;
+
+    const size_t index = attribute.divisor != 0 ? instance / attribute.divisor : vertex;
+    const size_t stride = attribute.stride != 0 ? attribute.stride : attribute.size * sizeof(float);
+    const size_t start = attribute.offset + index * stride;
+    if (start + attribute.size * sizeof(float) > buffer->second.size()) return value;
+
+    for (GLint i = 0; i < attribute.size; ++i) {
+        if (attribute.integer) {
+            int32_t component;
+            std::memcpy(&component, &buffer->second[start + i * sizeof(component)], sizeof(component));
+            value[i] = static_cast<float>(component);
+        } else {
+            std::memcpy(&value[i], &buffer->second[start + i * sizeof(float)], sizeof(float));
+        }
+    }
+    return value;
+}
+
+template<typename Block>
+bool SoftwareBackend::ReadBlock(const Uniforms &uniforms, GLuint block, Block &out) const {
+    const auto binding = uniforms.blockBindings.find(block);
+    if (binding == uniforms.blockBindings.end()) return false;
+    const auto range = uniformBindings.find(binding->second);
+    if (range == uniformBindings.end()) return false;
+    const auto buffer = buffers.find(range->second.buffer);
+    if (buffer == buffers.end() || range->second.offset + sizeof(Block) > buffer->second.size()) return false;
+    std::memcpy(&out, &buffer->second[range->second.offset], sizeof(Block));
+    return true;
+}
+
+void SoftwareBackend::Draw(GLint first, GLsizei count, GLsizei instances) {
+    const auto found = vertexArrays.find(vertexArray);
+    if (found == vertexArrays.end() || count < 3) return;
+    const auto &attributes = found->second.attributes;
+    auto &uniforms = programs[program];
+
+    const auto matrix = [&](const std::string &name) {
+        const auto value = uniforms.matrices.find(LocationOf(name));
+        return value != uniforms.matrices.end() ? value->second : glm::mat4(1);
+    };
+    const auto vector = [&](const std::string &name) {
+        const auto value = uniforms.vectors.find(LocationOf(name));
+        return value != uniforms.vectors.end() ? value->second : glm::vec3(0);
+    };
+    const auto integer = [&](const std::string &name) {
+        const auto value = uniforms.ints.find(LocationOf(name));
+        return value != uniforms.ints.end() ? value->second : 0;
+    };
+
+    const bool instanced = attributes[INSTANCE_MVP].enabled;
+    FrameUniforms frameBlock;
+    DrawUniforms drawBlock;
+    const bool framed = ReadBlock(uniforms, FRAME_BLOCK, frameBlock);
+    const bool drawn = !instanced && ReadBlock(uniforms, DRAW_BLOCK, drawBlock);
+
+    const glm::mat4 view = framed ? frameBlock.view : matrix("view");
+    const glm::mat4 proj = framed ? frameBlock.proj : matrix("proj");
+    const glm::vec3 light = framed ? glm::vec3(frameBlock.lightDir) : glm::mat3(view) * LIGHT_DIRECTION;
+
+    std::vector<Vertex> vertices(count);
+    for (size_t instance = 0; instance < static_cast<size_t>(std::max(instances, 1)); ++instance) {
+        Transform transform;
+        glm::vec3 color;
+        int32_t texID;
+        if (instanced) {
+            for (GLuint column = 0; column < 4; ++column) {
+                transform.mvp[column] = Fetch(attributes[INSTANCE_MVP + column], 0, instance);
+                transform.modelView[column] = Fetch(attributes[INSTANCE_MODEL_VIEW + column], 0, instance);
+            }
+            for (GLuint column = 0; column < 3; ++column) {
+                const glm::vec3 normal = Fetch(attributes[INSTANCE_NORMAL + column], 0, instance);
+                transform.normal[column] = glm::vec4(normal, 0);
+            }
+            color = Fetch(attributes[INSTANCE_COLOR], 0, instance);
+            texID = static_cast<int32_t>(Fetch(attributes[INSTANCE_TEX_ID], 0, instance).x);
+        } else if (drawn) {
+            transform = drawBlock.transform;
+            color = drawBlock.color;
+            texID = drawBlock.texID;
+        } else {
+            transform = Transforms::compute(view, proj, matrix("model"));
+            color = vector("inColor");
+            texID = integer("texID");
+        }
+
+        Material material{.texture = nullptr, .color = color, .light = light, .invalid = texID < -1 || texID > 1};
+        if (texID == 0 || texID == 1) {
+            // an unbound sampler reads black, as it does in GL
+            const auto texture = textures.find(units[integer("tex" + std::to_string(texID)) % units.size()]);
+            if (texture != textures.end()) {
+                material.texture = &texture->second;
+            } else {
+                material.color = glm::vec3(0);
+            }
+        }
+        const auto materialIndex = static_cast<uint32_t>(materials.size());
+        materials.push_back(material);
+
+        const glm::mat4 &modelView = transform.modelView;
+        const glm::mat4 &modelViewProj = transform.mvp;
+        const glm::mat3 normalMatrix(transform.normal);
+        for (GLsizei i = 0; i < count; ++i) {
+            const size_t index = first + i;
+            const glm::vec4 position(glm::vec3(Fetch(attributes[POSITION], index, instance)), 1);
+            const glm::vec2 texcoord = Fetch(attributes[TEXCOORD], index, instance);
+            const glm::vec3 normal = glm::normalize(normalMatrix * glm::vec3(Fetch(attributes[NORMAL], index, instance)));
+            const glm::vec3 viewPosition = modelView * position;
+            vertices[i] = {
+                    .clip = modelViewProj * position,
+                    .varyings = {viewPosition.x, viewPosition.y, viewPosition.z, normal.x, normal.y, normal.z,
+                                 texcoord.x, texcoord.y},
+            };
+        }
+
+        for (GLsizei i = 0; i + 2 < count; i += 3) {
+            // clipped against the near plane, z >= -w, a triangle becomes a polygon of up to 4 vertices
+            std::array<Vertex, 4> clipped;
+            size_t corners = 0;
+            for (size_t corner = 0; corner < 3; ++corner) {
+                const Vertex &from = vertices[i + corner];
+                const Vertex &to = vertices[i + (corner + 1) % 3];
+                const float fromDistance = from.clip.z + from.clip.w;
+                const float toDistance = to.clip.z + to.clip.w;
+                if (fromDistance >= 0) clipped[corners++] = from;
+                if ((fromDistance >= 0) != (toDistance >= 0)) {
+                    const float t = fromDistance / (fromDistance - toDistance);
+                    Vertex &between = clipped[corners++];
+                    between.clip = from.clip + (to.clip - from.clip) * t;
+                    for (size_t k = 0; k < between.varyings.size(); ++k) {
+                        between.varyings[k] = from.varyings[k] + (to.varyings[k] - from.varyings[k]) * t;
+                    }
+                }
+            }
+            for (size_t corner = 2; corner < corners; ++corner) {
+                AddTriangle(clipped[0], clipped[corner - 1], clipped[corner], materialIndex);
+            }
+        }
+    }
+}
+
+void SoftwareBackend::AddTriangle(const Vertex &v0, const Vertex &v1, const Vertex &v2, uint32_t material) {
+    const std::array<const Vertex *, 3> vertices = {&v0, &v1, &v2};
+    std::array<float, 3> x, y, z, inverseW;
+    for (size_t i = 0; i < 3; ++i) {
+        const glm::vec4 &clip = vertices[i]->clip;
+        inverseW[i] = 1 / clip.w;
+        // screen space has y down, so row 0 is the top of the frame
+        x[i] = (clip.x * inverseW[i] * .5f + .5f) * static_cast<float>(width);
+        y[i] = (.5f - clip.y * inverseW[i] * .5f) * static_cast<float>(height);
+        z[i] = clip.z * inverseW[i] * .5f + .5f;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0 || !std::isfinite(area)) return;
+
+    const float minX = std::max(std::min({x[0], x[1], x[2]}), 0.0f);
+    const float minY = std::max(std::min({y[0], y[1], y[2]}), 0.0f);
+    const float maxX = std::min(std::max({x[0], x[1], x[2]}), static_cast<float>(width - 1));
+    const float maxY = std::min(std::max({y[0], y[1], y[2]}), static_cast<float>(height - 1));
+    if (minX > maxX || minY > maxY) return;
+
+    Triangle triangle{};
+    // winding is not culled, so both orders are flipped to have positive edge values inside
+    const float sign = area > 0 ? 1.0f : -1.0f;
+    area *= sign;
+    for (size_t i = 0; i < 3; ++i) {
+        const size_t j = (i + 1) % 3, k = (i + 2) % 3;
+        triangle.a[i] = sign * (y[j] - y[k]);
+        triangle.b[i] = sign * (x[k] - x[j]);
+        triangle.c[i] = sign * (x[j] * y[k] - x[k] * y[j]);
+        // with y down, left edges rise to the right and top edges are flat with the triangle below them
+        triangle.topLeft[i] = triangle.a[i] > 0 || (triangle.a[i] == 0 && triangle.b[i] > 0);
+        triangle.inverseW[i] = inverseW[i] / area;
+        for (size_t v = 0; v < triangle.varyings[i].size(); ++v) {
+            triangle.varyings[i][v] = vertices[i]->varyings[v] * inverseW[i] / area;
+        }
+    }
+    for (size_t i = 0; i < 3; ++i) {
+        triangle.depthA += z[i] * triangle.a[i] / area;
+        triangle.depthB += z[i] * triangle.b[i] / area;
+        triangle.depthC += z[i] * triangle.c[i] / area;
+    }
+    triangle.minX = static_cast<size_t>(minX);
+    triangle.minY = static_cast<size_t>(minY);
+    triangle.maxX = static_cast<size_t>(maxX);
+    triangle.maxY = static_cast<size_t>(maxY);
+    triangle.material = material;
+
+    const auto index = static_cast<uint32_t>(triangles.size());
+    triangles.push_back(triangle);
+    ++drawnTriangles;
+    for (size_t tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; ++tileY) {
+        for (size_t tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; ++tileX) {
+            bins[tileY * tilesX + tileX].push_back(index);
+        }
+    }
+}
+
+void SoftwareBackend::Rasterize() {
+    if (triangles.empty()) return;
+
+    std::atomic<size_t> nextTile = 0;
+    const auto work = [&] {
+        for (size_t tile; (tile = nextTile.fetch_add(1, std::memory_order_relaxed)) < bins.size();) RasterizeTile(tile);
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(threads, bins.size()); ++i) workers.emplace_back(work);
+    work();
+    for (auto &worker : workers) worker.join();
+
+    for (auto &bin : bins) bin.clear();
+    triangles.clear();
+    materials.clear();
+}
+
+void SoftwareBackend::RasterizeTile(size_t tile) {
+    const size_t tileX = tile % tilesX * TILE_SIZE;
+    const size_t tileY = tile / tilesX * TILE_SIZE;
+    const size_t tileEndX = std::min(tileX + TILE_SIZE, width) - 1;
+    const size_t tileEndY = std::min(tileY + TILE_SIZE, height) - 1;
+
+    for (const uint32_t index : bins[tile]) {
+        const Triangle &t = triangles[index];
+        const size_t startX = std::max(tileX, t.minX), endX = std::min(tileEndX, t.maxX);
+        const size_t startY = std::max(tileY, t.minY), endY = std::min(tileEndY, t.maxY);
+
+#if defined(__AVX__) || defined(__SSE__)
+        // each edge owns the pixels on it only if it is a top or left edge; the others need e > 0
+        Vector onEdge[3];
+        for (size_t i = 0; i < 3; ++i) onEdge[i] = flag(t.topLeft[i]);
+        alignas(32) float lanes[LANES];
+        for (size_t lane = 0; lane < LANES; ++lane) lanes[lane] = static_cast<float>(lane) + .5f;
+        const Vector offsets = load(lanes);
+        const Vector zero = splat(0);
+#endif
+        const auto cover = [&](size_t x, size_t y, float e0, float e1, float e2, float z) {
+            depth[y * width + x] = z;
+            const glm::vec3 color = Shade(t, e0, e1, e2);
+            uint8_t *pixel = frame.At(x, y);
+            for (int channel = 0; channel < 3; ++channel) pixel[channel] = toByte(color[channel]);
+        };
+
+        for (size_t y = startY; y <= endY; ++y) {
+            const float centreY = static_cast<float>(y) + .5f;
+            std::array<float, 3> row;
+            for (size_t i = 0; i < 3; ++i) row[i] = t.b[i] * centreY + t.c[i];
+            const float depthRow = t.depthB * centreY + t.depthC;
+            float *depthLine = &depth[y * width];
+
+            size_t x = startX;
+#if defined(__AVX__) || defined(__SSE__)
+            for (; x + LANES <= endX + 1; x += LANES) {
+                const Vector centreX = add(offsets, splat(static_cast<float>(x)));
+                const Vector z = multiplyAdd(splat(t.depthA), centreX, splat(depthRow));
+                Vector covered = less(z, load(depthLine + x));
+                Vector edges[3];
+                for (size_t i = 0; i < 3; ++i) {
+                    edges[i] = multiplyAdd(splat(t.a[i]), centreX, splat(row[i]));
+                    covered = both(covered, either(greater(edges[i], zero), both(equal(edges[i], zero), onEdge[i])));
+                }
+                uint32_t bits = mask(covered);
+                if (bits == 0) continue;
+
+                alignas(32) float values[3][LANES];
+                for (size_t i = 0; i < 3; ++i) store(values[i], edges[i]);
+                alignas(32) float depths[LANES];
+                store(depths, z);
+                for (; bits != 0; bits &= bits - 1) {
+                    const size_t lane = std::countr_zero(bits);
+                    cover(x + lane, y, values[0][lane], values[1][lane], values[2][lane], depths[lane]);
+                }
+            }
+#endif
+            for (; x <= endX; ++x) {
+                const float centreX = static_cast<float>(x) + .5f;
+                const float e0 = t.a[0] * centreX + row[0];
+                const float e1 = t.a[1] * centreX + row[1];
+                const float e2 = t.a[2] * centreX + row[2];
+                const float z = t.depthA * centreX + depthRow;
+                if (inside(e0, t.topLeft[0]) && inside(e1, t.topLeft[1]) && inside(e2, t.topLeft[2]) &&
+                    z < depthLine[x]) {
+                    cover(x, y, e0, e1, e2, z);
+                }
+            }
+        }
+    }
+}
+
+glm::vec3 SoftwareBackend::Sample(const Image &texture, glm::vec2 texcoord) {
+    // bilinear between the four nearest texels, repeating past the edges
+    const float u = texcoord.x * static_cast<float>(texture.width) - .5f;
+    const float v = texcoord.y * static_cast<float>(texture.height) - .5f;
+    const float floorU = std::floor(u), floorV = std::floor(v);
+    const float fractionU = u - floorU, fractionV = v - floorV;
+    const auto wrap = [](float coordinate, size_t size) {
+        const auto wrapped = static_cast<int64_t>(coordinate) % static_cast<int64_t>(size);
+        return static_cast<size_t>(wrapped < 0 ? wrapped + static_cast<int64_t>(size) : wrapped);
+    };
+    const size_t x0 = wrap(floorU, texture.width), x1 = (x0 + 1) % texture.width;
+    const size_t y0 = wrap(floorV, texture.height), y1 = (y0 + 1) % texture.height;
+    const auto texel = [&](size_t x, size_t y) {
+        const uint8_t *pixel = texture.At(x, y);
+        return glm::vec3(pixel[0], pixel[1], pixel[2]) / 255.0f;
+    };
+    const glm::vec3 top = texel(x0, y0) * (1 - fractionU) + texel(x1, y0) * fractionU;
+    const glm::vec3 bottom = texel(x0, y1) * (1 - fractionU) + texel(x1, y1) * fractionU;
+    return top * (1 - fractionV) + bottom * fractionV;
+}
+
+glm::vec3 SoftwareBackend::Shade(const Triangle &triangle, float e0, float e1, float e2) const {
+    const Material &material = materials[triangle.material];
+    if (material.invalid) return {1, 0, 0};
+
+    const float w = 1 / (e0 * triangle.inverseW[0] + e1 * triangle.inverseW[1] + e2 * triangle.inverseW[2]);
+    std::array<float, 8> varyings;
+    for (size_t v = 0; v < varyings.size(); ++v) {
+        varyings[v] = (e0 * triangle.varyings[0][v] + e1 * triangle.varyings[1][v] + e2 * triangle.varyings[2][v]) * w;
+    }
+    const glm::vec3 position(varyings[0], varyings[1], varyings[2]);
+    const glm::vec3 normal = glm::normalize(glm::vec3(varyings[3], varyings[4], varyings[5]));
+    const glm::vec2 texcoord(varyings[6], varyings[7]);
+
+    // as shaders/textured-fragment.glsl lights it
+    const glm::vec3 color = material.texture != nullptr ? Sample(*material.texture, texcoord) : material.color;
+    const float facing = glm::dot(-material.light, normal);
+    const glm::vec3 reflected = glm::reflect(glm::normalize(-position), normal);
+    const float spec = facing <= 0 ? 0 : std::max(glm::dot(reflected, material.light), 0.0f);
+    return color * AMBIENT + color * std::max(facing, 0.0f) + glm::vec3(SPECULAR * (spec * spec) * (spec * spec));
+}
+
+GLuint SoftwareBackend::CreateVertexArray() {
+    const GLuint name = nextName++;
+    vertexArrays[name] = {};
+    return name;
+}
+
+void SoftwareBackend::DeleteVertexArray(GLuint deleted) {
+    vertexArrays.erase(deleted);
+}
+
+GLuint SoftwareBackend::CreateBuffer() {
+    const GLuint name = nextName++;
+    buffers[name] = {};
+    return name;
+}
+
+void SoftwareBackend::DeleteBuffer(GLuint buffer) {
+    buffers.erase(buffer);
+}
+
+void SoftwareBackend::BindVertexArray(GLuint bound) {
+    vertexArray = bound;
+}
+
+void SoftwareBackend::BindBuffer(GLenum target, GLuint buffer) {
+    boundBuffers[target] = buffer;
+}
+
+void SoftwareBackend::BufferData(GLenum target, size_t bytes, const void *data, GLenum) {
+    auto &buffer = buffers[boundBuffers[target]];
+    buffer.assign(bytes, 0);
+    if (data != nullptr && bytes != 0) std::memcpy(buffer.data(), data, bytes);
+}
+
+void SoftwareBackend::BufferSubData(GLenum target, size_t offset, size_t bytes, const void *data) {
+    auto &buffer = buffers[boundBuffers[target]];
+    if (buffer.size() < offset + bytes) buffer.resize(offset + bytes);
+    if (bytes != 0) std::memcpy(buffer.data() + offset, data, bytes);
+}
+
+void SoftwareBackend::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    BindBufferRange(target, index, buffer, 0, 0);
+}
+
+void SoftwareBackend::BindBufferRange(GLenum target, GLuint index, GLuint buffer, size_t offset, size_t) {
+    // as in GL, binding a range binds the buffer to the target too
+    boundBuffers[target] = buffer;
+    if (target == GL_UNIFORM_BUFFER) uniformBindings[index] = {.buffer = buffer, .offset = offset};
+}
+
+void SoftwareBackend::VertexAttribPointer(GLuint index, GLint size, GLenum, bool, GLsizei stride, size_t offset) {
+    if (index >= MAX_ATTRIBUTES) return;
+    auto &attribute = vertexArrays[vertexArray].attributes[index];
+    attribute.integer = false;
+    attribute.buffer = boundBuffers[GL_ARRAY_BUFFER];
+    attribute.size = size;
+    attribute.stride = stride;
+    attribute.offset = offset;
+}
+
+void SoftwareBackend::VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) {
+    VertexAttribPointer(index, size, type, false, stride, offset);
+    if (index < MAX_ATTRIBUTES) vertexArrays[vertexArray].attributes[index].integer = true;
+}
+
+void SoftwareBackend::EnableVertexAttribArray(GLuint index) {
+    if (index < MAX_ATTRIBUTES) vertexArrays[vertexArray].attributes[index].enabled = true;
+}
+
+void SoftwareBackend::VertexAttribDivisor(GLuint index, GLuint divisor) {
+    if (index < MAX_ATTRIBUTES) vertexArrays[vertexArray].attributes[index].divisor = divisor;
+}
+
+void SoftwareBackend::UseProgram(GLuint used) {
+    program = used;
+}
+
+GLint SoftwareBackend::GetUniformLocation(GLuint, const std::string &name) {
+    return LocationOf(name);
+}
+
+GLint SoftwareBackend::GetAttribLocation(GLuint, const std::string &name) {
+    if (name == "position") return POSITION;
+    if (name == "inTexcoord") return TEXCOORD;
+    if (name == "inNormal") return NORMAL;
+    return -1;
+}
+
+GLuint SoftwareBackend::GetUniformBlockIndex(GLuint, const std::string &name) {
+    if (name == "Frame") return FRAME_BLOCK;
+    if (name == "Draw") return DRAW_BLOCK;
+    return GL_INVALID_INDEX;
+}
+
+void SoftwareBackend::UniformBlockBinding(GLuint of, GLuint block, GLuint binding) {
+    programs[of].blockBindings[block] = binding;
+}
+
+void SoftwareBackend::Uniform(GLint location, int32_t value) {
+    if (location >= 0) programs[program].ints[location] = value;
+}
+
+void SoftwareBackend::Uniform(GLint location, const glm::vec3 &value) {
+    if (location >= 0) programs[program].vectors[location] = value;
+}
+
+void SoftwareBackend::Uniform(GLint location, const glm::mat4 &value) {
+    if (location >= 0) programs[program].matrices[location] = value;
+}
+
+void SoftwareBackend::ActiveTexture(GLenum unit) {
+    activeUnit = (unit - GL_TEXTURE0) % units.size();
+}
+
+void SoftwareBackend::BindTexture(GLenum, GLuint texture) {
+    units[activeUnit] = texture;
+}
+
+void SoftwareBackend::ClearColor(float r, float g, float b, float a) {
+    clearColor = glm::vec4(r, g, b, a);
+}
+
+void SoftwareBackend::Clear(GLbitfield clearMask) {
+    const GLbitfield everything = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT;
+    if ((clearMask & everything) == everything) {
+        // nothing pending could show through
+        for (auto &bin : bins) bin.clear();
+        triangles.clear();
+        materials.clear();
+    } else {
+        Rasterize();
+    }
+
+    if (clearMask & GL_COLOR_BUFFER_BIT) {
+        const uint8_t color[3] = {toByte(clearColor.r), toByte(clearColor.g), toByte(clearColor.b)};
+        for (size_t i = 0; i < frame.pixels.size(); i += 3) std::memcpy(&frame.pixels[i], color, sizeof(color));
+    }
+    if (clearMask & GL_DEPTH_BUFFER_BIT) std::fill(depth.begin(), depth.end(), 1.0f);
+    drawnTriangles = 0;
+}
+
+void SoftwareBackend::DrawArrays(GLenum mode, GLint first, GLsizei count) {
+    if (mode == GL_TRIANGLES) Draw(first, count, 0);
+}
+
+void SoftwareBackend::DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+    if (mode == GL_TRIANGLES && instances > 0) Draw(first, count, instances);
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <render/Image.h>
+#include <render/RenderBackend.h>
+#include <render/UniformBlocks.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <mat4x4.hpp>
+#include <vec2.hpp>
+#include <vec3.hpp>
+#include <vec4.hpp>
+
+/**
+ * A RenderBackend that rasterizes on the CPU into an Image, for pixels on machines without a GPU.
+ *
+ * Instead of running GLSL it has the lighting of shaders/textured-*.glsl built in: ambient, diffuse and a specular
+ * highlight from the fixed light, over a flat colour (texID -1) or a texture (texID 0 or 1, through samplers tex0 and
+ * tex1), sampled bilinearly and repeated. The camera and light come from the program's Frame block when a buffer is
+ * bound to it, as UniformBlocks lays it out, and otherwise the view and proj uniforms are used with the fixed light. A
+ * draw's Transform, colour and texID come from attributes 3-15 when the bound vertex array enables them, as
+ * shaders/instanced-vertex.glsl has them, then from the Draw block, and otherwise the Transform is computed from the
+ * model uniform and the colour and texID are the inColor and texID uniforms.
+ * Vertices are the 8 floats of a Model, at attributes 0-2 (which GetAttribLocation hands out for position, inTexcoord
+ * and inNormal). Only GL_TRIANGLES are drawn, clipped against the near plane.
+ *
+ * Draws only transform their vertices and keep the triangles; Frame rasterizes them. The screen is split into
+ * TILE_SIZE tiles, each given the triangles that overlap it in the order they were drawn, and the tiles are rasterized
+ * on every core at once. Edge functions and the depth test are evaluated for 8 pixels at a time with AVX, or 4 with
+ * SSE. Pixel centres are at half-integers and edges follow the top-left rule.
+ */
+class SoftwareBackend : public RenderBackend {
+public:
+    static constexpr size_t TILE_SIZE = 64;
+    static constexpr GLuint POSITION = 0;
+    static constexpr GLuint TEXCOORD = 1;
+    static constexpr GLuint NORMAL = 2;
+    static constexpr GLuint INSTANCE_MVP = 3;
+    static constexpr GLuint INSTANCE_MODEL_VIEW = 7;
+    static constexpr GLuint INSTANCE_NORMAL = 11;
+    static constexpr GLuint INSTANCE_COLOR = 14;
+    static constexpr GLuint INSTANCE_TEX_ID = 15;
+    static constexpr size_t MAX_ATTRIBUTES = 16;
+    /** the indices GetUniformBlockIndex hands out for the Frame and Draw blocks */
+    static constexpr GLuint FRAME_BLOCK = 0;
+    static constexpr GLuint DRAW_BLOCK = 1;
+
+private:
+    struct Attribute {
+        bool enabled = false;
+        bool integer = false;
+        GLuint buffer = 0;
+        GLint size = 4;
+        GLsizei stride = 0;
+        size_t offset = 0;
+        GLuint divisor = 0;
+    };
+
+    struct VertexArray {
+        std::array<Attribute, MAX_ATTRIBUTES> attributes;
+    };
+
+    struct Uniforms {
+        std::unordered_map<GLint, int32_t> ints;
+        std::unordered_map<GLint, glm::vec3> vectors;
+        std::unordered_map<GLint, glm::mat4> matrices;
+        /** block index -> binding point */
+        std::unordered_map<GLuint, GLuint> blockBindings;
+    };
+
+    /** what is bound to a binding point of GL_UNIFORM_BUFFER */
+    struct BufferRange {
+        GLuint buffer = 0;
+        size_t offset = 0;
+    };
+
+    /** what a triangle is shaded with, shared by the triangles of one draw (or instance) */
+    struct Material {
+        /** null for a flat colour */
+        const Image *texture;
+        glm::vec3 color;
+        /** the light's direction in view space */
+        glm::vec3 light;
+        /** a texID the shader has no sampler for, which it draws in plain red */
+        bool invalid;
+    };
+
+    /** the outputs of the vertex shader, in clip space */
+    struct Vertex {
+        glm::vec4 clip;
+        /** view-space position, normal and texture coordinate */
+        std::array<float, 8> varyings;
+    };
+
+    struct Triangle {
+        /** edge i is E(x, y) = a[i] x + b[i] y + c[i], positive inside, and 0 on the edge opposite vertex i */
+        std::array<float, 3> a, b, c;
+        /** edges that cover pixels exactly on them */
+        std::array<bool, 3> topLeft;
+        /** depth as a plane over the screen: depthA x + depthB y + depthC */
+        float depthA, depthB, depthC;
+        /** per vertex, 1 / w and the varyings divided by w, over twice the area so that edge values weight them */
+        std::array<float, 3> inverseW;
+        std::array<std::array<float, 8>, 3> varyings;
+        size_t minX, minY, maxX, maxY;
+        uint32_t material;
+    };
+
+    size_t width, height, threads;
+    size_t tilesX, tilesY;
+    Image frame;
+    std::vector<float> depth;
+
+    GLuint nextName = 1;
+    std::unordered_map<GLuint, std::vector<uint8_t>> buffers;
+    std::unordered_map<GLuint, VertexArray> vertexArrays;
+    std::unordered_map<GLuint, Image> textures;
+    std::unordered_map<GLuint, Uniforms> programs;
+    std::unordered_map<std::string, GLint> locations;
+    // by target
+    std::unordered_map<GLenum, GLuint> boundBuffers;
+    // by binding point
+    std::unordered_map<GLuint, BufferRange> uniformBindings;
+    GLuint vertexArray = 0;
+    GLuint program = 0;
+    size_t activeUnit = 0;
+    std::array<GLuint, 16> units = {};
+    glm::vec4 clearColor = glm::vec4(0, 0, 0, 0);
+
+    std::vector<Material> materials;
+    std::vector<Triangle> triangles;
+    // per tile, the triangles overlapping it in draw order; kept between frames so they are not reallocated
+    std::vector<std::vector<uint32_t>> bins;
+    size_t drawnTriangles = 0;
+
+    GLint LocationOf(const std::string &name);
+
+    [[nodiscard]] static glm::vec3 Sample(const Image &texture, glm::vec2 texcoord);
+
+    [[nodiscard]] glm::vec4 Fetch(const Attribute &attribute, size_t vertex, size_t instance) const;
+
+    /**
+     * Reads a block of the program from the buffer bound to its binding point
+     * @return whether the program has the block bound to a buffer big enough for it
+     */
+    template<typename Block>
+    bool ReadBlock(const Uniforms &uniforms, GLuint block, Block &out) const;
+
+    void Draw(GLint first, GLsizei count, GLsizei instances);
+
+    void AddTriangle(const Vertex &v0, const Vertex &v1, const Vertex &v2, uint32_t material);
+
+    void Rasterize();
+
+    void RasterizeTile(size_t tile);
+
+    [[nodiscard]] glm::vec3 Shade(const Triangle &triangle, float e0, float e1, float e2) const;
+
+public:
+    /**
+     * @param threads to rasterize tiles with, 0 for one per core
+     */
+    SoftwareBackend(size_t width, size_t height, size_t threads = 0);
+
+    /**
+     * @return a name for the texture, to bind like one made by GL
+     */
+    GLuint AddTexture(Image image);
+
+    /**
+     * Rasterizes whatever was drawn since the last call
+     * @return the colour buffer, top row first
+     */
+    const Image &Frame();
+
+    /**
+     * @return triangles drawn since the last Clear, after clipping
+     */
+    [[nodiscard]] size_t Triangles() const {
+        return drawnTriangles;
+    }
+
+    /**
+     * @return "AVX", "SSE" or "scalar", for the edge functions and depth test
+     */
+    static const char *InstructionSet();
+
+    GLuint CreateVertexArray() override;
+    void DeleteVertexArray(GLuint vertexArray) override;
+    GLuint CreateBuffer() override;
+    void DeleteBuffer(GLuint buffer) override;
+    void BindVertexArray(GLuint vertexArray) override;
+    void BindBuffer(GLenum target, GLuint buffer) override;
+    void BufferData(GLenum target, size_t bytes, const void *data, GLenum usage) override;
+    void BufferSubData(GLenum target, size_t offset, size_t bytes, const void *data) override;
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, size_t offset, size_t bytes) override;
+    void VertexAttribPointer(GLuint index, GLint size, GLenum type, bool normalized, GLsizei stride,
+                             size_t offset) override;
+    void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) override;
+    void EnableVertexAttribArray(GLuint index) override;
+    void VertexAttribDivisor(GLuint index, GLuint divisor) override;
+    void UseProgram(GLuint program) override;
+    GLint GetUniformLocation(GLuint program, const std::string &name) override;
+    GLint GetAttribLocation(GLuint program, const std::string &name) override;
+    GLuint GetUniformBlockIndex(GLuint program, const std::string &name) override;
+    void UniformBlockBinding(GLuint program, GLuint block, GLuint binding) override;
+    void Uniform(GLint location, int32_t value) override;
+    void Uniform(GLint location, const glm::vec3 &value) override;
+    void Uniform(GLint location, const glm::mat4 &value) override;
+    void ActiveTexture(GLenum unit) override;
+    void BindTexture(GLenum target, GLuint texture) override;
+    void ClearColor(float r, float g, float b, float a) override;
+    void Clear(GLbitfield mask) override;
+    void DrawArrays(GLenum mode, GLint first, GLsizei count) override;
+    void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) override;
+};
@@ -0,0 +1,162 @@
+#include "Transforms.h"
+
+#include <geometric.hpp>
+#include <type_ptr.hpp>
+
+#if defined(__AVX__) || defined(__SSE__)
+
+#include <immintrin.h>
+
+#endif
+
+namespace {
+#if defined(__AVX__)
+    using Vector = __m256;
+
+    inline Vector splat(float f) { return _mm256_set1_ps(f); }
+
+    inline Vector add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+
+    inline Vector subtract(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+
+    inline Vector multiply(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+
+    inline Vector divide(Vector a, Vector b) { return _mm256_div_ps(a, b); }
+
+    /** out[row] holds element row of each of the 8 vec4s at in, in lanes 0 to 7 */
+    inline void gather(const float *const in[8], Vector out[4]) {
+        __m128 low[4], high[4];
+        for (int i = 0; i < 4; ++i) {
+            low[i] = _mm_loadu_ps(in[i]);
+            high[i] = _mm_loadu_ps(in[4 + i]);
+        }
+        _MM_TRANSPOSE4_PS(low[0], low[1], low[2], low[3]);
+        _MM_TRANSPOSE4_PS(high[0], high[1], high[2], high[3]);
+        for (int row = 0; row < 4; ++row) {
+            out[row] = _mm256_insertf128_ps(_mm256_castps128_ps256(low[row]), high[row], 1);
+        }
+    }
+
+    /** gather backwards */
+    inline void scatter(const Vector in[4], float *const out[8]) {
+        __m128 low[4], high[4];
+        for (int row = 0; row < 4; ++row) {
+            low[row] = _mm256_castps256_ps128(in[row]);
+            high[row] = _mm256_extractf128_ps(in[row], 1);
+        }
+        _MM_TRANSPOSE4_PS(low[0], low[1], low[2], low[3]);
+        _MM_TRANSPOSE4_PS(high[0], high[1], high[2], high[3]);
+        for (int i = 0; i < 4; ++i) {
+            _mm_storeu_ps(out[i], low[i]);
+            _mm_storeu_ps(out[4 + i], high[i]);
+        }
+    }
+
+    constexpr size_t LANES = 8;
+    constexpr auto NAME = "AVX";
+#elif defined(__SSE__)
+    using Vector = __m128;
+
+    inline Vector splat(float f) { return _mm_set1_ps(f); }
+
+    inline Vector add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+
+    inline Vector subtract(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+
+    inline Vector multiply(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+
+    inline Vector divide(Vector a, Vector b) { return _mm_div_ps(a, b); }
+
+    /** out[row] holds element row of each of the 4 vec4s at in, in lanes 0 to 3 */
+    inline void gather(const float *const in[4], Vector out[4]) {
+        for (int i = 0; i < 4; ++i) out[i] = _mm_loadu_ps(in[i]);
+        _MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+    }
+
+    /** gather backwards */
+    inline void scatter(const Vector in[4], float *const out[4]) {
+        Vector rows[4] = {in[0], in[1], in[2], in[3]};
+        _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+        for (int i = 0; i < 4; ++i) _mm_storeu_ps(out[i], rows[i]);
+    }
+
+    constexpr size_t LANES = 4;
+    constexpr auto NAME = "SSE";
+#else
+    constexpr size_t LANES = 0;
+    constexpr auto NAME = "scalar";
+#endif
+
+#if defined(__AVX__) || defined(__SSE__)
+    /** glm::cross of the top three rows of two columns */
+    void cross(const Vector *a, const Vector *b, Vector *out) {
+        out[0] = subtract(multiply(a[1], b[2]), multiply(b[1], a[2]));
+        out[1] = subtract(multiply(a[2], b[0]), multiply(b[2], a[0]));
+        out[2] = subtract(multiply(a[0], b[1]), multiply(b[0], a[1]));
+    }
+#endif
+}
+
+namespace Transforms {
+    Transform compute(const glm::mat4 &view, const glm::mat4 &proj, const glm::mat4 &model) {
+        Transform transform;
+        transform.modelView = view * model;
+        transform.mvp = proj * transform.modelView;
+        // each column of the inverse transpose is the cross product of the other two, over the determinant
+        const glm::vec3 a0(transform.modelView[0]), a1(transform.modelView[1]), a2(transform.modelView[2]);
+        const glm::vec3 c0 = glm::cross(a1, a2), c1 = glm::cross(a2, a0), c2 = glm::cross(a0, a1);
+        const float inverse = 1 / glm::dot(a0, c0);
+        transform.normal = glm::mat3x4(glm::vec4(c0 * inverse, 0), glm::vec4(c1 * inverse, 0),
+                                       glm::vec4(c2 * inverse, 0));
+        return transform;
+    }
+
+    void computeAll(const glm::mat4 &view, const glm::mat4 &proj, std::span<const glm::mat4> models,
+                    std::span<Transform> out) {
+        size_t i = 0;
+#if defined(__AVX__) || defined(__SSE__)
+        // glm already multiplies a column at a time; the normal matrices, all cross products, go a lane per model
+        const float *in[LANES];
+        float *results[LANES];
+        for (; i + LANES <= models.size(); i += LANES) {
+            Vector modelView[3][4];
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                Transform &transform = out[i + lane];
+                transform.modelView = view * models[i + lane];
+                transform.mvp = proj * transform.modelView;
+            }
+            for (int column = 0; column < 3; ++column) {
+                for (size_t lane = 0; lane < LANES; ++lane) in[lane] = glm::value_ptr(out[i + lane].modelView[column]);
+                gather(in, modelView[column]);
+            }
+
+            Vector normal[3][4];
+            cross(modelView[1], modelView[2], normal[0]);
+            cross(modelView[2], modelView[0], normal[1]);
+            cross(modelView[0], modelView[1], normal[2]);
+            const Vector determinant = add(add(multiply(modelView[0][0], normal[0][0]),
+                                               multiply(modelView[0][1], normal[0][1])),
+                                           multiply(modelView[0][2], normal[0][2]));
+            const Vector inverse = divide(splat(1), determinant);
+            for (int column = 0; column < 3; ++column) {
+                for (int row = 0; row < 3; ++row) normal[column][row] = multiply(normal[column][row], inverse);
+                normal[column][3] = splat(0);
+                for (size_t lane = 0; lane < LANES; ++lane) {
+                    results[lane] = glm::value_ptr(out[i + lane].normal[column]);
+                }
+                scatter(normal[column], results);
+            }
+        }
+#endif
+        for (; i < models.size(); ++i) out[i] = compute(view, proj, models[i]);
+    }
+
+    void computeAllScalar(const glm::mat4 &view, const glm::mat4 &proj, std::span<const glm::mat4> models,
+                          std::span<Transform> out) {
+        for (size_t i = 0; i < models.size(); ++i) out[i] = compute(view, proj, models[i]);
+    }
+
+    const char *instructionSet() {
+        return NAME;
+    }
+}
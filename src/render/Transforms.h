@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <mat3x4.hpp>
+#include <mat4x4.hpp>
+
+/**
+ * Where a draw's or instance's vertices and normals go, worked out once on the CPU so that the shaders only multiply.
+ * Laid out as std140 lays out a mat4, a mat4 and a mat3, so that it goes into a uniform block as it is.
+ */
+struct Transform {
+    /** proj * view * model, to clip space */
+    glm::mat4 mvp;
+    /** view * model, to view space, where the shaders light */
+    glm::mat4 modelView;
+    /** transpose(inverse(mat3(modelView))), for normals; each column is padded to a vec4, with w 0 */
+    glm::mat3x4 normal;
+
+    bool operator==(const Transform &) const = default;
+};
+
+static_assert(sizeof(Transform) == 176);
+
+/**
+ * Transforms from model matrices, for a camera
+ */
+namespace Transforms {
+    Transform compute(const glm::mat4 &view, const glm::mat4 &proj, const glm::mat4 &model);
+
+    /**
+     * compute for every model, with the normal matrices worked out for 8 (AVX) or 4 (SSE) models at a time when built
+     * for them
+     * @param out as many as there are models
+     */
+    void computeAll(const glm::mat4 &view, const glm::mat4 &proj, std::span<const glm::mat4> models,
+                    std::span<Transform> out);
+
+    /**
+     * computeAll, one model at a time
+     */
+    void computeAllScalar(const glm::mat4 &view, const glm::mat4 &proj, std::span<const glm::mat4> models,
+                          std::span<Transform> out);
+
+    /**
+     * @return the instruction set computeAll was built with
+     */
+    const char *instructionSet();
+}
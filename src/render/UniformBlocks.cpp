@@ -0,0 +1,64 @@
+#include "UniformBlocks.h"
+
+#include <cstring>
+#include <geometric.hpp>
+#include <mat3x3.hpp>
+
+namespace {
+    // what the shaders used to have as a constant, in world space
+    const glm::vec3 LIGHT_DIRECTION = glm::normalize(glm::vec3(-1, 1, -1));
+}
+
+UniformBlocks::UniformBlocks(RenderBackend &backend) : backend(backend) {
+    frameBuffer = backend.CreateBuffer();
+    backend.BindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    backend.BufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+    backend.BindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, frameBuffer);
+    drawBuffer = backend.CreateBuffer();
+}
+
+void UniformBlocks::Attach(GLuint program) {
+    const GLuint frameBlock = backend.GetUniformBlockIndex(program, "Frame");
+    if (frameBlock != GL_INVALID_INDEX) backend.UniformBlockBinding(program, frameBlock, FRAME_BINDING);
+    const GLuint drawBlock = backend.GetUniformBlockIndex(program, "Draw");
+    if (drawBlock != GL_INVALID_INDEX) backend.UniformBlockBinding(program, drawBlock, DRAW_BINDING);
+}
+
+void UniformBlocks::SetFrame(const glm::mat4 &view, const glm::mat4 &proj) {
+    // turned into view space here rather than for every vertex
+    const glm::vec4 light(glm::mat3(view) * LIGHT_DIRECTION, 0);
+    const FrameUniforms next = {.view = view, .proj = proj, .lightDir = light};
+    if (frameSet && next == frame) return;
+    frame = next;
+    frameSet = true;
+    backend.BindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    backend.BufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+}
+
+size_t UniformBlocks::AddDraw(const DrawUniforms &uniforms) {
+    if (staged > 0) {
+        const size_t last = (staged - 1) * DRAW_STRIDE;
+        if (std::memcmp(&draws[last], &uniforms, sizeof(DrawUniforms)) == 0) return last;
+    }
+    const size_t offset = staged * DRAW_STRIDE;
+    staged += 1;
+    if (draws.size() < staged * DRAW_STRIDE) draws.resize(staged * DRAW_STRIDE);
+    std::memcpy(&draws[offset], &uniforms, sizeof(DrawUniforms));
+    return offset;
+}
+
+void UniformBlocks::UploadDraws() {
+    if (staged == 0) return;
+    backend.BindBuffer(GL_UNIFORM_BUFFER, drawBuffer);
+    backend.BufferData(GL_UNIFORM_BUFFER, staged * DRAW_STRIDE, draws.data(), GL_STREAM_DRAW);
+    staged = 0;
+}
+
+void UniformBlocks::BindDraw(size_t offset) {
+    backend.BindBufferRange(GL_UNIFORM_BUFFER, DRAW_BINDING, drawBuffer, offset, sizeof(DrawUniforms));
+}
+
+void UniformBlocks::Release() {
+    backend.DeleteBuffer(frameBuffer);
+    backend.DeleteBuffer(drawBuffer);
+}
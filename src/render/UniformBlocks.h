@@ -0,0 +1,104 @@
+#pragma once
+
+#include <render/RenderBackend.h>
+#include <render/Transforms.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <mat4x4.hpp>
+#include <vec4.hpp>
+
+/**
+ * The Frame uniform block of every shader, laid out std140: what stays the same for all draws of a frame
+ */
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 proj;
+    /** the direction light travels in, in view space, with w 0 */
+    glm::vec4 lightDir;
+
+    bool operator==(const FrameUniforms &) const = default;
+};
+
+static_assert(sizeof(FrameUniforms) == 144);
+
+/**
+ * The Draw uniform block of shaders/textured-*.glsl, laid out std140: what one glDrawArrays of that program draws with
+ */
+struct DrawUniforms {
+    Transform transform;
+    /** rgb; only used when texID is -1 */
+    glm::vec4 color;
+    /** the texture unit to sample, or -1 for color */
+    int32_t texID;
+    // std140 rounds the block up to a whole vec4
+    int32_t padding[3] = {};
+
+    bool operator==(const DrawUniforms &) const = default;
+};
+
+static_assert(sizeof(DrawUniforms) == 208);
+
+/**
+ * Feeds the shaders' uniform blocks from two uniform buffers, so that a frame makes a couple of uploads instead of a
+ * glUniform per value per draw.
+ *
+ * The Frame block is one buffer, bound once to FRAME_BINDING and refilled by SetFrame. The Draw blocks of a frame are
+ * staged by AddDraw, DRAW_STRIDE apart, and go up together in UploadDraws; each draw then picks its own with BindDraw,
+ * a glBindBufferRange at its offset. Like the instance buffer, the draw buffer is orphaned on every upload rather than
+ * waited on. Programs have their blocks pointed at the binding points once, by Attach, after they are linked.
+ */
+class UniformBlocks {
+public:
+    static constexpr GLuint FRAME_BINDING = 0;
+    static constexpr GLuint DRAW_BINDING = 1;
+    /** GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT may be as large as 256, and no larger, so offsets of 256 suit any driver */
+    static constexpr size_t DRAW_STRIDE = 256;
+    static_assert(sizeof(DrawUniforms) <= DRAW_STRIDE);
+
+private:
+    RenderBackend &backend;
+    GLuint frameBuffer = 0;
+    GLuint drawBuffer = 0;
+    FrameUniforms frame = {};
+    bool frameSet = false;
+    // the staged Draw blocks, DRAW_STRIDE apart; kept between frames so it is not reallocated
+    std::vector<uint8_t> draws;
+    size_t staged = 0;
+
+public:
+    /**
+     * Binds the Frame buffer to FRAME_BINDING
+     */
+    explicit UniformBlocks(RenderBackend &backend);
+
+    /**
+     * Points the program's Frame and Draw blocks, those it has, at FRAME_BINDING and DRAW_BINDING
+     */
+    void Attach(GLuint program);
+
+    /**
+     * Uploads the camera for the frame, with the light, unless it is what was uploaded last
+     */
+    void SetFrame(const glm::mat4 &view, const glm::mat4 &proj);
+
+    /**
+     * Stages a draw's uniforms for the next UploadDraws. A draw with the same uniforms as the one staged before it
+     * shares its block.
+     * @return the offset to give BindDraw
+     */
+    size_t AddDraw(const DrawUniforms &uniforms);
+
+    /**
+     * Uploads everything staged since the last call, in one go. Leaves the draw buffer bound to GL_UNIFORM_BUFFER.
+     */
+    void UploadDraws();
+
+    void BindDraw(size_t offset);
+
+    /**
+     * Call while the GL context is still current
+     */
+    void Release();
+};
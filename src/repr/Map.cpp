@@ -4,6 +4,12 @@
 
 
 #include "Map.h"
+#include "SparseChunks.h"
+#include "PagedChunks.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
 
 Element Element::Door(size_t id) {
 
@@ -84,3 +90,269 @@ bool Key::operator==(const Key &rhs) const {
 bool Key::operator!=(const Key &rhs) const {
     return !(rhs == *this);
 }
+
+Cell Cell::Pack(const Element &element) {
+    switch (element.tag) {
+        case Tag::DOOR:
+            return Door(element.value.door.id);
+        case Tag::KEY:
+            return Key(element.value.key.id);
+        default:
+            return Of(element.tag);
+    }
+}
+
+Element Cell::Unpack() const {
+    switch (GetTag()) {
+        case Tag::START:
+            return Element::Start();
+        case Tag::FINISH:
+            return Element::Finish();
+        case Tag::DOOR:
+            return Element::Door(GetId());
+        case Tag::KEY:
+            return Element::Key(GetId());
+        case Tag::WALL:
+            return Element::Wall();
+        case Tag::EMPTY:
+            break;
+    }
+    return Element::Empty();
+}
+
+namespace {
+    /**
+     * @return v with a zero bit inserted above each of its bits
+     */
+    uint64_t spreadBits(uint32_t v) {
+        uint64_t x = v;
+        x = (x | x << 16) & 0x0000FFFF0000FFFF;
+        x = (x | x << 8) & 0x00FF00FF00FF00FF;
+        x = (x | x << 4) & 0x0F0F0F0F0F0F0F0F;
+        x = (x | x << 2) & 0x3333333333333333;
+        x = (x | x << 1) & 0x5555555555555555;
+        return x;
+    }
+}
+
+Tiling Tiling::ZOrder(size_t width, size_t height) {
+    Tiling tiling = {
+            .chunksX = (width + CHUNK_MASK) >> CHUNK_BITS,
+            .chunksY = (height + CHUNK_MASK) >> CHUNK_BITS,
+    };
+    const size_t count = tiling.chunksX * tiling.chunksY;
+
+    // the grid of chunks is rarely a square power of two, so rank the Morton codes instead of using them as offsets
+    tiling.order.resize(count);
+    for (size_t i = 0; i < count; ++i) tiling.order[i] = i;
+
+    const auto morton = [&](uint32_t chunk) {
+        return spreadBits(chunk % tiling.chunksX) | spreadBits(chunk / tiling.chunksX) << 1;
+    };
+    std::sort(tiling.order.begin(), tiling.order.end(), [&](uint32_t a, uint32_t b) {
+        return morton(a) < morton(b);
+    });
+
+    tiling.slots.resize(count);
+    for (size_t slot = 0; slot < count; ++slot) tiling.slots[tiling.order[slot]] = slot;
+    return tiling;
+}
+
+Map Map::Allocate(size_t width, size_t height, Layout layout) {
+    if (layout == Layout::PAGED) {
+        throw std::invalid_argument("PAGED maps are opened from a binary map with MapBinary::pageMap");
+    }
+    if (layout == Layout::SPARSE) {
+        auto chunks = std::make_shared<SparseChunks>();
+        return {
+                .width = width,
+                .height = height,
+                .storage = chunks,
+                .sparse = chunks,
+                .layout = layout,
+        };
+    }
+
+    Tiling tiling = layout == Layout::TILED ? Tiling::ZOrder(width, height) : Tiling{};
+    const size_t count = layout == Layout::TILED ? tiling.order.size() * CHUNK_CELLS : width * height;
+
+    auto cells = std::make_shared<std::vector<Cell>>(count, Cell::Empty());
+    return {
+            .width = width,
+            .height = height,
+            .elements = *cells,
+            .storage = cells,
+            .layout = layout,
+            .tiling = std::move(tiling),
+    };
+}
+
+Map Map::WithLayout(Layout newLayout) const {
+    Map map = Allocate(width, height, newLayout);
+    std::vector<Cell> row(width);
+    for (size_t y = 0; y < height; ++y) {
+        ReadRow(y, row);
+        map.WriteRow(y, row);
+    }
+    map.index = index;
+    map.extendedIds = extendedIds;
+    return map;
+}
+
+void Map::SetElement(size_t x, size_t y, Tag tag, size_t id) {
+    assert(id <= MAX_KEY_ID);
+    *GetElementRef(x, y) = Cell::Of(tag, std::min(id, Cell::EXTENDED_ID));
+    if (id >= Cell::EXTENDED_ID) {
+        extendedIds[y * width + x] = static_cast<uint32_t>(id);
+    } else if (!extendedIds.empty()) {
+        extendedIds.erase(y * width + x);
+    }
+}
+
+void Map::ReadRow(size_t y, std::span<Cell> out) const {
+    assert(y < height && out.size() >= width);
+    if (layout == Layout::ROW_MAJOR) {
+        std::copy_n(&elements[y * width], width, out.begin());
+        return;
+    }
+    const size_t first = (y >> CHUNK_BITS) * ChunksX();
+    for (size_t x = 0; x < width; x += CHUNK_SIZE) {
+        const ChunkView chunk = ViewChunk(first + (x >> CHUNK_BITS));
+        const auto cells = chunk.Row(y & CHUNK_MASK);
+        std::copy(cells.begin(), cells.end(), out.begin() + x);
+    }
+}
+
+void Map::WriteRow(size_t y, std::span<const Cell> cells) {
+    assert(y < height && cells.size() >= width);
+    for (size_t x = 0; x < width;) {
+        const size_t run = ContiguousRun(x);
+        const auto from = cells.subspan(x, run);
+        x += run;
+
+        if (layout == Layout::SPARSE && sparse->Find((y >> CHUNK_BITS) * ChunksX() + ((x - 1) >> CHUNK_BITS)) == nullptr
+            && std::all_of(from.begin(), from.end(), [](Cell cell) { return cell == Cell::Empty(); })) {
+            continue;
+        }
+        std::copy(from.begin(), from.end(), GetElementRef(x - run, y));
+    }
+}
+
+std::vector<ExtendedId> Map::ExtendedIds() const {
+    std::vector<ExtendedId> ids;
+    ids.reserve(extendedIds.size());
+    for (const auto &[cell, id] : extendedIds) {
+        const Position position = {.x = static_cast<uint32_t>(cell % width), .y = static_cast<uint32_t>(cell / width)};
+        ids.push_back({.position = position, .id = id});
+    }
+    std::sort(ids.begin(), ids.end(), [](const ExtendedId &a, const ExtendedId &b) {
+        return std::tie(a.position.y, a.position.x) < std::tie(b.position.y, b.position.x);
+    });
+    return ids;
+}
+
+namespace {
+    bool rowMajor(const Position &a, const Position &b) {
+        return std::tie(a.y, a.x) < std::tie(b.y, b.x);
+    }
+
+    uint64_t lookupKey(Position position) {
+        return uint64_t{position.y} << 32 | position.x;
+    }
+}
+
+std::vector<Position> *MapIndex::List(Tag tag) {
+    switch (tag) {
+        case Tag::START:
+            return &starts;
+        case Tag::FINISH:
+            return &finishes;
+        case Tag::KEY:
+            return &keys;
+        case Tag::DOOR:
+            return &doors;
+        case Tag::WALL:
+        case Tag::EMPTY:
+            break;
+    }
+    return nullptr;
+}
+
+void MapIndex::BuildLookup() {
+    lookup.clear();
+    lookup.reserve(starts.size() + finishes.size() + keys.size() + doors.size());
+    for (const auto *positions : {&starts, &finishes, &keys, &doors}) {
+        for (uint32_t i = 0; i < positions->size(); ++i) lookup[lookupKey((*positions)[i])] = i;
+    }
+}
+
+void MapIndex::Update(Position position, Cell before, Cell after) {
+    // later entries of a list shift, so their lookups are renumbered from the change on
+    const auto renumber = [this](const std::vector<Position> &positions, size_t from) {
+        for (size_t i = from; i < positions.size(); ++i) lookup[lookupKey(positions[i])] = i;
+    };
+    if (auto *positions = List(before.GetTag())) {
+        const auto it = std::lower_bound(positions->begin(), positions->end(), position, rowMajor);
+        if (it != positions->end() && *it == position) {
+            renumber(*positions, positions->erase(it) - positions->begin());
+            lookup.erase(lookupKey(position));
+        }
+    }
+    if (auto *positions = List(after.GetTag())) {
+        const auto it = std::lower_bound(positions->begin(), positions->end(), position, rowMajor);
+        if (it == positions->end() || *it != position) {
+            renumber(*positions, positions->insert(it, position) - positions->begin());
+        }
+    }
+}
+
+void Map::BuildIndex() {
+    index = {};
+    ForEachSpan([this](size_t x, size_t y, std::span<const Cell> cells) {
+        for (size_t i = 0; i < cells.size(); ++i) {
+            // special tags sort before walls, so most spans are skipped a compare at a time
+            if (cells[i].GetTag() >= Tag::WALL) continue;
+            index.List(cells[i].GetTag())->push_back({.x = static_cast<uint32_t>(x + i), .y = static_cast<uint32_t>(y)});
+        }
+    });
+
+    // chunks are visited in memory order, but the index is documented as row-major
+    for (auto *positions : {&index.starts, &index.finishes, &index.keys, &index.doors}) {
+        std::sort(positions->begin(), positions->end(), rowMajor);
+    }
+    index.BuildLookup();
+}
+
+void Map::Fill(Cell cell) {
+    // every cell is overwritten, so none keeps a larger id
+    extendedIds.clear();
+    if (layout == Layout::PAGED) {
+        paged->Fill(cell);
+        return;
+    }
+    if (layout != Layout::SPARSE) {
+        std::fill(elements.begin(), elements.end(), cell);
+        return;
+    }
+
+    sparse->Clear();
+    if (cell == Cell::Empty()) return;
+    for (size_t chunk = 0; chunk < ChunksX() * ChunksY(); ++chunk) {
+        std::fill_n(sparse->Acquire(chunk), CHUNK_CELLS, cell);
+    }
+}
+
+Cell *Map::IndirectChunk(size_t chunk, bool write) const {
+    if (layout == Layout::PAGED) return paged->Acquire(chunk, write);
+
+    if (write) return sparse->Acquire(chunk);
+    Cell *cells = sparse->Find(chunk);
+    return cells != nullptr ? cells : SparseChunks::EmptyChunk();
+}
+
+Cell *Map::GetIndirectElement(size_t x, size_t y, bool write) const {
+    assert(x < width);
+    assert(y < height);
+    Cell *cells = IndirectChunk((y >> CHUNK_BITS) * ChunksX() + (x >> CHUNK_BITS), write);
+    return &cells[(y & CHUNK_MASK) << CHUNK_BITS | (x & CHUNK_MASK)];
+}
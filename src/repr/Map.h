@@ -1,6 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <cstdlib>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
 #include <vector>
 
 enum class Tag  {
@@ -56,20 +63,462 @@ struct Element {
     bool operator!=(const Element &rhs) const;
 };
 
+/**
+ * The largest key/door id a map may use, so a set of held keys fits a small bitset
+ */
+constexpr size_t MAX_KEY_ID = 0xFFFF;
+
+/**
+ * A map cell packed into one byte: the tag in the low 3 bits and the key/door id in the upper 5.
+ * This is what Map stores; Element is the unpacked form.
+ */
+struct Cell {
+    static constexpr uint8_t TAG_BITS = 3;
+    static constexpr uint8_t TAG_MASK = (1 << TAG_BITS) - 1;
+    static constexpr size_t MAX_ID = (1 << (8 - TAG_BITS)) - 1;
+    /** a key or door with this id may have a larger one, kept in Map::extendedIds (see Map::GetId) */
+    static constexpr size_t EXTENDED_ID = MAX_ID;
+
+    uint8_t bits;
+
+    static constexpr Cell Of(Tag tag, size_t id = 0) {
+        return {.bits = static_cast<uint8_t>(static_cast<uint8_t>(tag) | id << TAG_BITS)};
+    }
+
+    static constexpr Cell Start() { return Of(Tag::START); }
+    static constexpr Cell Finish() { return Of(Tag::FINISH); }
+    static constexpr Cell Empty() { return Of(Tag::EMPTY); }
+    static constexpr Cell Wall() { return Of(Tag::WALL); }
+
+    static Cell Door(size_t id) {
+        assert(id <= MAX_ID);
+        return Of(Tag::DOOR, id);
+    }
+
+    static Cell Key(size_t id) {
+        assert(id <= MAX_ID);
+        return Of(Tag::KEY, id);
+    }
+
+    static Cell Pack(const Element &element);
+
+    /**
+     * @return whether every cell has one of the tags, as those read from a file may not
+     */
+    static bool AllTagged(std::span<const Cell> cells) {
+        // without an early exit, so that it vectorizes
+        bool bad = false;
+        for (const Cell cell : cells) bad |= (cell.bits & TAG_MASK) > static_cast<uint8_t>(Tag::EMPTY);
+        return !bad;
+    }
+
+    [[nodiscard]] Element Unpack() const;
+
+    [[nodiscard]] Tag GetTag() const {
+        return static_cast<Tag>(bits & TAG_MASK);
+    }
+
+    /**
+     * @return the key or door id (0 for other tags)
+     */
+    [[nodiscard]] size_t GetId() const {
+        return bits >> TAG_BITS;
+    }
+
+    Cell &operator=(const Element &element) {
+        return *this = Pack(element);
+    }
+
+    bool operator==(const Cell &rhs) const = default;
+
+    bool operator==(const Element &rhs) const {
+        return Unpack() == rhs;
+    }
+};
+
+static_assert(sizeof(Cell) == 1);
+
+struct Position {
+    uint32_t x, y;
+
+    bool operator==(const Position &rhs) const = default;
+};
+
+/**
+ * A key or door id too large for its Cell
+ */
+struct ExtendedId {
+    Position position;
+    uint32_t id;
+
+    bool operator==(const ExtendedId &rhs) const = default;
+};
+
+/**
+ * Where the special cells were when the map was loaded, each list in row-major order.
+ * MapParser fills it while it parses, so nothing needs to scan the grid for them.
+ */
+struct MapIndex {
+    std::vector<Position> starts;
+    std::vector<Position> finishes;
+    std::vector<Position> keys;
+    std::vector<Position> doors;
+
+    /**
+     * (y << 32 | x) -> where that cell is in the list for its tag
+     */
+    std::unordered_map<uint64_t, uint32_t> lookup;
+
+    /**
+     * @return the list for a tag, nullptr for walls and empty cells
+     */
+    std::vector<Position> *List(Tag tag);
+
+    [[nodiscard]] const std::vector<Position> *List(Tag tag) const {
+        return const_cast<MapIndex *>(this)->List(tag);
+    }
+
+    /**
+     * @return where the cell is in the list for its tag, if it is in one
+     */
+    [[nodiscard]] std::optional<size_t> IndexOf(Position position) const {
+        const auto found = lookup.find(uint64_t{position.y} << 32 | position.x);
+        if (found == lookup.end()) return {};
+        return found->second;
+    }
+
+    /**
+     * Fills lookup from the lists
+     */
+    void BuildLookup();
+
+    /**
+     * Moves a position between lists after its cell changed from `before` to `after`, keeping them row-major
+     */
+    void Update(Position position, Cell before, Cell after);
+};
+
+/**
+ * How a Map arranges its cells in memory
+ */
+enum class Layout {
+    /** one row after another, the order of the text format */
+    ROW_MAJOR = 0,
+    /** CHUNK_SIZE x CHUNK_SIZE chunks, each row-major, with the chunks themselves in Z-order */
+    TILED,
+    /** chunks like TILED, but only the non-empty ones are stored, in a hash table (see SparseChunks) */
+    SPARSE,
+    /** chunks read from a TILED binary map on demand into a bounded cache (see PagedChunks) */
+    PAGED
+};
+
+constexpr size_t CHUNK_BITS = 5;
+constexpr size_t CHUNK_SIZE = 1 << CHUNK_BITS;
+constexpr size_t CHUNK_MASK = CHUNK_SIZE - 1;
+constexpr size_t CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+
+/**
+ * The chunk order of a TILED map
+ */
+struct Tiling {
+    size_t chunksX = 0, chunksY = 0;
+    /** chunk (cy * chunksX + cx) -> its slot in memory */
+    std::vector<uint32_t> slots;
+    /** slot -> chunk, i.e. the chunks in Z-order */
+    std::vector<uint32_t> order;
+
+    static Tiling ZOrder(size_t width, size_t height);
+};
+
+/**
+ * The part of one chunk that lies inside the map. Cells of a row are contiguous; rows are `stride` apart.
+ */
+struct ChunkView {
+    size_t x, y;
+    size_t width, height;
+    size_t stride;
+    Cell *cells;
+
+    [[nodiscard]] Cell &At(size_t localX, size_t localY) const {
+        return cells[localY * stride + localX];
+    }
+
+    [[nodiscard]] std::span<Cell> Row(size_t localY) const {
+        return {cells + localY * stride, width};
+    }
+};
+
+class SparseChunks;
+
+class PagedChunks;
+
 struct Map {
     size_t width, height;
-    std::vector<Element> elements;
 
-    [[nodiscard]] Element GetElement(size_t x, size_t y) const {
-        assert(x < width);
-        assert(y < height);
-        return elements[y * width + x];
+    /**
+     * The cells, arranged according to `layout`. These point into `storage`, so copies of a Map share their cells.
+     * A TILED map pads its edge chunks, so this can hold more than width * height cells. Empty for SPARSE and PAGED
+     * maps.
+     */
+    std::span<Cell> elements;
+
+    /**
+     * Owns the memory behind `elements`: a vector for parsed maps or the file mapping of a binary map
+     */
+    std::shared_ptr<void> storage;
+
+    /**
+     * The chunks of a SPARSE map
+     */
+    std::shared_ptr<SparseChunks> sparse;
+
+    /**
+     * The chunk cache of a PAGED map
+     */
+    std::shared_ptr<PagedChunks> paged;
+
+    MapIndex index;
+
+    /**
+     * (y * width + x) -> id, for keys and doors whose Cell holds Cell::EXTENDED_ID
+     */
+    std::unordered_map<uint64_t, uint32_t> extendedIds;
+
+    Layout layout = Layout::ROW_MAJOR;
+
+    Tiling tiling;
+
+    /**
+     * @return a map of empty cells. PAGED maps come from MapBinary::pageMap instead.
+     */
+    static Map Allocate(size_t width, size_t height, Layout layout = Layout::ROW_MAJOR);
+
+    /**
+     * @return a copy of this map with its cells rearranged (into memory, so not PAGED)
+     */
+    [[nodiscard]] Map WithLayout(Layout newLayout) const;
+
+    /**
+     * Recomputes `index` by scanning every cell
+     */
+    void BuildIndex();
+
+    /**
+     * Sets every cell, dropping any extendedIds. Filling a SPARSE or PAGED map with empty cells frees its chunks.
+     */
+    void Fill(Cell cell);
+
+    [[nodiscard]] size_t ChunksX() const {
+        return (width + CHUNK_MASK) >> CHUNK_BITS;
+    }
+
+    [[nodiscard]] size_t ChunksY() const {
+        return (height + CHUNK_MASK) >> CHUNK_BITS;
     }
 
-    [[nodiscard]] Element* GetElementRef(size_t x, size_t y) {
+    /**
+     * @param chunk chunk number (cy * ChunksX() + cx)
+     * @param write whether the cells will be written
+     * @return the cells of a SPARSE or PAGED map's chunk. An absent SPARSE chunk being read is a shared empty chunk.
+     */
+    [[nodiscard]] Cell *IndirectChunk(size_t chunk, bool write) const;
+
+    /**
+     * @return the part of chunk (cy * ChunksX() + cx) inside the map
+     */
+    [[nodiscard]] ChunkView ViewChunk(size_t chunk) const {
+        const size_t chunksX = ChunksX();
+        const size_t x = chunk % chunksX << CHUNK_BITS;
+        const size_t y = chunk / chunksX << CHUNK_BITS;
+
+        Cell *cells = nullptr;
+        switch (layout) {
+            case Layout::ROW_MAJOR:
+                cells = elements.data() + y * width + x;
+                break;
+            case Layout::TILED:
+                cells = elements.data() + tiling.slots[chunk] * CHUNK_CELLS;
+                break;
+            case Layout::SPARSE:
+            case Layout::PAGED:
+                cells = IndirectChunk(chunk, false);
+                break;
+        }
+
+        return {
+                .x = x,
+                .y = y,
+                .width = std::min(CHUNK_SIZE, width - x),
+                .height = std::min(CHUNK_SIZE, height - y),
+                .stride = layout == Layout::ROW_MAJOR ? width : CHUNK_SIZE,
+                .cells = cells,
+        };
+    }
+
+    [[nodiscard]] size_t CellIndex(size_t x, size_t y) const {
         assert(x < width);
         assert(y < height);
-        return &elements[y*width + x];
+        if (layout == Layout::ROW_MAJOR) return y * width + x;
+
+        const size_t slot = tiling.slots[(y >> CHUNK_BITS) * tiling.chunksX + (x >> CHUNK_BITS)];
+        return slot << (2 * CHUNK_BITS) | (y & CHUNK_MASK) << CHUNK_BITS | (x & CHUNK_MASK);
+    }
+
+    /**
+     * @return how many cells from column x rightwards are adjacent in memory, which is the same on every row
+     */
+    [[nodiscard]] size_t ContiguousRun(size_t x) const {
+        if (layout == Layout::ROW_MAJOR) return width - x;
+        return std::min(CHUNK_SIZE - (x & CHUNK_MASK), width - x);
+    }
+
+    [[nodiscard]] Cell GetElement(size_t x, size_t y) const {
+        if (layout == Layout::SPARSE || layout == Layout::PAGED) return *GetIndirectElement(x, y, false);
+        return elements[CellIndex(x, y)];
+    }
+
+    /**
+     * @param cell the cell at (x, y)
+     * @return its key or door id, which may be larger than a Cell can hold
+     */
+    [[nodiscard]] size_t GetId(size_t x, size_t y, Cell cell) const {
+        if (cell.GetId() != Cell::EXTENDED_ID || extendedIds.empty()) return cell.GetId();
+        const auto found = extendedIds.find(y * width + x);
+        return found != extendedIds.end() ? found->second : Cell::EXTENDED_ID;
+    }
+
+    [[nodiscard]] size_t GetId(size_t x, size_t y) const {
+        return GetId(x, y, GetElement(x, y));
+    }
+
+    /**
+     * Writes a cell with any key/door id up to MAX_KEY_ID
+     */
+    void SetElement(size_t x, size_t y, Tag tag, size_t id = 0);
+
+    /**
+     * @return the ids of extendedIds with their positions, in row-major order
+     */
+    [[nodiscard]] std::vector<ExtendedId> ExtendedIds() const;
+
+    /**
+     * For a SPARSE map this allocates the cell's chunk if it was implicitly empty; a PAGED map keeps the chunk resident.
+     */
+    [[nodiscard]] Cell* GetElementRef(size_t x, size_t y) {
+        if (layout == Layout::SPARSE || layout == Layout::PAGED) return GetIndirectElement(x, y, true);
+        return &elements[CellIndex(x, y)];
+    }
+
+    /**
+     * Visits every chunk in memory order, so a scan touches each cache line and page once.
+     * Views are for reading: absent chunks of a SPARSE map are visited as a shared empty chunk, and a PAGED chunk may
+     * be evicted once the visit returns. Write through GetElementRef.
+     * @param visit called with a ChunkView
+     */
+    template<typename F>
+    void ForEachChunk(F &&visit) const {
+        const size_t count = ChunksX() * ChunksY();
+        for (size_t i = 0; i < count; ++i) {
+            visit(ViewChunk(layout == Layout::TILED ? tiling.order[i] : i));
+        }
+    }
+
+    /**
+     * Visits the chunks overlapping cells [x0, x1) x [y0, y1), clamped to the map. Views are not clipped to the region.
+     */
+    template<typename F>
+    void ForEachChunkIn(size_t x0, size_t y0, size_t x1, size_t y1, F &&visit) const {
+        x1 = std::min(x1, width);
+        y1 = std::min(y1, height);
+        if (x0 >= x1 || y0 >= y1) return;
+
+        const size_t chunksX = ChunksX();
+        for (size_t cy = y0 >> CHUNK_BITS; cy <= (y1 - 1) >> CHUNK_BITS; ++cy) {
+            for (size_t cx = x0 >> CHUNK_BITS; cx <= (x1 - 1) >> CHUNK_BITS; ++cx) {
+                visit(ViewChunk(cy * chunksX + cx));
+            }
+        }
     }
-};
 
+    /**
+     * Visits every cell as spans that are contiguous in memory, in memory order: whole rows of a ROW_MAJOR map, rows
+     * of each chunk otherwise. A loop over a span has unit stride and no calls in it, so simple bodies vectorize.
+     * Spans are for reading, like chunk views.
+     * @param visit called with (x, y, std::span<const Cell>) holding cells x, x + 1, ... of row y
+     */
+    template<typename F>
+    void ForEachSpan(F &&visit) const {
+        if (layout == Layout::ROW_MAJOR) {
+            for (size_t y = 0; y < height; ++y) visit(size_t{0}, y, std::span<const Cell>(&elements[y * width], width));
+            return;
+        }
+        ForEachChunk([&](const ChunkView &chunk) {
+            for (size_t localY = 0; localY < chunk.height; ++localY) {
+                visit(chunk.x, chunk.y + localY, std::span<const Cell>(chunk.Row(localY)));
+            }
+        });
+    }
+
+    /**
+     * ForEachSpan for the cells in [x0, x1) x [y0, y1), clamped to the map. Rows of a ROW_MAJOR map are visited top to
+     * bottom, other layouts a chunk at a time.
+     */
+    template<typename F>
+    void ForEachSpanIn(size_t x0, size_t y0, size_t x1, size_t y1, F &&visit) const {
+        x1 = std::min(x1, width);
+        y1 = std::min(y1, height);
+        if (x0 >= x1 || y0 >= y1) return;
+
+        if (layout == Layout::ROW_MAJOR) {
+            for (size_t y = y0; y < y1; ++y) visit(x0, y, std::span<const Cell>(&elements[y * width + x0], x1 - x0));
+            return;
+        }
+        ForEachChunkIn(x0, y0, x1, y1, [&](const ChunkView &chunk) {
+            const size_t fromX = std::max(x0, chunk.x) - chunk.x;
+            const size_t toX = std::min(x1, chunk.x + chunk.width) - chunk.x;
+            const size_t fromY = std::max(y0, chunk.y) - chunk.y;
+            const size_t toY = std::min(y1, chunk.y + chunk.height) - chunk.y;
+
+            for (size_t localY = fromY; localY < toY; ++localY) {
+                visit(chunk.x + fromX, chunk.y + localY, std::span<const Cell>(chunk.Row(localY).subspan(fromX, toX - fromX)));
+            }
+        });
+    }
+
+    /**
+     * Visits every cell in memory order
+     * @param visit called with (x, y, Cell)
+     */
+    template<typename F>
+    void ForEachCell(F &&visit) const {
+        ForEachSpan([&](size_t x, size_t y, std::span<const Cell> cells) {
+            for (size_t i = 0; i < cells.size(); ++i) visit(x + i, y, cells[i]);
+        });
+    }
+
+    /**
+     * Visits the cells in [x0, x1) x [y0, y1), clamped to the map, in the order of ForEachSpanIn
+     * @param visit called with (x, y, Cell)
+     */
+    template<typename F>
+    void ForEachCellIn(size_t x0, size_t y0, size_t x1, size_t y1, F &&visit) const {
+        ForEachSpanIn(x0, y0, x1, y1, [&](size_t x, size_t y, std::span<const Cell> cells) {
+            for (size_t i = 0; i < cells.size(); ++i) visit(x + i, y, cells[i]);
+        });
+    }
+
+    /**
+     * Copies row y into `out`, which holds at least width cells, a contiguous run at a time.
+     * Cheaper than width GetElement calls, and what code that wants the cells row-major should use.
+     */
+    void ReadRow(size_t y, std::span<Cell> out) const;
+
+    /**
+     * Sets row y from `cells`, a contiguous run at a time. Runs of a SPARSE map that are all empty are skipped if
+     * their chunk is not stored, so writing an empty row allocates nothing.
+     */
+    void WriteRow(size_t y, std::span<const Cell> cells);
+
+private:
+    [[nodiscard]] Cell *GetIndirectElement(size_t x, size_t y, bool write) const;
+};
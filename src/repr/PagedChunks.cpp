@@ -0,0 +1,201 @@
+#include "PagedChunks.h"
+
+#include <cmath>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+#include <boost/format.hpp>
+
+PagedChunks::PagedChunks(const std::string &name, uint64_t cellsOffset, Tiling tiling, PagingOptions options)
+        : cellsOffset(cellsOffset), tiling(std::move(tiling)),
+          capacity(std::max<size_t>(1, options.memoryCap / sizeof(ChunkCells))) {
+    fd = open(name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        const auto msg = boost::format{"File %1% is not open for reading"} % name;
+        throw std::invalid_argument(msg.str());
+    }
+    prefetcher = std::thread([this] { Prefetch(); });
+}
+
+PagedChunks::~PagedChunks() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    prefetcher.join();
+    close(fd);
+    if (swap != nullptr) std::fclose(swap);
+}
+
+void PagedChunks::Read(size_t chunk, ChunkCells &cells, std::optional<Cell> filled,
+                       std::optional<uint64_t> slot) const {
+    if (filled.has_value()) {
+        cells.fill(*filled);
+        return;
+    }
+    if (slot.has_value()) {
+        const auto offset = static_cast<off_t>(*slot * sizeof cells);
+        if (pread(fileno(swap), cells.data(), sizeof cells, offset) != sizeof cells) {
+            const auto msg = boost::format{"Could not read chunk %1% of a paged map back from swap"} % chunk;
+            throw std::runtime_error(msg.str());
+        }
+        return;
+    }
+
+    const auto offset = static_cast<off_t>(cellsOffset + tiling.slots[chunk] * CHUNK_CELLS);
+    if (pread(fd, cells.data(), sizeof cells, offset) != sizeof cells) {
+        const auto msg = boost::format{"Could not read chunk %1% of a paged map"} % chunk;
+        throw std::runtime_error(msg.str());
+    }
+    // the file was only checked up to its cells when it was opened
+    if (!Cell::AllTagged(cells)) {
+        const auto msg = boost::format{"Chunk %1% of a paged map has a bad cell tag"} % chunk;
+        throw std::runtime_error(msg.str());
+    }
+}
+
+void PagedChunks::Swap(size_t chunk, const ChunkCells &cells) {
+    if (swap == nullptr) {
+        swap = std::tmpfile();
+        if (swap == nullptr) throw std::runtime_error("Could not make a swap file for a paged map");
+    }
+
+    std::lock_guard lock(mutex);
+    const uint64_t slot = swapped.try_emplace(chunk, swapped.size()).first->second;
+    const auto offset = static_cast<off_t>(slot * sizeof cells);
+    if (pwrite(fileno(swap), cells.data(), sizeof cells, offset) != sizeof cells) {
+        const auto msg = boost::format{"Could not write chunk %1% of a paged map to swap"} % chunk;
+        throw std::runtime_error(msg.str());
+    }
+    // a read of the chunk already under way, or waiting in ready, has its cells from before they were written
+    generation += 1;
+    std::erase_if(ready, [chunk](const auto &arrived) { return arrived.first == chunk; });
+}
+
+void PagedChunks::Insert(size_t chunk, std::unique_ptr<ChunkCells> cells) {
+    // evict the coldest chunks, saving those that have been written
+    while (resident.size() >= capacity && !ages.empty()) {
+        const auto found = resident.find(ages.back());
+        if (found->second.dirty) {
+            Swap(found->first, *found->second.cells);
+            stats.swapped += 1;
+        }
+        resident.erase(found);
+        ages.pop_back();
+        stats.evictions += 1;
+    }
+
+    ages.push_front(chunk);
+    resident[chunk] = {.cells = std::move(cells), .age = ages.begin()};
+}
+
+void PagedChunks::TakeReady() {
+    decltype(ready) arrived;
+    {
+        std::lock_guard lock(mutex);
+        arrived.swap(ready);
+    }
+    // dropped before anything is inserted: an insert may swap out a written chunk whose copy from before is here
+    std::erase_if(arrived, [this](const auto &entry) { return resident.contains(entry.first); });
+    for (auto &[chunk, cells] : arrived) {
+        Insert(chunk, std::move(cells));
+        stats.prefetched += 1;
+    }
+}
+
+Cell *PagedChunks::Acquire(size_t chunk, bool write) {
+    auto found = resident.find(chunk);
+    if (found == resident.end()) {
+        TakeReady();
+        found = resident.find(chunk);
+    }
+
+    if (found != resident.end()) {
+        stats.hits += 1;
+        ages.splice(ages.begin(), ages, found->second.age);
+    } else {
+        stats.misses += 1;
+        auto cells = std::make_unique<ChunkCells>();
+        Read(chunk, *cells, fill, SlotOf(chunk));
+        Insert(chunk, std::move(cells));
+        found = resident.find(chunk);
+    }
+
+    found->second.dirty |= write;
+    return found->second.cells->data();
+}
+
+void PagedChunks::Focus(float x, float y, float dirX, float dirY, float radius) {
+    TakeReady();
+
+    const float length = std::hypot(dirX, dirY);
+    const float aheadX = length > 0 ? x + dirX / length * radius : x;
+    const float aheadY = length > 0 ? y + dirY / length * radius : y;
+
+    std::vector<size_t> wanted;
+    for (const auto &[centerX, centerY] : {std::pair{x, y}, std::pair{aheadX, aheadY}}) {
+        const auto lowX = static_cast<long>(std::floor(centerX - radius)) >> CHUNK_BITS;
+        const auto highX = static_cast<long>(std::ceil(centerX + radius)) >> CHUNK_BITS;
+        const auto lowY = static_cast<long>(std::floor(centerY - radius)) >> CHUNK_BITS;
+        const auto highY = static_cast<long>(std::ceil(centerY + radius)) >> CHUNK_BITS;
+
+        for (long cy = std::max(lowY, 0L); cy <= std::min<long>(highY, tiling.chunksY - 1); ++cy) {
+            for (long cx = std::max(lowX, 0L); cx <= std::min<long>(highX, tiling.chunksX - 1); ++cx) {
+                const size_t chunk = cy * tiling.chunksX + cx;
+                if (!resident.contains(chunk)) wanted.push_back(chunk);
+            }
+        }
+    }
+
+    if (wanted.empty()) return;
+    {
+        std::lock_guard lock(mutex);
+        for (const auto chunk : wanted) {
+            if (requested.insert(chunk).second) pending.push_back(chunk);
+        }
+    }
+    wake.notify_one();
+}
+
+void PagedChunks::Fill(Cell cell) {
+    {
+        std::lock_guard lock(mutex);
+        generation += 1;
+        pending.clear();
+        requested.clear();
+        ready.clear();
+        swapped.clear();
+        fill = cell;
+    }
+    resident.clear();
+    ages.clear();
+}
+
+void PagedChunks::Prefetch() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (stopping) return;
+
+        const size_t chunk = pending.front();
+        pending.pop_front();
+        const size_t started = generation;
+        const auto filled = fill;
+        const auto slot = SlotOf(chunk);
+
+        lock.unlock();
+        auto cells = std::make_unique<ChunkCells>();
+        bool read = true;
+        try {
+            Read(chunk, *cells, filled, slot);
+        } catch (const std::runtime_error &) {
+            // the foreground read will report it
+            read = false;
+        }
+        lock.lock();
+
+        requested.erase(chunk);
+        if (read && started == generation) ready.emplace_back(chunk, std::move(cells));
+    }
+}
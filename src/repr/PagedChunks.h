@@ -0,0 +1,136 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "SparseChunks.h"
+
+struct PagingOptions {
+    /** resident chunks are evicted, least recently used first, to stay under this */
+    size_t memoryCap = 64 << 20;
+};
+
+struct PagingStats {
+    /** chunk was resident when asked for */
+    size_t hits = 0;
+    /** chunk had to be read on the calling thread */
+    size_t misses = 0;
+    /** chunk was read ahead of time by the prefetcher */
+    size_t prefetched = 0;
+    size_t evictions = 0;
+    /** evicted chunks that had been written, and so were saved to the swap file */
+    size_t swapped = 0;
+    size_t resident = 0;
+};
+
+/**
+ * Cell storage for a PAGED map: chunks are read from a TILED binary map on demand and kept in an LRU cache bounded by
+ * PagingOptions::memoryCap. Focus() queues the chunks around the player, and further along its movement, for a
+ * background thread to read, so walking rarely has to wait on the disk.
+ *
+ * Everything but the prefetcher runs on the caller's thread. A pointer from Acquire stays valid until the next call to
+ * Acquire, Focus or Fill. Chunks that have been written through Acquire are saved to a private swap file when they are
+ * evicted, and read back from it afterwards, so edits such as opened doors survive without writing to the map file
+ * and without the cache growing past its cap.
+ */
+class PagedChunks {
+private:
+    struct Entry {
+        std::unique_ptr<ChunkCells> cells;
+        std::list<size_t>::iterator age;
+        bool dirty = false;
+    };
+
+    int fd;
+    /** an unlinked temporary file, made the first time a written chunk is evicted */
+    std::FILE *swap = nullptr;
+    uint64_t cellsOffset;
+    Tiling tiling;
+    size_t capacity;
+
+    std::unordered_map<size_t, Entry> resident;
+    /** most recently used chunk first */
+    std::list<size_t> ages;
+    PagingStats stats;
+
+    // shared with the prefetcher
+    std::mutex mutex;
+    std::optional<Cell> fill;
+    /** chunk -> its slot in swap, for chunks that were evicted after being written */
+    std::unordered_map<size_t, uint64_t> swapped;
+    std::condition_variable wake;
+    std::deque<size_t> pending;
+    std::unordered_set<size_t> requested;
+    std::vector<std::pair<size_t, std::unique_ptr<ChunkCells>>> ready;
+    size_t generation = 0;
+    bool stopping = false;
+    std::thread prefetcher;
+
+    /**
+     * @param slot where the chunk is in swap, if it is there
+     */
+    void Read(size_t chunk, ChunkCells &cells, std::optional<Cell> filled, std::optional<uint64_t> slot) const;
+
+    /**
+     * Saves a written chunk that is being evicted to swap
+     */
+    void Swap(size_t chunk, const ChunkCells &cells);
+
+    [[nodiscard]] std::optional<uint64_t> SlotOf(size_t chunk) const {
+        const auto found = swapped.find(chunk);
+        if (found == swapped.end()) return {};
+        return found->second;
+    }
+
+    void Insert(size_t chunk, std::unique_ptr<ChunkCells> cells);
+
+    void TakeReady();
+
+    void Prefetch();
+
+public:
+    /**
+     * @param name a binary map written with Layout::TILED
+     * @param cellsOffset where its chunks start
+     */
+    PagedChunks(const std::string &name, uint64_t cellsOffset, Tiling tiling, PagingOptions options);
+
+    ~PagedChunks();
+
+    PagedChunks(const PagedChunks &) = delete;
+
+    PagedChunks &operator=(const PagedChunks &) = delete;
+
+    /**
+     * @param chunk chunk number (cy * chunksX + cx)
+     * @param write whether the chunk will be written, which pins it in memory
+     * @return the chunk's cells, read from disk if they are not resident
+     */
+    Cell *Acquire(size_t chunk, bool write = false);
+
+    /**
+     * Queues every chunk within radius cells of (x, y), and of the point radius cells further along (dirX, dirY),
+     * for the prefetcher
+     */
+    void Focus(float x, float y, float dirX, float dirY, float radius);
+
+    /**
+     * Makes every chunk read as `cell` from now on, dropping the cache
+     */
+    void Fill(Cell cell);
+
+    [[nodiscard]] PagingStats Stats() const {
+        PagingStats current = stats;
+        current.resident = resident.size();
+        return current;
+    }
+};
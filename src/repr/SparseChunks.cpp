@@ -0,0 +1,19 @@
+#include "SparseChunks.h"
+
+Cell *SparseChunks::Acquire(size_t chunk) {
+    auto &cells = chunks[chunk];
+    if (cells == nullptr) {
+        cells = std::make_unique<ChunkCells>();
+        cells->fill(Cell::Empty());
+    }
+    return cells->data();
+}
+
+Cell *SparseChunks::EmptyChunk() {
+    static ChunkCells empty = [] {
+        ChunkCells cells{};
+        cells.fill(Cell::Empty());
+        return cells;
+    }();
+    return empty.data();
+}
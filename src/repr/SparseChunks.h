@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include "Map.h"
+
+using ChunkCells = std::array<Cell, CHUNK_CELLS>;
+
+/**
+ * Cell storage for a SPARSE map: only chunks holding something other than Tag::EMPTY are allocated,
+ * keyed by chunk number (cy * chunksX + cx). A chunk that is not stored reads as all empty.
+ */
+class SparseChunks {
+private:
+    std::unordered_map<size_t, std::unique_ptr<ChunkCells>> chunks;
+
+public:
+    /**
+     * @return the chunk's cells, or nullptr if it is implicitly empty
+     */
+    [[nodiscard]] Cell *Find(size_t chunk) const {
+        const auto found = chunks.find(chunk);
+        return found != chunks.end() ? found->second->data() : nullptr;
+    }
+
+    /**
+     * @return the chunk's cells, allocating an empty chunk if it was not stored
+     */
+    Cell *Acquire(size_t chunk);
+
+    void Clear() {
+        chunks.clear();
+    }
+
+    [[nodiscard]] size_t StoredChunks() const {
+        return chunks.size();
+    }
+
+    /**
+     * Shared all-empty chunk that absent chunks are read through. Never written.
+     */
+    static Cell *EmptyChunk();
+};
@@ -0,0 +1,79 @@
+#include <atomic>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "parse/MapParser.h"
+#include "parse/MapBinary.h"
+#include "parse/MapCompressed.h"
+#include "solve/Solver.h"
+
+namespace {
+    Map loadMap(const std::string &name) {
+        if (MapBinary::isBinaryName(name)) return MapBinary::loadMap(name);
+        if (MapCompressed::isCompressedName(name)) return MapCompressed::loadMap(name);
+        return MapParser::parseMap(name);
+    }
+
+    void printPositions(std::ostream &out, const char *what, const std::vector<Position> &positions) {
+        if (positions.empty()) return;
+        out << ", " << positions.size() << " unreachable " << what << ":";
+        for (const auto &position : positions) out << " (" << position.x << ", " << position.y << ")";
+    }
+}
+
+/**
+ * Checks that maps (text, .mapb or .mapz) can be finished, printing a line per map.
+ * One map is solved with every core; a batch of them is solved a map per core.
+ * Exits with 1 if any map is invalid or cannot be finished.
+ */
+int main(int argc, char *argv[]) {
+    std::vector<std::string> names(argv + 1, argv + argc);
+    if (names.empty()) {
+        std::cerr << "usage: " << argv[0] << " <map>..." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> reports(names.size());
+    std::atomic<bool> failed = false;
+    std::atomic<size_t> nextMap = 0;
+    const auto work = [&](size_t threads) {
+        for (size_t i = nextMap++; i < names.size(); i = nextMap++) {
+            std::ostringstream report;
+            report << names[i] << ": ";
+            try {
+                const Map map = loadMap(names[i]);
+                const auto solution = Solver::solve(map, {.threads = threads});
+                if (!solution.solvable) {
+                    report << "no finish can be reached";
+                    failed = true;
+                } else if (solution.pathLength.has_value()) {
+                    report << "solvable in " << *solution.pathLength << " moves";
+                } else {
+                    report << "solvable if keys could be used again (too many keys and doors to check they last)";
+                }
+                printPositions(report, "keys", solution.unreachableKeys);
+                printPositions(report, "doors", solution.unreachableDoors);
+                report << " [" << solution.states << " states, " << solution.seconds * 1e3 << " ms]";
+            } catch (const std::invalid_argument &e) {
+                report << e.what();
+                failed = true;
+            }
+            reports[i] = report.str();
+        }
+    };
+
+    const size_t cores = std::max(1U, std::thread::hardware_concurrency());
+    if (names.size() == 1) {
+        work(cores);
+    } else {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < std::min(cores, names.size()); ++i) workers.emplace_back(work, 1);
+        work(1);
+        for (auto &worker : workers) worker.join();
+    }
+
+    for (const auto &report : reports) std::cout << report << std::endl;
+    return failed ? 1 : 0;
+}
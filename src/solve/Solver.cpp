@@ -0,0 +1,376 @@
+#include "Solver.h"
+
+#include <KeyInventory.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    /**
+     * BFS levels with fewer states than this per thread are expanded on the calling thread
+     */
+    constexpr size_t MIN_STATES_PER_THREAD = 4096;
+
+    /**
+     * One bit per cell, which any number of threads may set at once. The bits are kept in pages that are only
+     * allocated once a cell in them is visited, so a search that reaches a corner of a large map pays for the corner.
+     */
+    class VisitedCells {
+    private:
+        static constexpr size_t PAGE_BITS = 18;
+        static constexpr size_t PAGE_WORDS = (size_t{1} << PAGE_BITS) / 64;
+
+        std::vector<std::atomic<std::atomic<uint64_t> *>> pages;
+
+        std::atomic<uint64_t> &WordOf(uint64_t cell) {
+            auto &slot = pages[cell >> PAGE_BITS];
+            std::atomic<uint64_t> *page = slot.load(std::memory_order_acquire);
+            if (page == nullptr) {
+                auto *fresh = new std::atomic<uint64_t>[PAGE_WORDS]();
+                // another thread may have got there first, and then its page is the one kept
+                if (slot.compare_exchange_strong(page, fresh, std::memory_order_acq_rel)) {
+                    page = fresh;
+                } else {
+                    delete[] fresh;
+                }
+            }
+            return page[(cell >> 6) & (PAGE_WORDS - 1)];
+        }
+
+    public:
+        explicit VisitedCells(size_t cells) : pages((cells >> PAGE_BITS) + 1) {}
+
+        VisitedCells(const VisitedCells &) = delete;
+        VisitedCells &operator=(const VisitedCells &) = delete;
+
+        ~VisitedCells() {
+            for (auto &page : pages) delete[] page.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @return true if this call is the one that visited the cell
+         */
+        bool Visit(uint64_t cell) {
+            auto &word = WordOf(cell);
+            const uint64_t bit = uint64_t{1} << (cell & 63);
+            // a plain load first keeps threads from fighting over lines that are already set
+            if (word.load(std::memory_order_relaxed) & bit) return false;
+            return (word.fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+        }
+
+        [[nodiscard]] bool Visited(uint64_t cell) const {
+            const std::atomic<uint64_t> *page = pages[cell >> PAGE_BITS].load(std::memory_order_acquire);
+            if (page == nullptr) return false;
+            return page[(cell >> 6) & (PAGE_WORDS - 1)].load(std::memory_order_relaxed) >> (cell & 63) & 1;
+        }
+    };
+
+    /**
+     * The map copied out row-major, so threads can read it without going through chunk tables or a page cache
+     */
+    struct Grid {
+        size_t width, height;
+        std::vector<Cell> cells;
+        /** y * width + x -> id, for keys and doors */
+        std::unordered_map<uint64_t, size_t> ids;
+
+        explicit Grid(const Map &map) : width(map.width), height(map.height), cells(map.width * map.height) {
+            for (size_t y = 0; y < height; ++y) map.ReadRow(y, std::span(cells).subspan(y * width, width));
+            for (const auto *positions : {&map.index.keys, &map.index.doors}) {
+                for (const auto &position : *positions) {
+                    ids[position.y * width + position.x] = map.GetId(position.x, position.y);
+                }
+            }
+        }
+
+        [[nodiscard]] uint64_t At(const Position &position) const {
+            return position.y * width + position.x;
+        }
+
+        template<typename F>
+        void ForEachNeighbour(uint64_t cell, F &&visit) const {
+            const size_t x = cell % width;
+            if (x > 0) visit(cell - 1);
+            if (x + 1 < width) visit(cell + 1);
+            if (cell >= width) visit(cell - width);
+            if (cell + width < cells.size()) visit(cell + width);
+        }
+    };
+
+    /**
+     * Expands one BFS level, split into slices across threads when it is large enough to be worth it
+     * @param expand called as expand(node, next, local) for every node of the frontier
+     * @param locals gets one value per slice, for results the caller merges afterwards
+     * @return the next level
+     */
+    template<typename Node, typename Local, typename Expand>
+    std::vector<Node> expandLevel(const std::vector<Node> &frontier, size_t threads, std::vector<Local> &locals,
+                                  Expand &&expand) {
+        const size_t slices = std::clamp<size_t>(frontier.size() / MIN_STATES_PER_THREAD, 1, threads);
+        locals.assign(slices, Local{});
+        std::vector<std::vector<Node>> next(slices);
+
+        const auto work = [&](size_t slice) {
+            const size_t begin = frontier.size() * slice / slices;
+            const size_t end = frontier.size() * (slice + 1) / slices;
+            for (size_t i = begin; i < end; ++i) expand(frontier[i], next[slice], locals[slice]);
+        };
+        std::vector<std::thread> workers;
+        for (size_t slice = 1; slice < slices; ++slice) workers.emplace_back(work, slice);
+        work(0);
+        for (auto &worker : workers) worker.join();
+
+        for (size_t slice = 1; slice < slices; ++slice) {
+            next[0].insert(next[0].end(), next[slice].begin(), next[slice].end());
+        }
+        return std::move(next[0]);
+    }
+
+    struct FloodLocal {
+        std::vector<uint64_t> keys;
+        std::vector<uint64_t> blockedDoors;
+    };
+
+    /**
+     * Visits everything reachable, holding every key found so far
+     */
+    void flood(const Grid &grid, const Map &map, size_t threads, VisitedCells &visited) {
+        KeyInventory held;
+        // id -> doors that were reached before a key for them was
+        std::unordered_map<size_t, std::vector<uint64_t>> blocked;
+
+        std::vector<uint64_t> frontier;
+        for (const auto &start : map.index.starts) {
+            if (visited.Visit(grid.At(start))) frontier.push_back(grid.At(start));
+        }
+
+        std::vector<FloodLocal> locals;
+        while (!frontier.empty()) {
+            frontier = expandLevel(frontier, threads, locals, [&](uint64_t cell, auto &next, FloodLocal &local) {
+                grid.ForEachNeighbour(cell, [&](uint64_t neighbour) {
+                    const Tag tag = grid.cells[neighbour].GetTag();
+                    if (tag == Tag::WALL) return;
+                    if (tag == Tag::DOOR && !held.Holds(grid.ids.at(neighbour))) {
+                        local.blockedDoors.push_back(neighbour);
+                        return;
+                    }
+                    if (!visited.Visit(neighbour)) return;
+
+                    if (tag == Tag::KEY) local.keys.push_back(neighbour);
+                    // reaching a finish ends the level, so nothing is reached through one
+                    if (tag != Tag::FINISH) next.push_back(neighbour);
+                });
+            });
+
+            // keys only count from the next level on, so every thread saw the same set
+            for (const auto &local : locals) {
+                for (const auto key : local.keys) {
+                    const size_t id = grid.ids.at(key);
+                    if (held.Holds(id)) continue;
+                    held.Add(id);
+
+                    const auto doors = blocked.find(id);
+                    if (doors == blocked.end()) continue;
+                    for (const auto door : doors->second) {
+                        if (visited.Visit(door)) frontier.push_back(door);
+                    }
+                    blocked.erase(doors);
+                }
+            }
+            for (const auto &local : locals) {
+                for (const auto door : local.blockedDoors) {
+                    const size_t id = grid.ids.at(door);
+                    if (!held.Holds(id)) {
+                        blocked[id].push_back(door);
+                    } else if (visited.Visit(door)) {
+                        frontier.push_back(door);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * The cells visited with one set of picked-up keys and opened doors
+     */
+    struct Layer {
+        uint64_t mask;
+        VisitedCells visited;
+
+        Layer(uint64_t mask, size_t cells) : mask(mask), visited(cells) {}
+    };
+
+    /**
+     * A key or door that the shortest-path search keeps a bit of its state for
+     */
+    struct Bit {
+        uint8_t bit;
+        /** into the id's (key bits, door bits) masks */
+        size_t id;
+    };
+
+    struct State {
+        uint64_t cell;
+        Layer *layer;
+    };
+
+    struct PathLocal {
+        bool finished = false;
+        bool gaveUp = false;
+    };
+
+    /**
+     * BFS over (cell, picked-up keys and opened doors) for the fewest moves to a finish. A door is opened with a key of
+     * its id that has been picked up and not used on another door, and stays open.
+     * @param bits cell -> its bit, for the keys and doors that can change where the player goes
+     * @param ids per id, the bits of its keys and of its doors
+     * @param gaveUp set if the search stopped at maxKeySets before it could tell whether a finish can be reached
+     */
+    std::optional<size_t> shortestPath(const Grid &grid, const Map &map, size_t threads, size_t maxKeySets,
+                                       const std::unordered_map<uint64_t, Bit> &bits,
+                                       const std::vector<std::pair<uint64_t, uint64_t>> &ids, size_t &states,
+                                       bool &gaveUp) {
+        std::mutex layersMutex;
+        std::unordered_map<uint64_t, std::unique_ptr<Layer>> layers;
+        const auto layerFor = [&](uint64_t mask) -> Layer * {
+            std::lock_guard lock(layersMutex);
+            auto &layer = layers[mask];
+            if (layer == nullptr) {
+                if (layers.size() > maxKeySets) return nullptr;
+                layer = std::make_unique<Layer>(mask, grid.cells.size());
+            }
+            return layer.get();
+        };
+        const auto bitOf = [&](uint64_t cell) -> const Bit * {
+            const auto found = bits.find(cell);
+            return found == bits.end() ? nullptr : &found->second;
+        };
+        // keys of the id picked up, less doors of it opened
+        const auto unused = [&](const Bit &door, uint64_t mask) {
+            const auto &[keys, doors] = ids[door.id];
+            return std::popcount(mask & keys) > std::popcount(mask & doors);
+        };
+
+        std::vector<State> frontier;
+        Layer *none = layerFor(0);
+        for (const auto &start : map.index.starts) {
+            if (none->visited.Visit(grid.At(start))) frontier.push_back({grid.At(start), none});
+        }
+        states = frontier.size();
+
+        std::vector<PathLocal> locals;
+        gaveUp = false;
+        for (size_t depth = 1; !frontier.empty(); ++depth) {
+            frontier = expandLevel(frontier, threads, locals, [&](State state, auto &next, PathLocal &local) {
+                grid.ForEachNeighbour(state.cell, [&](uint64_t neighbour) {
+                    const Tag tag = grid.cells[neighbour].GetTag();
+                    Layer *layer = state.layer;
+                    if (tag == Tag::WALL) return;
+                    if (tag == Tag::DOOR || tag == Tag::KEY) {
+                        // a key is picked up and a door opened the first time it is walked onto
+                        const Bit *bit = bitOf(neighbour);
+                        if (bit == nullptr) {
+                            if (tag == Tag::DOOR) return;
+                        } else if ((layer->mask >> bit->bit & 1) == 0) {
+                            if (tag == Tag::DOOR && !unused(*bit, layer->mask)) return;
+                            layer = layerFor(layer->mask | uint64_t{1} << bit->bit);
+                            if (layer == nullptr) {
+                                local.gaveUp = true;
+                                return;
+                            }
+                        }
+                    }
+                    if (tag == Tag::FINISH) {
+                        local.finished = true;
+                        return;
+                    }
+                    if (layer->visited.Visit(neighbour)) next.push_back({neighbour, layer});
+                });
+            });
+            states += frontier.size();
+
+            for (const auto &local : locals) {
+                if (local.finished) return depth;
+                gaveUp |= local.gaveUp;
+            }
+            if (gaveUp) return {};
+        }
+        return {};
+    }
+}
+
+namespace Solver {
+    Solution solve(const Map &map, SolveOptions options) {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t cores = std::max(1U, std::thread::hardware_concurrency());
+        const size_t threads = options.threads != 0 ? options.threads : cores;
+
+        Solution solution;
+        const Grid grid(map);
+        VisitedCells reached(grid.cells.size());
+        flood(grid, map, threads, reached);
+
+        for (const auto &finish : map.index.finishes) {
+            solution.solvable |= reached.Visited(grid.At(finish));
+        }
+        for (const auto &key : map.index.keys) {
+            if (!reached.Visited(grid.At(key))) solution.unreachableKeys.push_back(key);
+        }
+
+        // only doors that can be reached, and keys and doors of ids that have both, change where the player can go
+        std::unordered_map<size_t, std::pair<std::vector<uint64_t>, std::vector<uint64_t>>> byId;
+        for (const auto &key : map.index.keys) {
+            if (reached.Visited(grid.At(key))) byId[grid.ids.at(grid.At(key))].first.push_back(grid.At(key));
+        }
+        for (const auto &door : map.index.doors) {
+            if (!reached.Visited(grid.At(door))) {
+                solution.unreachableDoors.push_back(door);
+                continue;
+            }
+            byId[grid.ids.at(grid.At(door))].second.push_back(grid.At(door));
+        }
+        std::unordered_map<uint64_t, Bit> bits;
+        std::vector<std::pair<uint64_t, uint64_t>> ids;
+        bool tooManyKeys = false;
+        for (const auto &[id, cells] : byId) {
+            const auto &[keys, doors] = cells;
+            if (keys.empty() || doors.empty()) continue;
+            if (bits.size() + keys.size() + doors.size() > 64) {
+                tooManyKeys = true;
+                break;
+            }
+            auto &[keyMask, doorMask] = ids.emplace_back(0, 0);
+            for (const auto key : keys) {
+                keyMask |= uint64_t{1} << bits.size();
+                bits.emplace(key, Bit{.bit = (uint8_t) bits.size(), .id = ids.size() - 1});
+            }
+            for (const auto door : doors) {
+                doorMask |= uint64_t{1} << bits.size();
+                bits.emplace(door, Bit{.bit = (uint8_t) bits.size(), .id = ids.size() - 1});
+            }
+        }
+
+        // the flood lets every key open any number of doors, so it only rules levels out
+        if (solution.solvable && !tooManyKeys) {
+            bool gaveUp = false;
+            solution.pathLength = shortestPath(grid, map, threads, options.maxKeySets, bits, ids, solution.states,
+                                               gaveUp);
+            if (!gaveUp) {
+                solution.solvable = solution.pathLength.has_value();
+                solution.keysCounted = true;
+            }
+        } else if (!solution.solvable) {
+            solution.keysCounted = true;
+        }
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        solution.seconds = elapsed.count();
+        return solution;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+#include <repr/Map.h>
+
+/**
+ * Checks that a level can be finished, without playing it.
+ *
+ * The player moves between the four neighbours of a cell. Walls block, and a key is picked up by walking onto it. As
+ * in the game, walking onto a closed door uses up a held key with its id and leaves the door open, so one key and two
+ * doors of its id in a row cannot be got through.
+ */
+namespace Solver {
+    struct SolveOptions {
+        /** threads to expand each BFS level with, 0 for one per core. Small levels always run on one. */
+        size_t threads = 0;
+        /** the shortest-path search gives up after seeing this many distinct sets of picked-up keys and opened doors */
+        size_t maxKeySets = 256;
+    };
+
+    struct Solution {
+        /** whether a finish can be reached from a start */
+        bool solvable = false;
+        /**
+         * whether solvable took keys being used up into account. When the shortest-path search gives up it is false,
+         * and solvable only says that a finish can be reached if every key opened any number of doors.
+         */
+        bool keysCounted = false;
+        /** the fewest moves from a start to a finish, if solvable and the search did not give up */
+        std::optional<size_t> pathLength;
+        /** keys that can never be picked up, in row-major order */
+        std::vector<Position> unreachableKeys;
+        /** doors that can never be walked through, because no key for them can be reached or they cannot */
+        std::vector<Position> unreachableDoors;
+        /** (cell, picked-up keys and opened doors) states the shortest-path search visited */
+        size_t states = 0;
+        double seconds = 0;
+    };
+
+    /**
+     * Finds what can be reached by flooding the map, picking up every key it touches until no new door opens, then
+     * runs a BFS over (cell, bitmask of picked-up keys and opened doors) states for the shortest path, which also
+     * decides whether the level can be finished with the keys it has. Only reachable doors, and keys and doors of ids
+     * that have both, get a bit; with more than 64 of those the search is not run.
+     */
+    Solution solve(const Map &map, SolveOptions options = {});
+}
@@ -42,10 +42,10 @@ namespace Utils {
     void SDLInit() {
         SDL_Init(SDL_INIT_VIDEO);  //Initialize Graphics (for OpenGL)
 
-        //Ask SDL to get a recent version of OpenGL (3.2 or greater)
+        //Ask SDL to get a recent version of OpenGL (3.3 or greater, for instanced attributes)
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     }
 
     GLuint InitShader(const char *vShaderFileName, const char *fShaderFileName) {
@@ -9,6 +9,7 @@
 #include <type_ptr.hpp>
 #include <ostream>
 #include <iostream>
+#include "render/RenderBackend.h"
 
 
 struct Model {
@@ -25,8 +26,8 @@ struct Model {
 
     static Model combine(std::initializer_list<Model*> models);
 
-    void draw() const{
-        glDrawArrays(GL_TRIANGLES, startVertices, GetNumberVertices()); //(Primitive Type, Start Vertex, Num Verticies)
+    void draw(RenderBackend &backend) const{
+        backend.DrawArrays(GL_TRIANGLES, startVertices, GetNumberVertices()); //(Primitive Type, Start Vertex, Num Verticies)
     }
 
     friend std::ostream &operator<<(std::ostream &os, const Model &model);
@@ -1,5 +1,31 @@
 #include <MapParser.h>
+#include <MapBinary.h>
+#include <CellClassifier.h>
+#include <MapCompressed.h>
+#include <MapWatcher.h>
+#include <repr/SparseChunks.h>
+#include <KeyInventory.h>
+#include <solve/Solver.h>
+#include <generate/MapGenerator.h>
+#include <render/ChunkMesh.h>
+#include <render/ChunkRenderer.h>
+#include <render/DrawList.h>
+#include <render/Frustum.h>
+#include <render/PotentiallyVisibleSet.h>
+#include <render/Raycaster.h>
+#include <render/Image.h>
+#include <render/RenderBackend.h>
+#include <render/SoftwareBackend.h>
+#include <render/Transforms.h>
+#include <render/UniformBlocks.h>
+#include <gtc/matrix_transform.hpp>
+#include <filesystem>
+#include <fstream>
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <sstream>
 
 const auto FILE_NAME = "/Users/andrewgazelka/Projects/School/5607-cg/proj4/test/test.txt";
 const auto INVALID_FILE = "/Users/andrewgazelka/Projects/School/5607-cg/proj4/test/invalid.txt";
@@ -22,5 +48,844 @@ namespace {
                      std::invalid_argument);
 
     };
-}
 
+    TEST(MapParser, StreamMatchesFile) {
+        std::ifstream file(FILE_NAME);
+        Map streamed = MapParser::parseMap(file);
+        Map mapped = MapParser::parseMap(FILE_NAME);
+        EXPECT_TRUE(std::ranges::equal(streamed.elements, mapped.elements));
+    }
+
+    TEST(MapParser, WrongDimensionsDetected) {
+        std::istringstream wide("2 2\n000\n00\n");
+        EXPECT_THROW({ Map map = MapParser::parseMap(wide); }, std::invalid_argument);
+
+        std::istringstream tall("2 2\n00\n00\n00\n");
+        EXPECT_THROW({ Map map = MapParser::parseMap(tall); }, std::invalid_argument);
+
+        std::istringstream huge("100000 100000\n00\n");
+        EXPECT_THROW({ Map map = MapParser::parseMap(huge); }, std::invalid_argument);
+    }
+
+    TEST(Map, CellPacksIntoOneByte) {
+        for (const auto &element : {Element::Start(), Element::Finish(), Element::Empty(), Element::Wall(),
+                                    Element::Door(4), Element::Key(Cell::MAX_ID)}) {
+            EXPECT_EQ(Cell::Pack(element).Unpack(), element);
+        }
+        EXPECT_EQ(Cell::Key(3).GetTag(), Tag::KEY);
+        EXPECT_EQ(Cell::Key(3).GetId(), 3);
+        EXPECT_NE(Cell::Key(3), Cell::Door(3));
+    }
+
+    TEST(MapBinary, RoundTripsTextMap) {
+        Map text = MapParser::parseMap(FILE_NAME);
+        const auto path = (std::filesystem::temp_directory_path() / "round-trip.mapb").string();
+        MapBinary::writeMap(text, path);
+
+        Map binary = MapBinary::loadMap(path);
+        EXPECT_EQ(binary.width, text.width);
+        EXPECT_EQ(binary.height, text.height);
+        EXPECT_TRUE(std::ranges::equal(binary.elements, text.elements));
+        EXPECT_EQ(binary.index.keys, text.index.keys);
+        EXPECT_EQ(binary.index.doors, text.index.doors);
+        EXPECT_EQ(binary.index.finishes, (std::vector<Position>{{.x = 4, .y = 0}}));
+
+        // edits stay in the private mapping
+        *binary.GetElementRef(2, 2) = Cell::Empty();
+        EXPECT_EQ(MapBinary::loadMap(path).GetElement(2, 2), Element::Door(0));
+
+        std::filesystem::remove(path);
+    }
+
+    TEST(MapBinary, TextRejected) {
+        EXPECT_THROW({ Map map = MapBinary::loadMap(FILE_NAME); }, std::invalid_argument);
+    }
+
+    TEST(MapBinary, CorruptFilesRejected) {
+        const auto path = (std::filesystem::temp_directory_path() / "corrupt.mapb").string();
+        MapBinary::writeMap(MapParser::parseText("4 2\nS0aG\nWA00\n"), path);
+        std::string bytes;
+        {
+            std::ifstream file(path, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), {});
+        }
+        MapBinary::MapBinaryHeader header{};
+        std::memcpy(&header, bytes.data(), sizeof header);
+
+        const auto rejects = [&](const auto &corrupt) {
+            std::string changed = bytes;
+            corrupt(changed);
+            std::ofstream(path, std::ios::binary | std::ios::trunc) << changed;
+            EXPECT_THROW({ Map map = MapBinary::loadMap(path); }, std::invalid_argument);
+        };
+        // counts that wrap around to the real total
+        rejects([&](std::string &changed) {
+            MapBinary::MapBinaryHeader wrapped = header;
+            wrapped.keyCount += wrapped.doorCount + 1;
+            wrapped.doorCount = UINT64_MAX;
+            std::memcpy(changed.data(), &wrapped, sizeof wrapped);
+        });
+        rejects([&](std::string &changed) { changed[header.cellsOffset + 1] = 7; });
+        rejects([&](std::string &changed) {
+            const Position outside = {.x = 4, .y = 0};
+            std::memcpy(changed.data() + sizeof header, &outside, sizeof outside);
+        });
+
+        // a paged map reads its cells only when they are used
+        MapBinary::writeMap(MapParser::parseText("4 2\nS0aG\nWA00\n"), path, Layout::TILED);
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            MapBinary::MapBinaryHeader tiled{};
+            file.read(reinterpret_cast<char *>(&tiled), sizeof tiled);
+            file.seekp(static_cast<std::streamoff>(tiled.cellsOffset + 1));
+            file.put(7);
+        }
+        Map paged = MapBinary::pageMap(path);
+        EXPECT_THROW(paged.GetElement(1, 0), std::runtime_error);
+
+        std::filesystem::remove(path);
+    }
+
+    TEST(Map, TiledMatchesRowMajor) {
+        std::string text = "70 40\n";
+        for (int y = 0; y < 40; ++y) {
+            for (int x = 0; x < 70; ++x) text += "0WSGaA"[(x * 7 + y * 13) % 6];
+            text += '\n';
+        }
+        Map rows = MapParser::parseText(text);
+        Map tiled = MapParser::parseText(text, Layout::TILED);
+
+        for (size_t y = 0; y < rows.height; ++y) {
+            for (size_t x = 0; x < rows.width; ++x) {
+                EXPECT_EQ(tiled.GetElement(x, y), rows.GetElement(x, y));
+            }
+        }
+
+        size_t visited = 0;
+        tiled.ForEachCell([&](size_t x, size_t y, Cell cell) {
+            EXPECT_EQ(cell, rows.GetElement(x, y));
+            visited += 1;
+        });
+        EXPECT_EQ(visited, rows.width * rows.height);
+        EXPECT_TRUE(std::ranges::equal(tiled.WithLayout(Layout::ROW_MAJOR).elements, rows.elements));
+    }
+
+    TEST(Map, SpansAndRowsMatchCells) {
+        const Map rows = MapGenerator::generateMap({.width = 75, .height = 41, .keys = 2});
+        std::vector<Cell> row(rows.width);
+
+        for (const Layout layout : {Layout::ROW_MAJOR, Layout::TILED, Layout::SPARSE}) {
+            Map map = rows.WithLayout(layout);
+            size_t visited = 0;
+            map.ForEachSpan([&](size_t x, size_t y, std::span<const Cell> cells) {
+                for (size_t i = 0; i < cells.size(); ++i) EXPECT_EQ(cells[i], rows.GetElement(x + i, y));
+                visited += cells.size();
+            });
+            EXPECT_EQ(visited, map.width * map.height);
+
+            visited = 0;
+            map.ForEachSpanIn(30, 10, 70, 50, [&](size_t x, size_t y, std::span<const Cell> cells) {
+                EXPECT_TRUE(x >= 30 && x + cells.size() <= 70 && y >= 10 && y < 41);
+                for (size_t i = 0; i < cells.size(); ++i) EXPECT_EQ(cells[i], rows.GetElement(x + i, y));
+                visited += cells.size();
+            });
+            EXPECT_EQ(visited, 40 * 31);
+
+            map.ReadRow(7, row);
+            std::reverse(row.begin(), row.end());
+            map.WriteRow(7, row);
+            for (size_t x = 0; x < map.width; ++x) EXPECT_EQ(map.GetElement(x, 7), rows.GetElement(74 - x, 7));
+        }
+
+        Map sparse = Map::Allocate(100, 100, Layout::SPARSE);
+        sparse.WriteRow(50, std::vector<Cell>(100, Cell::Empty()));
+        EXPECT_EQ(sparse.sparse->StoredChunks(), 0);
+    }
+
+    TEST(Map, SparseStoresOnlyNonEmptyChunks) {
+        std::string text = "100 100\n";
+        for (int y = 0; y < 100; ++y) {
+            std::string row(100, '0');
+            if (y == 3) row[5] = 'S';
+            if (y == 90) row[70] = 'a';
+            text += row + '\n';
+        }
+        Map sparse = MapParser::parseText(text, Layout::SPARSE);
+
+        EXPECT_EQ(sparse.sparse->StoredChunks(), 2);
+        EXPECT_EQ(sparse.GetElement(5, 3), Element::Start());
+        EXPECT_EQ(sparse.GetElement(70, 90), Element::Key(0));
+        EXPECT_EQ(sparse.GetElement(50, 50), Element::Empty());
+        EXPECT_EQ(sparse.index.keys, (std::vector<Position>{{.x = 70, .y = 90}}));
+
+        *sparse.GetElementRef(40, 40) = Cell::Wall();
+        EXPECT_EQ(sparse.sparse->StoredChunks(), 3);
+        EXPECT_EQ(sparse.WithLayout(Layout::ROW_MAJOR).GetElement(40, 40), Element::Wall());
+
+        sparse.Fill(Cell::Empty());
+        EXPECT_EQ(sparse.sparse->StoredChunks(), 0);
+    }
+
+    TEST(Map, PagedMatchesTiledUnderMemoryCap) {
+        std::string text = "200 150\n";
+        for (int y = 0; y < 150; ++y) {
+            for (int x = 0; x < 200; ++x) text += "0W0GaA"[(x * 5 + y * 11) % 6];
+            text += '\n';
+        }
+        Map tiled = MapParser::parseText(text, Layout::TILED);
+        const auto path = (std::filesystem::temp_directory_path() / "paged.mapb").string();
+        MapBinary::writeMap(tiled, path, Layout::TILED);
+
+        // room for four of the 35 chunks
+        Map paged = MapBinary::pageMap(path, {.memoryCap = 4 * CHUNK_CELLS});
+        EXPECT_EQ(paged.index.keys, tiled.index.keys);
+        for (size_t y = 0; y < tiled.height; ++y) {
+            for (size_t x = 0; x < tiled.width; ++x) {
+                ASSERT_EQ(paged.GetElement(x, y), tiled.GetElement(x, y));
+            }
+        }
+
+        auto stats = paged.paged->Stats();
+        EXPECT_LE(stats.resident, 4);
+        EXPECT_GT(stats.evictions, 0);
+        EXPECT_GT(stats.hits, stats.misses);
+
+        // written chunks are swapped out rather than dropped, so edits to more chunks than fit survive paging
+        for (size_t y = 0; y < tiled.height; y += CHUNK_SIZE) {
+            for (size_t x = 0; x < tiled.width; x += CHUNK_SIZE) *paged.GetElementRef(x, y) = Cell::Wall();
+        }
+        paged.ForEachCell([](size_t, size_t, Cell) {});
+        for (size_t y = 0; y < tiled.height; y += CHUNK_SIZE) {
+            for (size_t x = 0; x < tiled.width; x += CHUNK_SIZE) EXPECT_EQ(paged.GetElement(x, y), Element::Wall());
+        }
+        stats = paged.paged->Stats();
+        EXPECT_LE(stats.resident, 4);
+        EXPECT_GT(stats.swapped, 0);
+
+        std::filesystem::remove(path);
+    }
+
+    TEST(MapParser, ParallelMatchesSequential) {
+        std::string text = "40 300\n";
+        for (int y = 0; y < 300; ++y) {
+            for (int x = 0; x < 40; ++x) text += "0WSGbB"[(x * 3 + y * 7) % 6];
+            text += '\n';
+        }
+        Map sequential = MapParser::parseText(text, Layout::ROW_MAJOR, 1);
+        Map parallel = MapParser::parseText(text, Layout::ROW_MAJOR, 7);
+        EXPECT_TRUE(std::ranges::equal(parallel.elements, sequential.elements));
+        EXPECT_EQ(parallel.index.starts, sequential.index.starts);
+
+        // the index gathered while parsing, tiled or not, matches a scan of the finished grid
+        Map tiled = MapParser::parseText(text, Layout::TILED, 7);
+        Map scanned = tiled;
+        scanned.BuildIndex();
+        EXPECT_EQ(tiled.index.keys, scanned.index.keys);
+        EXPECT_EQ(tiled.index.doors, scanned.index.doors);
+        EXPECT_EQ(tiled.index.lookup, scanned.index.lookup);
+        const Position key = tiled.index.keys[10];
+        EXPECT_EQ(tiled.index.IndexOf(key), 10);
+        tiled.index.Update(tiled.index.keys[3], Cell::Key(1), Cell::Empty());
+        EXPECT_EQ(tiled.index.IndexOf(key), 9);
+        EXPECT_EQ(tiled.index.IndexOf({.x = 0, .y = 0}), std::nullopt);
+
+        // the earliest of several bad rows is reported, whichever thread finds its error first
+        text[7 + 41 * 250 + 3] = 'z';
+        text[7 + 41 * 20 + 5] = 'x';
+        text[7 + 41 * 100 + 40] = 'W';
+        for (size_t threads : {1, 3, 8}) {
+            try {
+                Map map = MapParser::parseText(text, Layout::TILED, threads);
+                FAIL() << "expected invalid_argument";
+            } catch (const std::invalid_argument &e) {
+                EXPECT_STREQ(e.what(), "Invalid character x in file read (row 21, column 6)");
+            }
+        }
+    }
+
+    TEST(CellClassifier, VectorMatchesFindElement) {
+        // every byte value, at every offset within a vector
+        std::string text;
+        for (int c = 0; c < 256; ++c) text += "0SGWaAeE"[c % 8];
+        for (int bad = 0; bad < 256; ++bad) {
+            std::string line = text;
+            line[(bad * 7) % line.size()] = static_cast<char>(bad);
+
+            std::vector<Cell> expected(line.size()), actual(line.size());
+            const auto expectedValid = CellClassifier::classifyScalar(line.data(), line.size(), expected.data());
+            const auto actualValid = CellClassifier::classify(line.data(), line.size(), actual.data());
+            ASSERT_EQ(actualValid, expectedValid) << "byte " << bad;
+            EXPECT_TRUE(std::equal(expected.begin(), expected.begin() + expectedValid, actual.begin()));
+        }
+    }
+
+    TEST(MapCompressed, RoundTripsIntoEveryLayout) {
+        std::string text = "90 60\n";
+        for (int y = 0; y < 60; ++y) {
+            for (int x = 0; x < 90; ++x) text += y % 4 == 1 ? 'W' : x % 9 == 0 ? "WaB"[y % 3] : '0';
+            text += '\n';
+        }
+        Map map = MapParser::parseText(text);
+        const auto path = (std::filesystem::temp_directory_path() / "round-trip.mapz").string();
+        const auto written = MapCompressed::writeMap(map, path);
+        EXPECT_GT(written.Ratio(), 3);
+
+        for (auto layout : {Layout::ROW_MAJOR, Layout::TILED, Layout::SPARSE}) {
+            MapCompressed::CompressionStats stats;
+            Map decoded = MapCompressed::loadMap(path, layout, &stats);
+            EXPECT_EQ(stats.compressedBytes, written.compressedBytes);
+            EXPECT_TRUE(std::ranges::equal(decoded.WithLayout(Layout::ROW_MAJOR).elements, map.elements));
+            EXPECT_EQ(decoded.index.keys, map.index.keys);
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        std::string bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        std::istringstream truncated(bytes.substr(0, bytes.size() - 1));
+        EXPECT_THROW({ Map m = MapCompressed::loadMap(truncated); }, std::invalid_argument);
+
+        std::istringstream headless(bytes.substr(0, 5));
+        try {
+            Map m = MapCompressed::loadMap(headless);
+            ADD_FAILURE();
+        } catch (const std::invalid_argument &e) {
+            EXPECT_NE(std::string(e.what()).find("header"), std::string::npos);
+        }
+
+        // rejected from the header, before the map is allocated
+        MapCompressed::MapCompressedHeader huge{};
+        std::memcpy(&huge, bytes.data(), sizeof huge);
+        huge.width = huge.height = UINT32_MAX;
+        std::string hugeBytes = bytes;
+        std::memcpy(hugeBytes.data(), &huge, sizeof huge);
+        std::istringstream hostile(hugeBytes);
+        EXPECT_THROW({ Map m = MapCompressed::loadMap(hostile); }, std::invalid_argument);
+
+        std::filesystem::remove(path);
+    }
+
+    TEST(MapWatcher, AppliesOnlyEditedRows) {
+        const auto path = (std::filesystem::temp_directory_path() / "watched.txt").string();
+        const std::string text = "4 3\nS00a\nWWA0\n000G\n";
+        std::ofstream(path) << text;
+        Map map = MapParser::parseText(text, Layout::TILED);
+        MapWatcher watcher(path);
+
+        // a door opened while playing is in a row nobody edits, so it stays open
+        *map.GetElementRef(2, 1) = Cell::Empty();
+        const auto changes = watcher.Apply(map, "4 3\nS0b0\nWWA0\n000G\n");
+        EXPECT_FALSE(changes.reloaded);
+        ASSERT_EQ(changes.cells.size(), 2);
+        EXPECT_EQ(changes.cells[0].after, Cell::Key(1));
+        EXPECT_EQ(changes.cells[1].before, Cell::Key(0));
+        EXPECT_EQ(map.GetElement(2, 1), Cell::Empty());
+        EXPECT_EQ(map.index.keys, (std::vector<Position>{{.x = 2, .y = 0}}));
+
+        EXPECT_THROW(watcher.Apply(map, "4 3\nS0b0\nWW?0\n000G\n"), std::invalid_argument);
+        EXPECT_EQ(map.GetElement(2, 0), Cell::Key(1));
+
+        EXPECT_TRUE(watcher.Apply(map, "2 1\nSG\n").reloaded);
+        EXPECT_EQ(map.width, 2);
+        std::filesystem::remove(path);
+    }
+
+    TEST(MapParser, ExtendedIdsParsed) {
+        const std::string text = "5 2\na{300}0A{300}Wb\nA{7}a{31}000\n";
+        for (auto layout : {Layout::ROW_MAJOR, Layout::TILED, Layout::SPARSE}) {
+            Map map = MapParser::parseText(text, layout);
+            EXPECT_EQ(map.GetElement(0, 0).GetTag(), Tag::KEY);
+            EXPECT_EQ(map.GetId(0, 0), 300);
+            EXPECT_EQ(map.GetId(2, 0), 300);
+            EXPECT_EQ(map.GetElement(3, 0), Cell::Wall());
+            EXPECT_EQ(map.GetId(4, 0), 1);
+            EXPECT_EQ(map.GetElement(0, 1), Cell::Door(7));
+            EXPECT_EQ(map.GetId(1, 1), 31);
+        }
+        {
+            // an overwritten cell drops its larger id, so a key of id 31 written there later is read as 31
+            Map refilled = MapParser::parseText(text);
+            refilled.SetElement(0, 0, Tag::EMPTY);
+            *refilled.GetElementRef(0, 0) = Cell::Key(Cell::EXTENDED_ID);
+            EXPECT_EQ(refilled.GetId(0, 0), 31);
+            refilled.Fill(Cell::Empty());
+            *refilled.GetElementRef(2, 0) = Cell::Door(Cell::EXTENDED_ID);
+            EXPECT_EQ(refilled.GetId(2, 0), 31);
+            EXPECT_TRUE(refilled.ExtendedIds().empty());
+        }
+        EXPECT_THROW(MapParser::parseText("2 1\na{70000}0\n"), std::invalid_argument);
+        EXPECT_THROW(MapParser::parseText("2 1\nW{3}0\n"), std::invalid_argument);
+        EXPECT_THROW(MapParser::parseText("2 1\na{3\n"), std::invalid_argument);
+
+        Map map = MapParser::parseText(text);
+        const auto dir = std::filesystem::temp_directory_path();
+        MapBinary::writeMap(map, (dir / "extended.mapb").string(), Layout::TILED);
+        MapCompressed::writeMap(map, (dir / "extended.mapz").string());
+        EXPECT_EQ(MapBinary::loadMap((dir / "extended.mapb").string()).ExtendedIds(), map.ExtendedIds());
+        EXPECT_EQ(MapCompressed::loadMap((dir / "extended.mapz").string()).ExtendedIds(), map.ExtendedIds());
+        std::filesystem::remove(dir / "extended.mapb");
+        std::filesystem::remove(dir / "extended.mapz");
+
+        KeyInventory inventory;
+        inventory.Add(300);
+        inventory.Add(300);
+        EXPECT_TRUE(inventory.Holds(300));
+        EXPECT_FALSE(inventory.Holds(7));
+        EXPECT_TRUE(inventory.Use(300));
+        EXPECT_TRUE(inventory.Use(300));
+        EXPECT_FALSE(inventory.Holds(300));
+        EXPECT_FALSE(inventory.Use(300));
+    }
+
+    TEST(Solver, FindsShortestPathThroughDoors) {
+        // the key is behind the start, so the shortest path walks back for it
+        Map map = MapParser::parseText("7 3\n0aS0A0G\nWWWWWWW\nb0WB00G\n");
+        auto solution = Solver::solve(map);
+        EXPECT_TRUE(solution.solvable);
+        EXPECT_EQ(solution.pathLength, 6);
+        EXPECT_EQ(solution.unreachableKeys, (std::vector<Position>{{.x = 0, .y = 2}}));
+        EXPECT_EQ(solution.unreachableDoors, (std::vector<Position>{{.x = 3, .y = 2}}));
+
+        EXPECT_FALSE(Solver::solve(MapParser::parseText("3 1\nSBG\n")).solvable);
+
+        // the key is used up by the first door, as in the game, unless there is a way round it
+        const auto spent = Solver::solve(MapParser::parseText("5 1\nSaAAG\n"));
+        EXPECT_FALSE(spent.solvable);
+        EXPECT_TRUE(spent.keysCounted);
+        const auto around = Solver::solve(MapParser::parseText("6 3\nSaA0AG\nWWW0W0\nWWW000\n"));
+        EXPECT_TRUE(around.solvable);
+        EXPECT_EQ(around.pathLength, 9);
+
+        // an open field large enough that its BFS levels are expanded on several threads
+        std::string text = "300 300\n";
+        for (int y = 0; y < 300; ++y) {
+            for (int x = 0; x < 300; ++x) text += y % 7 == 3 && x % 50 != 0 ? 'W' : '0';
+            text += '\n';
+        }
+        text[text.find('\n') + 1] = 'S';
+        text[text.size() - 2] = 'G';
+        Map field = MapParser::parseText(text, Layout::TILED);
+        const auto parallel = Solver::solve(field, {.threads = 4});
+        EXPECT_EQ(parallel.pathLength, Solver::solve(field, {.threads = 1}).pathLength);
+        EXPECT_EQ(parallel.pathLength, 598);
+    }
+
+    TEST(MapGenerator, SeededLevelsAreSolvable) {
+        const MapGenerator::GeneratorOptions options = {.width = 203, .height = 101, .seed = 42, .keys = 9,
+                                                        .doorsPerGate = 3};
+        const auto text = MapGenerator::generateText(options);
+        EXPECT_EQ(text, MapGenerator::generateText(options));
+        EXPECT_NE(text, MapGenerator::generateText({.width = 203, .height = 101, .seed = 43, .keys = 9}));
+
+        Map map = MapParser::parseText(text);
+        EXPECT_EQ(map.width, 203);
+        EXPECT_EQ(map.height, 101);
+        EXPECT_EQ(map.index.starts.size(), 1);
+        EXPECT_EQ(map.index.finishes.size(), 1);
+        EXPECT_EQ(map.index.keys.size(), 9);
+        EXPECT_EQ(map.index.doors.size(), 27);
+
+        const auto solution = Solver::solve(map);
+        EXPECT_TRUE(solution.solvable);
+        EXPECT_TRUE(solution.unreachableKeys.empty());
+        EXPECT_TRUE(solution.unreachableDoors.empty());
+
+        for (size_t corridor : {2, 3}) {
+            Map wide = MapGenerator::generateMap({.width = 64, .height = 64, .corridorWidth = corridor, .keys = 2});
+            EXPECT_TRUE(Solver::solve(wide).solvable);
+        }
+        EXPECT_THROW(MapGenerator::generateText({.width = 2, .height = 2}), std::invalid_argument);
+    }
+
+    TEST(ChunkMesh, MergesVisibleFaces) {
+        // a unit cube, two triangles a face, with only positions and normals filled in
+        std::vector<float> cube;
+        for (int axis = 0; axis < 3; ++axis) {
+            for (float sign : {1.0f, -1.0f}) {
+                for (int vertex = 0; vertex < 6; ++vertex) {
+                    float position[3] = {0, 0, 0}, normal[3] = {0, 0, 0};
+                    position[axis] = normal[axis] = sign;
+                    position[axis] *= 0.5f;
+                    cube.insert(cube.end(), {position[0], position[1], position[2], 0, 0, normal[0], normal[1], normal[2]});
+                }
+            }
+        }
+
+        Map map = MapParser::parseText("4 3\nWWWW\nWS0W\nWA{5}WW\n");
+        const auto mesh = ChunkMeshes::build(ChunkMeshes::snapshot(map, 0, 7), cube);
+        EXPECT_EQ(mesh.version, 7);
+
+        // floors only under S, 0 and the door, each just its top
+        ASSERT_EQ(mesh.batches.size(), 3);
+        EXPECT_EQ(mesh.batches[0].material, Material::FLOOR);
+        EXPECT_EQ(mesh.batches[0].count, 3 * 6);
+        for (uint32_t v = 0; v < mesh.batches[0].count; ++v) EXPECT_EQ(mesh.vertices[v * 8 + 2], -0.5f);
+
+        // the door (id 5) is between walls, so only its top and its faces towards S and off the map are left
+        EXPECT_EQ(mesh.batches[2].material, Material::DOOR);
+        EXPECT_EQ(mesh.batches[2].shade, 0);
+        EXPECT_EQ(mesh.batches[2].count, 3 * 6);
+
+        // 9 wall tops, and each wall has 2 sides that face a floor or the edge of the map
+        EXPECT_EQ(mesh.batches[1].material, Material::WALL);
+        EXPECT_EQ(mesh.batches[1].count, (9 + 18) * 6);
+        EXPECT_EQ(mesh.vertices.size(), (mesh.batches[1].first + mesh.batches[1].count + 18) * 8);
+
+        ChunkMeshBuilder builder(cube);
+        builder.Submit(ChunkMeshes::snapshot(map, 0, 8));
+        builder.Wait();
+        const auto built = builder.TakeFinished();
+        ASSERT_EQ(built.size(), 1);
+        EXPECT_EQ(built[0].vertices, mesh.vertices);
+        EXPECT_TRUE(builder.TakeFinished().empty());
+    }
+
+    TEST(ChunkRenderer, RebuildsEvictedChunks) {
+        // one more chunk than can stay resident, in a row
+        const size_t chunks = 257, width = chunks * CHUNK_SIZE;
+        Map map = MapParser::parseText(std::to_string(width) + " 1\nS" + std::string(width - 2, '0') + "G\n");
+        NullBackend backend;
+        ChunkRenderer renderer(backend, map, Model{}, 0);
+        renderer.InvalidateAll();
+
+        const auto drawn = [&](size_t chunk) { return renderer.Draw(chunk, [](GLuint, const MeshBatch &) {}); };
+        const auto nextFrame = [&] {
+            renderer.Wait();
+            renderer.BeginFrame();
+        };
+
+        for (size_t chunk = 0; chunk < chunks; ++chunk) EXPECT_FALSE(drawn(chunk));
+        nextFrame();
+        for (size_t chunk = 0; chunk < chunks; ++chunk) EXPECT_TRUE(drawn(chunk));
+        renderer.EndFrame();
+
+        // every chunk but the first, which is the one freed
+        nextFrame();
+        for (size_t chunk = 1; chunk < chunks; ++chunk) EXPECT_TRUE(drawn(chunk));
+        renderer.EndFrame();
+
+        nextFrame();
+        EXPECT_FALSE(drawn(0));
+        nextFrame();
+        EXPECT_TRUE(drawn(0));
+        renderer.Release();
+    }
+
+    TEST(Frustum, CullsBoxesOutOfView) {
+        // looking along +x from the origin, as far as 10
+        const glm::mat4 view = glm::lookAt(glm::vec3(0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1));
+        const Frustum frustum = Frustum::FromMatrix(glm::perspective(3.14f / 4, 4.0f / 3, 0.01f, 10.0f) * view);
+
+        EXPECT_TRUE(frustum.Intersects(glm::vec3(4, -0.5, -0.5), glm::vec3(5, 0.5, 0.5)));
+        EXPECT_FALSE(frustum.Intersects(glm::vec3(-5, -0.5, -0.5), glm::vec3(-4, 0.5, 0.5)));
+        EXPECT_FALSE(frustum.Intersects(glm::vec3(11, -0.5, -0.5), glm::vec3(12, 0.5, 0.5)));
+        EXPECT_FALSE(frustum.Intersects(glm::vec3(2, 5, -0.5), glm::vec3(3, 6, 0.5)));
+        // straddling the camera
+        EXPECT_TRUE(frustum.Intersects(glm::vec3(-1, -1, -1), glm::vec3(1, 1, 1)));
+
+        BoxList boxes;
+        for (int y = -12; y < 12; ++y) {
+            for (int x = -12; x < 13; ++x) boxes.Add(glm::vec3(x - .5f, y - .5f, -1.5f), glm::vec3(x + .5f, y + .5f, .5f));
+        }
+        std::vector<uint8_t> vector, scalar;
+        const size_t passed = frustum.Cull(boxes, vector);
+        EXPECT_EQ(passed, frustum.CullScalar(boxes, scalar));
+        EXPECT_EQ(vector, scalar);
+        EXPECT_GT(passed, 0);
+        EXPECT_LT(passed, boxes.Size() / 4);
+    }
+
+    TEST(PotentiallyVisibleSet, DoorsArePortals) {
+        // a corridor along y = 29 shut by a door at x = 30, and another along y = 36 in the chunk row below
+        std::vector<std::string> rows(40, std::string(70, 'W'));
+        for (size_t x = 1; x < 69; ++x) rows[29][x] = rows[36][x] = '0';
+        rows[29][1] = 'S';
+        rows[29][10] = 'a';
+        rows[29][30] = 'A';
+        rows[36][1] = 'G';
+        std::string text = "70 40\n";
+        for (const auto &row : rows) text += row + "\n";
+        Map map = MapParser::parseText(text);
+
+        EXPECT_THROW(PotentiallyVisibleSet(map, 40), std::invalid_argument);
+        PotentiallyVisibleSet pvs(map, 10);
+        EXPECT_EQ(pvs.ComputedClusters(), 0);
+        EXPECT_TRUE(pvs.Visible(25, 29, 0));
+        EXPECT_EQ(pvs.ComputedClusters(), 1);
+        EXPECT_FALSE(pvs.Visible(25, 29, 1));
+        // the corridor below is behind a wall, and the chunk past that is out of reach
+        EXPECT_FALSE(pvs.Visible(25, 29, map.ChunksX()));
+        EXPECT_FALSE(pvs.Visible(25, 29, 2));
+
+        map.SetElement(30, 29, Tag::EMPTY);
+        pvs.OpenDoor(30, 29);
+        EXPECT_TRUE(pvs.Visible(25, 29, 1));
+        EXPECT_FALSE(pvs.Visible(25, 29, map.ChunksX()));
+
+        pvs.Precompute();
+        EXPECT_EQ(pvs.ComputedClusters(), (70 + 3) / 4 * (40 / 4));
+    }
+
+    TEST(DrawList, SortsByStateThenDepth) {
+        DrawList list;
+        list.Add(3, 10, -1, glm::vec3(0.4f, 0, 0), 0, 6, 5.0f);
+        list.Add(3, 11, 1, glm::vec3(0), 0, 6, 9.0f);
+        list.Add(3, 12, 1, glm::vec3(0), 0, 6, 2.0f);
+        list.Add(3, 13, -1, glm::vec3(0.2f, 0, 0), 0, 6, 1.0f);
+        list.Add(3, 14, -1, glm::vec3(0.4f, 0, 0), 0, 6, 0.5f);
+        list.Sort();
+
+        std::vector<uint32_t> order;
+        for (const auto &call : list.Calls()) order.push_back(call.vertexArray);
+        EXPECT_EQ(order, (std::vector<uint32_t>{13, 14, 10, 12, 11}));
+        EXPECT_LT(DrawList::SortKey(3, 0, glm::vec3(0), 100.0f), DrawList::SortKey(4, -1, glm::vec3(0), 0.0f));
+
+        StateCache state;
+        EXPECT_TRUE(state.SetProgram(3));
+        EXPECT_TRUE(state.SetDrawBlock(0));
+        EXPECT_FALSE(state.SetDrawBlock(0));
+        EXPECT_FALSE(state.SetProgram(3));
+        // the range bound to the Draw block stays bound whatever program is in use
+        EXPECT_TRUE(state.SetProgram(4));
+        EXPECT_FALSE(state.SetDrawBlock(0));
+        EXPECT_TRUE(state.SetDrawBlock(UniformBlocks::DRAW_STRIDE));
+        EXPECT_EQ(state.Issued(), 4);
+        EXPECT_EQ(state.Skipped(), 3);
+        state.Reset();
+        EXPECT_TRUE(state.SetProgram(4));
+        EXPECT_TRUE(state.SetDrawBlock(UniformBlocks::DRAW_STRIDE));
+    }
+
+    TEST(RenderBackend, RecordedTracesReplay) {
+        const auto drawSomething = [](RenderBackend &backend) {
+            const GLuint vao = backend.CreateVertexArray();
+            const GLuint buffer = backend.CreateBuffer();
+            backend.BindVertexArray(vao);
+            backend.BindBuffer(GL_ARRAY_BUFFER, buffer);
+            const std::vector<float> vertices = {0.5f, -1.25f, 3.0f, 1e-7f};
+            backend.BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+            backend.VertexAttribPointer(0, 3, GL_FLOAT, false, 16, 4);
+            backend.EnableVertexAttribArray(0);
+            backend.UseProgram(7);
+            const GLint color = backend.GetUniformLocation(7, "inColor");
+            backend.Uniform(color, glm::vec3(0.1f, 0.2f, 0.3f));
+            backend.Uniform(backend.GetUniformLocation(7, "model"), glm::mat4(2.5f));
+            backend.Uniform(backend.GetUniformLocation(7, "texID"), -1);
+            backend.UniformBlockBinding(7, backend.GetUniformBlockIndex(7, "Frame"), 2);
+            backend.BindBufferRange(GL_UNIFORM_BUFFER, 2, buffer, 0, 16);
+            backend.DrawArrays(GL_TRIANGLES, 0, 3);
+            backend.BufferData(GL_ARRAY_BUFFER, 64, nullptr, GL_STREAM_DRAW);
+            backend.DrawArraysInstanced(GL_TRIANGLES, 0, 3, 10);
+            backend.DeleteBuffer(buffer);
+            backend.DeleteVertexArray(vao);
+        };
+
+        NullBackend null;
+        std::stringstream trace;
+        RecordingBackend recording(null, &trace);
+        drawSomething(recording);
+        EXPECT_EQ(recording.Draws(), 2);
+        EXPECT_EQ(recording.UniformUploads(), 3);
+        EXPECT_EQ(recording.Binds(), 4);
+        EXPECT_EQ(recording.BlockBinds(), 1);
+        EXPECT_EQ(recording.BytesUploaded(), 16);
+        EXPECT_EQ(recording.Count(RenderCall::GET_UNIFORM_LOCATION), 3);
+
+        // a fresh null backend gives out the same names, so the replay writes the same trace
+        NullBackend otherNull;
+        std::stringstream replayed;
+        RecordingBackend again(otherNull, &replayed);
+        EXPECT_EQ(RenderTrace::replay(trace, again), recording.Calls());
+        EXPECT_EQ(replayed.str(), trace.str());
+
+        std::istringstream bad("DrawTriangles 1 2 3\n");
+        EXPECT_THROW(RenderTrace::replay(bad, null), std::invalid_argument);
+        std::istringstream truncated("BindBuffer 34962\n");
+        EXPECT_THROW(RenderTrace::replay(truncated, null), std::invalid_argument);
+    }
+
+    TEST(Image, BMPRoundTrip) {
+        // 3 pixels make rows of 9 bytes, padded to 12 in the file
+        Image image(3, 2);
+        for (size_t i = 0; i < image.pixels.size(); ++i) image.pixels[i] = static_cast<uint8_t>(i * 13);
+
+        const auto path = (std::filesystem::temp_directory_path() / "round-trip.bmp").string();
+        Images::writeBMP(image, path);
+        const Image loaded = Images::loadBMP(path);
+        std::filesystem::remove(path);
+        EXPECT_EQ(loaded.width, 3);
+        EXPECT_EQ(loaded.height, 2);
+        EXPECT_EQ(loaded.pixels, image.pixels);
+
+        EXPECT_THROW(Images::loadBMP(path), std::invalid_argument);
+    }
+
+    TEST(SoftwareBackend, DepthTestsTriangles) {
+        // tiles of 64 leave partial ones on the right and bottom
+        SoftwareBackend backend(100, 70, 2);
+        const auto vertex = [](std::vector<float> &vertices, float x, float y, float z) {
+            // facing away from the light, so only the ambient third of the colour is left
+            vertices.insert(vertices.end(), {x, y, z, 0, 0, 0, 0, -1});
+        };
+        std::vector<float> vertices;
+        vertex(vertices, -0.5f, -0.5f, -0.5f);
+        vertex(vertices, 0.5f, -0.5f, -0.5f);
+        vertex(vertices, 0, 0.5f, -0.5f);
+        vertex(vertices, -1, -1, 0.5f);
+        vertex(vertices, 1, -1, 0.5f);
+        vertex(vertices, -1, 1, 0.5f);
+
+        const GLuint vao = backend.CreateVertexArray();
+        const GLuint buffer = backend.CreateBuffer();
+        backend.BindVertexArray(vao);
+        backend.BindBuffer(GL_ARRAY_BUFFER, buffer);
+        backend.BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        for (const auto &[name, size, offset] : {std::tuple{"position", 3, 0}, {"inTexcoord", 2, 3}, {"inNormal", 3, 5}}) {
+            const GLint attribute = backend.GetAttribLocation(1, name);
+            backend.VertexAttribPointer(attribute, size, GL_FLOAT, false, 8 * sizeof(float), offset * sizeof(float));
+            backend.EnableVertexAttribArray(attribute);
+        }
+
+        backend.ClearColor(0, 0, 1, 1);
+        backend.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        backend.UseProgram(1);
+        backend.Uniform(backend.GetUniformLocation(1, "texID"), -1);
+        // the nearer triangle first, so the depth test has to keep the further one from drawing over it
+        backend.Uniform(backend.GetUniformLocation(1, "inColor"), glm::vec3(0, 1, 0));
+        backend.DrawArrays(GL_TRIANGLES, 0, 3);
+        backend.Uniform(backend.GetUniformLocation(1, "inColor"), glm::vec3(1, 0, 0));
+        backend.DrawArrays(GL_TRIANGLES, 3, 3);
+        EXPECT_EQ(backend.Triangles(), 2);
+
+        const Image &frame = backend.Frame();
+        const auto pixel = [&](size_t x, size_t y) {
+            const uint8_t *p = frame.At(x, y);
+            return std::vector<int>{p[0], p[1], p[2]};
+        };
+        EXPECT_EQ(pixel(50, 35), (std::vector<int>{0, 77, 0}));
+        EXPECT_EQ(pixel(5, 65), (std::vector<int>{77, 0, 0}));
+        // the further triangle covers the frame only up to its diagonal
+        EXPECT_EQ(pixel(95, 5), (std::vector<int>{0, 0, 255}));
+        EXPECT_EQ(pixel(99, 69), (std::vector<int>{0, 0, 255}));
+        EXPECT_EQ(pixel(0, 0), (std::vector<int>{77, 0, 0}));
+    }
+
+    TEST(UniformBlocks, DrawFromBlocksWithOneUploadEach) {
+        SoftwareBackend software(100, 70, 1);
+        RecordingBackend backend(software);
+        UniformBlocks blocks(backend);
+        blocks.Attach(1);
+        EXPECT_EQ(backend.Count(RenderCall::UNIFORM_BLOCK_BINDING), 2);
+
+        // facing away from the light, as in SoftwareBackend.DepthTestsTriangles
+        const std::vector<float> vertices = {
+                -0.5f, -0.5f, -0.5f, 0, 0, 0, 0, -1,
+                0.5f, -0.5f, -0.5f, 0, 0, 0, 0, -1,
+                0, 0.5f, -0.5f, 0, 0, 0, 0, -1,
+        };
+        const GLuint vao = backend.CreateVertexArray();
+        backend.BindVertexArray(vao);
+        backend.BindBuffer(GL_ARRAY_BUFFER, backend.CreateBuffer());
+        backend.BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        for (const auto &[attribute, size, offset] : {std::tuple{0, 3, 0}, {1, 2, 3}, {2, 3, 5}}) {
+            backend.VertexAttribPointer(attribute, size, GL_FLOAT, false, 8 * sizeof(float), offset * sizeof(float));
+            backend.EnableVertexAttribArray(attribute);
+        }
+
+        backend.ResetCounts();
+        backend.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        blocks.SetFrame(glm::mat4(1), glm::mat4(1));
+        // the same camera again is not uploaded again
+        blocks.SetFrame(glm::mat4(1), glm::mat4(1));
+        const glm::mat4 identity(1);
+        const DrawUniforms green = {.transform = Transforms::compute(identity, identity, identity),
+                                    .color = glm::vec4(0, 1, 0, 0), .texID = -1};
+        const glm::mat4 moved = glm::translate(identity, glm::vec3(-1, 0, 0));
+        const DrawUniforms red = {.transform = Transforms::compute(identity, identity, moved),
+                                  .color = glm::vec4(1, 0, 0, 0), .texID = -1};
+        const size_t first = blocks.AddDraw(green);
+        EXPECT_EQ(blocks.AddDraw(green), first);
+        const size_t second = blocks.AddDraw(red);
+        EXPECT_EQ(second, first + UniformBlocks::DRAW_STRIDE);
+        blocks.UploadDraws();
+
+        backend.UseProgram(1);
+        blocks.BindDraw(first);
+        backend.DrawArrays(GL_TRIANGLES, 0, 3);
+        blocks.BindDraw(second);
+        backend.DrawArrays(GL_TRIANGLES, 0, 3);
+        EXPECT_EQ(backend.BlockUploads(), 2);
+        EXPECT_EQ(backend.BlockBinds(), 2);
+        EXPECT_EQ(backend.UniformUploads(), 0);
+        EXPECT_EQ(backend.BytesUploaded(), sizeof(FrameUniforms) + 2 * UniformBlocks::DRAW_STRIDE);
+
+        const Image &frame = software.Frame();
+        const auto pixel = [&](size_t x, size_t y) {
+            const uint8_t *p = frame.At(x, y);
+            return std::vector<int>{p[0], p[1], p[2]};
+        };
+        EXPECT_EQ(pixel(50, 35), (std::vector<int>{0, 77, 0}));
+        EXPECT_EQ(pixel(5, 35), (std::vector<int>{77, 0, 0}));
+        EXPECT_EQ(pixel(95, 35), (std::vector<int>{0, 0, 0}));
+        blocks.Release();
+    }
+
+    TEST(Transforms, MatchTheShadersMatrices) {
+        const glm::mat4 view = glm::lookAt(glm::vec3(2, 3, 0), glm::vec3(1, 3.5f, -0.2f), glm::vec3(0, 0, 1));
+        const glm::mat4 proj = glm::perspective(0.8f, 4.0f / 3, 0.01f, 10.0f);
+        // more than a multiple of 8 lanes, so the scalar tail is used too
+        std::vector<glm::mat4> models;
+        for (int i = 0; i < 19; ++i) {
+            glm::mat4 model = glm::translate(glm::mat4(1), glm::vec3(i, -0.5f * i, 0.1f));
+            model = glm::rotate(model, 0.3f * i, glm::vec3(0, 0, 1));
+            models.push_back(glm::scale(model, glm::vec3(0.2f + 0.1f * i, 1, 0.5f)));
+        }
+
+        std::vector<Transform> transforms(models.size()), scalar(models.size());
+        Transforms::computeAll(view, proj, models, transforms);
+        Transforms::computeAllScalar(view, proj, models, scalar);
+        for (size_t i = 0; i < models.size(); ++i) {
+            // alike to rounding only, as the compiler may fuse the scalar multiply-adds and not the intrinsics
+            const auto simdFloats = std::bit_cast<std::array<float, sizeof(Transform) / sizeof(float)>>(transforms[i]);
+            const auto scalarFloats = std::bit_cast<std::array<float, sizeof(Transform) / sizeof(float)>>(scalar[i]);
+            for (size_t j = 0; j < simdFloats.size(); ++j) EXPECT_NEAR(simdFloats[j], scalarFloats[j], 1e-5f);
+
+            const glm::mat4 modelView = view * models[i];
+            const glm::mat3 normal = glm::transpose(glm::inverse(glm::mat3(modelView)));
+            for (int column = 0; column < 4; ++column) {
+                for (int row = 0; row < 4; ++row) {
+                    EXPECT_NEAR(transforms[i].mvp[column][row], (proj * modelView)[column][row], 1e-4f);
+                    EXPECT_NEAR(transforms[i].modelView[column][row], modelView[column][row], 1e-4f);
+                }
+            }
+            for (int column = 0; column < 3; ++column) {
+                for (int row = 0; row < 3; ++row) {
+                    EXPECT_NEAR(transforms[i].normal[column][row], normal[column][row], 1e-4f);
+                }
+                EXPECT_EQ(transforms[i].normal[column].w, 0.0f);
+            }
+        }
+    }
+
+    TEST(Raycaster, WallsFloorAndSky) {
+        Map map = MapParser::parseText("5 5\nWWWWW\nW000W\nW0S0W\nW000W\nWWWWW\n");
+        Image wall(2, 2), floor(2, 2);
+        for (size_t i = 0; i < wall.pixels.size(); i += 3) wall.pixels[i] = floor.pixels[i + 1] = 200;
+
+        Raycaster raycaster(map, wall, floor, 50, 40, 3);
+        const auto pixel = [](const Image &frame, size_t x, size_t y) {
+            const uint8_t *p = frame.At(x, y);
+            return std::vector<int>{p[0], p[1], p[2]};
+        };
+        // looking along -x at the lit side of a wall 1.5 away, with the sky over it and the floor before it
+        State state = {.camPosition = glm::vec3(2, 2, 0), .angle = 0, .angle2 = 0};
+        const Image &frame = raycaster.Render(state);
+        EXPECT_EQ(pixel(frame, 25, 0), (std::vector<int>{51, 102, 204}));
+        EXPECT_EQ(pixel(frame, 25, 20), (std::vector<int>{175, 0, 0}));
+        EXPECT_EQ(pixel(frame, 25, 39), (std::vector<int>{0, 175, 0}));
+
+        // the +y side of a wall only gets the ambient light
+        state.angle = -3.14159265f / 2;
+        EXPECT_EQ(pixel(raycaster.Render(state), 25, 20), (std::vector<int>{60, 0, 0}));
+        // past the far plane there is only sky
+        EXPECT_EQ(pixel(raycaster.Render(state, 1), 25, 20), (std::vector<int>{51, 102, 204}));
+    }
+}